@@ -4,7 +4,6 @@
 
 #include "FutureAsync.hpp"
 #include "thread-sets.h"
-#include <future>
 
 extern "C" {
     THREAD_SET *ThreadSetAlloc(pAsyncFunc f, int numThreads, foint input[]) {
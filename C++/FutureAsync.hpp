@@ -5,10 +5,7 @@
 
 #include "misc.h"
 #include "thread-sets.h"
-#include <iostream>
-#include <utility>
-#include <future>
-#include <limits>
+#include "thread-pool.h"
 
 class FutureAsync {
     public:
@@ -20,6 +17,7 @@ class FutureAsync {
 	pAsyncFunc f;
 	int numThreads;
 	foint *inputs, *outputs;
+	static void RunRange(int worker, long begin, long end, void *arg);
 };
 
 FutureAsync::FutureAsync(pAsyncFunc f, int n, foint inputs[]) {
@@ -31,14 +29,14 @@ FutureAsync::FutureAsync(pAsyncFunc f, int n, foint inputs[]) {
 
 FutureAsync::~FutureAsync(void) { free(this->outputs); }
 
-foint *FutureAsync::RunAll(void) {
-    int i;
-    std::future<foint> futureList[numThreads];
-
-    for(i=0; i<numThreads; i++)
-	futureList[i] = std::async(std::launch::async, this->f, this->inputs[i]);
-    for(i=0; i<numThreads; i++)
-	outputs[i] = futureList[i].get();
+void FutureAsync::RunRange(int worker, long begin, long end, void *arg) {
+    FutureAsync *fa = (FutureAsync *)arg;
+    for(long i=begin; i<end; i++) fa->outputs[i] = fa->f(fa->inputs[i]);
+}
 
+// The inputs are shared among the default pool's persistent workers rather than each getting a new thread, so
+// at most ThreadPoolSize(ThreadPoolDefault()) of them run at once: f must not wait for another input's call.
+foint *FutureAsync::RunAll(void) {
+    ThreadPoolParallelFor(ThreadPoolDefault(), 0, numThreads, 1, RunRange, this);
     return outputs;
 }
@@ -17,6 +17,8 @@
 #include <errno.h>
 #include <unistd.h>
 #include <regex>
+#include <thread>
+#include <atomic>
 
 using namespace std;
 
@@ -181,32 +183,110 @@ Graph Graph::shuffledGraph(vector<uint> &newToOldMap) const {
     return nodeInducedSubgraph(newToOldMap);
 }
 
+//run body(tid, chunk) for chunks [0,numChunks) on numThreads threads, handing chunks out dynamically
+template <typename F> static void parallelChunks(uint numChunks, uint numThreads, F body) {
+    atomic<uint> next(0);
+    auto worker = [&](uint tid) {
+        for (uint c; (c = next.fetch_add(1)) < numChunks; ) body(tid, c);
+    };
+    vector<thread> pool;
+    for (uint t = 1; t < numThreads; t++) pool.emplace_back(worker, t);
+    worker(0);
+    for (auto& t : pool) t.join();
+}
+
+//k-hop neighborhoods by a BFS from every node that stops at depth k. Each source only emits its
+//neighbors with a larger index, so every edge comes out once. The work per source is proportional
+//to the size of its k-hop neighborhood, so the total is O(output * average degree).
+static void powerEdgesBFS(const vector<vector<uint>>& adjLists, uint power, uint numThreads,
+                          vector<vector<array<uint, 2>>>& chunkEdges, uint chunkSize) {
+    uint n = adjLists.size();
+    vector<vector<uint>> seen(numThreads), frontier(numThreads), next(numThreads);
+    vector<uint> stamp(numThreads, 0);
+    parallelChunks(chunkEdges.size(), numThreads, [&](uint tid, uint c) {
+        vector<uint>& mark = seen[tid];
+        if (mark.empty()) mark.assign(n, 0);
+        vector<uint>& F = frontier[tid];
+        vector<uint>& N = next[tid];
+        for (uint src = c*chunkSize; src < min(n, (c+1)*chunkSize); src++) {
+            uint s = ++stamp[tid]; //marks from earlier sources are stale, no need to clear them
+            mark[src] = s;
+            F.assign(1, src);
+            for (uint depth = 0; depth < power and not F.empty(); depth++) {
+                N.clear();
+                for (uint u : F) for (uint v : adjLists[u]) {
+                    if (mark[v] == s) continue;
+                    mark[v] = s;
+                    N.push_back(v);
+                    if (v > src) chunkEdges[c].push_back({src, v});
+                }
+                F.swap(N);
+            }
+        }
+    });
+}
+
+//k-hop neighborhoods as rows of an n x n bit matrix: R_1 = A+I and R_{i+1}[u] = OR of R_i[v] over
+//v in {u} and N(u). Costs O(k * m * n/64) word operations regardless of how much the
+//neighborhoods overlap, which beats BFS once neighborhoods cover a sizeable fraction of the graph.
+static void powerEdgesBitset(const vector<vector<uint>>& adjLists, uint power, uint numThreads,
+                             vector<vector<array<uint, 2>>>& chunkEdges, uint chunkSize) {
+    uint n = adjLists.size(), words = (n+63)/64;
+    vector<uint64_t> R((size_t)n*words, 0), S((size_t)n*words);
+    for (uint u = 0; u < n; u++) {
+        R[(size_t)u*words + u/64] |= 1ULL << (u%64);
+        for (uint v : adjLists[u]) R[(size_t)u*words + v/64] |= 1ULL << (v%64);
+    }
+    for (uint i = 1; i < power; i++) {
+        parallelChunks(chunkEdges.size(), numThreads, [&](uint, uint c) {
+            for (uint u = c*chunkSize; u < min(n, (c+1)*chunkSize); u++) {
+                uint64_t* row = &S[(size_t)u*words];
+                copy(&R[(size_t)u*words], &R[(size_t)u*words] + words, row);
+                for (uint v : adjLists[u]) {
+                    const uint64_t* other = &R[(size_t)v*words];
+                    for (uint w = 0; w < words; w++) row[w] |= other[w];
+                }
+            }
+        });
+        R.swap(S);
+    }
+    parallelChunks(chunkEdges.size(), numThreads, [&](uint, uint c) {
+        for (uint u = c*chunkSize; u < min(n, (c+1)*chunkSize); u++) {
+            const uint64_t* row = &R[(size_t)u*words];
+            for (uint w = (u+1)/64; w < words; w++) {
+                uint64_t bits = row[w];
+                if (w == (u+1)/64) bits &= ~0ULL << ((u+1)%64); //only v > u
+                for (; bits; bits &= bits-1) chunkEdges[c].push_back({u, w*64 + (uint)__builtin_ctzll(bits)});
+            }
+        }
+    });
+}
+
 //this function is not tested a lot, use with care?
-Graph Graph::graphPower(uint power) const {
+Graph Graph::graphPower(uint power, uint numThreads) const {
     if (power == 0) throw runtime_error("graphs don't have 0 powers");
     if (power == 1) cerr<<"Warning: first power of a graph is just the graph itself"<<endl;
+    if (numThreads == 0) numThreads = max(1u, thread::hardware_concurrency());
     uint n = getNumNodes();
-    SparseMatrix<uint> oriAdjMat(n);
-    for (const auto& edge : edgeList) {
-        uint node1 = edge[0], node2 = edge[1];
-        oriAdjMat[node1][node2] = oriAdjMat[node2][node1] = 1;
-    }
-    SparseMatrix<uint> newAdjMat = oriAdjMat;
+    const uint chunkSize = 256;
+    vector<vector<array<uint, 2>>> chunkEdges((n+chunkSize-1)/chunkSize);
+
+    //bit rows pay off when BFS from each node would reach about a (power-1)/64 fraction of the graph
+    //anyway; cap their two n x n bit matrices at 256MB
+    double avgDeg = n ? 2.0*getNumEdges()/n : 0;
+    double reach = min((double)n, pow(max(avgDeg, 1.0), power));
+    bool dense = (double)n*n/8 <= 128.0*1024*1024 and reach*64 > (power-1)*(double)n;
+    if (dense) powerEdgesBitset(adjLists, power, numThreads, chunkEdges, chunkSize);
+    else powerEdgesBFS(adjLists, power, numThreads, chunkEdges, chunkSize);
 
-    for(uint i = 1; i < power; i++) {
-        //the number of multiplications can be reduced from O(power) to O(log power) 
-        //by multiplying the new matrix with itself instead of the original
-        //I left this optimization unimplemented since I don't think this function is used much -Nil
-        SparseMatrix<uint> newAdjMat = newAdjMat.multiply(oriAdjMat);
-    }
     vector<array<uint, 2>> newEdgeList;
-    //there is probably an O(m) way to do this instead of O(n^2) -Nil
-    for(uint i=0;i<n;i++){
-        for(uint j=i;j<n;j++){
-            if(newAdjMat.get(i,j) > 0){
-                newEdgeList.push_back({i,j});
-            }
-        }
+    size_t total = 0;
+    for (const auto& edges : chunkEdges) total += edges.size();
+    newEdgeList.reserve(total + n);
+    for (uint u = 0; u < n; u++) if (hasSelfLoop(u)) newEdgeList.push_back({u, u});
+    for (auto& edges : chunkEdges) {
+        newEdgeList.insert(newEdgeList.end(), edges.begin(), edges.end());
+        vector<array<uint, 2>>().swap(edges);
     }
     return Graph(name+"_power_"+to_string(power), "", newEdgeList, 
                  nodeNames, {}, colorsAsNodeColorNamePairs()); //unweighted result
@@ -62,7 +62,9 @@ public:
     Graph nodeInducedSubgraph(const vector<uint>& nodes) const;
     Graph randomNodeInducedSubgraph(uint numNodes) const;
     Graph shuffledGraph(vector<uint>& newToOldMap) const; //the parameter is a return value
-    Graph graphPower(uint power) const; //graph obtained by multiplying the adj matrix by itself 'power' times
+    //nodes at distance 1..power in this graph are adjacent in the result (self-loops are kept as they are);
+    //same nonzero pattern as the adj matrix raised to the 'power' with the identity added. numThreads=0 uses all cores
+    Graph graphPower(uint power, uint numThreads = 0) const;
     Graph graphWithAddedRandomEdges(double addedEdgesProportion) const;
     Graph graphWithRemovedRandomEdges(double removedEdgesProportion) const;
     Graph graphWithRewiredRandomEdges(double rewiredEdgesProportion) const;
@@ -1,20 +1,25 @@
 // This software is part of github.com/waynebhayes/libwayne, and is Copyright(C) Wayne B. Hayes 2025, under the GNU LGPL 3.0
 // (GNU Lesser General Public License, version 3, 2007), a copy of which is contained at the top of the repo.
 #include "CoreScore.hpp"
+#include <mutex>
 
-CoreScoreData::CoreScoreData() {}
+CoreScoreData::CoreScoreData(): n1(0), n2(0) {}
 
-CoreScoreData::CoreScoreData(uint n1, uint n2) {
+CoreScoreData::CoreScoreData(uint n1, uint n2): n1(n1), n2(n2) {
     numPegSamples = vector<unsigned long>(n1, 0);
+    totalWeightedPegWeight_pBad = vector<double>(n1, 0);
+    totalWeightedPegWeight_1mpBad = vector<double>(n1, 0);
+    totalWeightedPegWeight_pwPBad = vector<double>(n1, 0);
+    totalWeightedPegWeight_1mpwPBad = vector<double>(n1, 0);
+#ifdef SPARSE
+    pegHoles = vector<PegHoleCounts>(n1);
+#else
     pegHoleFreq = Matrix<unsigned long>(n1, n2);
     weightedPegHoleFreq_pBad = Matrix<double>(n1, n2);
-    totalWeightedPegWeight_pBad = vector<double>(n1, 0);
     weightedPegHoleFreq_1mpBad = Matrix<double>(n1, n2);
-    totalWeightedPegWeight_1mpBad = vector<double>(n1, 0);
     weightedPegHoleFreq_pwPBad = Matrix<double>(n1, n2);
-    totalWeightedPegWeight_pwPBad = vector<double>(n1, 0);
     weightedPegHoleFreq_1mpwPBad = Matrix<double>(n1, n2);
-    totalWeightedPegWeight_1mpwPBad = vector<double>(n1, 0);
+#endif
 }
 
 
@@ -25,6 +30,7 @@ CoreScoreData::CoreScoreData(uint n1, uint n2) {
   the smallest such score, and call it Smin. This defines the minimum score
   that we want to output, and it guarantees that every node appears in at
   least one aligned node-pair according to this score.  We output this Smin. */
+#ifndef SPARSE
 double CoreScoreData::trimCoreScore(Matrix<unsigned long>& Freq, vector<unsigned long>& numPegSamples) {
     uint n1 = Freq.size(), n2 = Freq[0].size();
     vector<double> high1(n1,0.0);
@@ -60,41 +66,144 @@ double CoreScoreData::trimCoreScore(Matrix<double>& Freq, vector<double>& totalP
     return Smin;
 }
 
+double CoreScoreData::trimCoreScore(CoreScoreWeighting w) const {
+    CoreScoreData& self = const_cast<CoreScoreData&>(*this); //Matrix has no const operator[]
+    switch (w) {
+    case CS_FREQ: return trimCoreScore(self.pegHoleFreq, self.numPegSamples);
+    case CS_PBAD: return trimCoreScore(self.weightedPegHoleFreq_pBad, self.totalWeightedPegWeight_pBad);
+    case CS_1MPBAD: return trimCoreScore(self.weightedPegHoleFreq_1mpBad, self.totalWeightedPegWeight_1mpBad);
+    case CS_PWPBAD: return trimCoreScore(self.weightedPegHoleFreq_pwPBad, self.totalWeightedPegWeight_pwPBad);
+    case CS_1MPWPBAD: return trimCoreScore(self.weightedPegHoleFreq_1mpwPBad, self.totalWeightedPegWeight_1mpwPBad);
+    }
+    throw runtime_error("unknown CoreScoreWeighting");
+}
+
+double CoreScoreData::get(CoreScoreWeighting w, uint peg, uint hole) const {
+    switch (w) {
+    case CS_FREQ: return pegHoleFreq.get(peg, hole);
+    case CS_PBAD: return weightedPegHoleFreq_pBad.get(peg, hole);
+    case CS_1MPBAD: return weightedPegHoleFreq_1mpBad.get(peg, hole);
+    case CS_PWPBAD: return weightedPegHoleFreq_pwPBad.get(peg, hole);
+    case CS_1MPWPBAD: return weightedPegHoleFreq_1mpwPBad.get(peg, hole);
+    }
+    throw runtime_error("unknown CoreScoreWeighting");
+}
+
+void CoreScoreData::inc(uint peg, uint hole, double pBad, double meanPBad) {
+    pegHoleFreq[peg][hole]++;
+    weightedPegHoleFreq_pBad[peg][hole] += meanPBad;
+    weightedPegHoleFreq_1mpBad[peg][hole] += 1-meanPBad;
+    weightedPegHoleFreq_pwPBad[peg][hole] += pBad;
+    weightedPegHoleFreq_1mpwPBad[peg][hole] += 1-pBad;
+}
+
+#else // SPARSE
+
+double PegHoleCounts::Entry::get(CoreScoreWeighting w) const {
+    switch (w) {
+    case CS_FREQ: return freq;
+    case CS_PBAD: return pBad;
+    case CS_1MPBAD: return _1mpBad;
+    case CS_PWPBAD: return pwPBad;
+    case CS_1MPWPBAD: return _1mpwPBad;
+    }
+    throw runtime_error("unknown CoreScoreWeighting");
+}
+
+//a peg only ever visits a handful of holes, so start tiny; multiplicative hashing on the hole id
+static inline uint holeSlot(uint hole, size_t mask) { return (uint)((hole * 2654435769u) & mask); }
+
+PegHoleCounts::Entry& PegHoleCounts::operator [] (uint hole) {
+    if (4*(used+1) > 3*table.size()) grow();
+    size_t mask = table.size()-1;
+    uint i = holeSlot(hole, mask);
+    while (table[i].hole != hole and table[i].hole != EMPTY) i = (i+1) & mask;
+    if (table[i].hole == EMPTY) { table[i].hole = hole; used++; }
+    return table[i];
+}
+
+const PegHoleCounts::Entry* PegHoleCounts::find(uint hole) const {
+    if (table.empty()) return NULL;
+    size_t mask = table.size()-1;
+    for (uint i = holeSlot(hole, mask); table[i].hole != EMPTY; i = (i+1) & mask)
+        if (table[i].hole == hole) return &table[i];
+    return NULL;
+}
+
+void PegHoleCounts::grow() {
+    Entry empty = {EMPTY, 0, 0, 0, 0, 0};
+    vector<Entry> old(table.empty() ? 4 : 2*table.size(), empty);
+    old.swap(table);
+    size_t mask = table.size()-1;
+    for (const Entry& e : old) if (e.hole != EMPTY) {
+        uint i = holeSlot(e.hole, mask);
+        while (table[i].hole != EMPTY) i = (i+1) & mask;
+        table[i] = e;
+    }
+}
+
+//same Smin as the dense version: pairs never visited score 0, which can't raise any node's high score
+double CoreScoreData::trimCoreScore(CoreScoreWeighting w) const {
+    vector<double> high1(n1,0.0);
+    vector<double> high2(n2,0.0);
+    for (uint i=0; i<n1; i++) {
+        double total;
+        switch (w) {
+        case CS_FREQ: total = numPegSamples[i]; break;
+        case CS_PBAD: total = totalWeightedPegWeight_pBad[i]; break;
+        case CS_1MPBAD: total = totalWeightedPegWeight_1mpBad[i]; break;
+        case CS_PWPBAD: total = totalWeightedPegWeight_pwPBad[i]; break;
+        default: total = totalWeightedPegWeight_1mpwPBad[i]; break;
+        }
+        double denom =  1.0 / total;
+        for (const auto& e : pegHoles[i].slots()) {
+            if (e.hole == PegHoleCounts::EMPTY) continue;
+            double score = e.get(w) * denom;
+            if (score > high1[i]) high1[i] = score;
+            if (score > high2[e.hole]) high2[e.hole] = score;
+        }
+    }
+    double Smin = high1[0];
+    for (uint i=0;i<n1;i++) if (high1[i] < Smin) Smin = high1[i];
+    for (uint j=0;j<n2;j++) if (high2[j] < Smin) Smin = high2[j];
+    return Smin;
+}
+
+double CoreScoreData::get(CoreScoreWeighting w, uint peg, uint hole) const {
+    const PegHoleCounts::Entry* e = pegHoles[peg].find(hole);
+    return e ? e->get(w) : 0;
+}
+
+void CoreScoreData::inc(uint peg, uint hole, double pBad, double meanPBad) {
+    PegHoleCounts::Entry& e = pegHoles[peg][hole];
+    e.freq++;
+    e.pBad += meanPBad;
+    e._1mpBad += 1-meanPBad;
+    e.pwPBad += pBad;
+    e._1mpwPBad += 1-pBad;
+}
+
+#endif // SPARSE
+
 void CoreScoreData::incChangeOp(uint source, uint betterHole, double pBad, double meanPBad)
 {
     numPegSamples[source]++;
-    pegHoleFreq[source][betterHole]++;
     totalWeightedPegWeight_pBad[source] += meanPBad;
-    weightedPegHoleFreq_pBad[source][betterHole] += meanPBad;
     totalWeightedPegWeight_1mpBad[source] += 1-meanPBad;
-    weightedPegHoleFreq_1mpBad[source][betterHole] += 1-meanPBad;
     totalWeightedPegWeight_pwPBad[source] += pBad;
-    weightedPegHoleFreq_pwPBad[source][betterHole] += pBad;
     totalWeightedPegWeight_1mpwPBad[source] += 1-pBad;
-    weightedPegHoleFreq_1mpwPBad[source][betterHole] += 1-pBad;
+    inc(source, betterHole, pBad, meanPBad);
 }
 
 void CoreScoreData::incSwapOp(uint source1, uint source2, uint betterDest1, uint betterDest2, double pBad, double meanPBad)
 {
-    numPegSamples[source1]++; numPegSamples[source2]++;
-    pegHoleFreq[source1][betterDest1]++; pegHoleFreq[source2][betterDest2]++;
-    totalWeightedPegWeight_pBad[source1] += meanPBad;
-    weightedPegHoleFreq_pBad[source1][betterDest1] += meanPBad;
-    totalWeightedPegWeight_pBad[source2] += meanPBad;
-    weightedPegHoleFreq_pBad[source2][betterDest2] += meanPBad;
-
-    totalWeightedPegWeight_1mpBad[source1] += 1-meanPBad;
-    weightedPegHoleFreq_1mpBad[source1][betterDest1] += 1-meanPBad;
-    totalWeightedPegWeight_1mpBad[source2] += 1-meanPBad;
-    weightedPegHoleFreq_1mpBad[source2][betterDest2] += 1-meanPBad;
-    
-    totalWeightedPegWeight_pwPBad[source1] += pBad;
-    weightedPegHoleFreq_pwPBad[source1][betterDest1] += pBad;
-    totalWeightedPegWeight_pwPBad[source2] += pBad;
-    weightedPegHoleFreq_pwPBad[source2][betterDest2] += pBad;
-
-    totalWeightedPegWeight_1mpwPBad[source1] += 1-pBad;
-    weightedPegHoleFreq_1mpwPBad[source1][betterDest1] += 1-pBad;
-    totalWeightedPegWeight_1mpwPBad[source2] += 1-pBad;
-    weightedPegHoleFreq_1mpwPBad[source2][betterDest2] += 1-pBad;
+    incChangeOp(source1, betterDest1, pBad, meanPBad);
+    incChangeOp(source2, betterDest2, pBad, meanPBad);
+}
+
+void CoreScoreData::merge(Buffer& buf) {
+    static mutex mergeLock; //merges are rare (checkpoints), so one lock for all instances is plenty
+    lock_guard<mutex> guard(mergeLock);
+    for (const auto& op : buf.ops) incChangeOp(op.peg, op.hole, op.pBad, op.meanPBad);
+    buf.ops.clear();
 }
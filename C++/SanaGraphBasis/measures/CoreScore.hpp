@@ -8,28 +8,88 @@
 
 using namespace std;
 
+//the five peg->hole accumulators kept for each pair
+enum CoreScoreWeighting { CS_FREQ, CS_PBAD, CS_1MPBAD, CS_PWPBAD, CS_1MPWPBAD };
+
+#ifdef SPARSE
+//One peg's accumulators, for only the holes it has actually been moved to during annealing.
+//Open addressing on the hole id; the five accumulators of a pair share one slot, so an update is one probe.
+class PegHoleCounts {
+public:
+    struct Entry {
+        uint hole;
+        unsigned long freq;
+        double pBad, _1mpBad, pwPBad, _1mpwPBad;
+        double get(CoreScoreWeighting w) const;
+    };
+    static const uint EMPTY = ~0u;
+
+    PegHoleCounts(): used(0) {}
+    Entry& operator [] (uint hole); //creates a zeroed entry if missing
+    const Entry* find(uint hole) const; //NULL if this peg never went to hole
+    uint size() const { return used; }
+    //visit every entry: for (const auto& e : counts.slots()) if (e.hole != EMPTY) ...
+    const vector<Entry>& slots() const { return table; }
+
+private:
+    vector<Entry> table;
+    uint used;
+    void grow();
+};
+#endif
+
 class CoreScoreData {
 public:
 
     CoreScoreData();
     CoreScoreData(uint n1, uint n2);
 
-    Matrix<unsigned long> pegHoleFreq;
+    uint n1, n2;
     vector<unsigned long> numPegSamples; // number of times this node in g1 was sampled.
-    Matrix<double> weightedPegHoleFreq_pBad; // weighted by pBad
     vector<double> totalWeightedPegWeight_pBad;
-    Matrix<double> weightedPegHoleFreq_1mpBad; // weighted by 1-pBad
     vector<double> totalWeightedPegWeight_1mpBad;
-    Matrix<double> weightedPegHoleFreq_pwPBad; // weighted by actual(pairwise) pBad
     vector<double> totalWeightedPegWeight_pwPBad;
-    Matrix<double> weightedPegHoleFreq_1mpwPBad; // weighted by 1-actual pBad
     vector<double> totalWeightedPegWeight_1mpwPBad;
+#ifdef SPARSE
+    vector<PegHoleCounts> pegHoles; // pegHoles[peg] holds every accumulator for that peg
+#else
+    Matrix<unsigned long> pegHoleFreq;
+    Matrix<double> weightedPegHoleFreq_pBad; // weighted by pBad
+    Matrix<double> weightedPegHoleFreq_1mpBad; // weighted by 1-pBad
+    Matrix<double> weightedPegHoleFreq_pwPBad; // weighted by actual(pairwise) pBad
+    Matrix<double> weightedPegHoleFreq_1mpwPBad; // weighted by 1-actual pBad
 
     static double trimCoreScore(Matrix<unsigned long>& Freq, vector<unsigned long>& numPegSamples);
     static double trimCoreScore(Matrix<double>& Freq, vector<double>& numPegSamples);
+#endif
+    //the same Smin as the static trimCoreScore()s, for either backend
+    double trimCoreScore(CoreScoreWeighting w) const;
+    double get(CoreScoreWeighting w, uint peg, uint hole) const; // the accumulator itself, 0 if never visited
 
     void incChangeOp(uint source, uint betterHole, double pBad, double meanPBad);
     void incSwapOp(uint source1, uint source2, uint betterDest1, uint betterDest2, double pBad, double meanPBad);
+
+    //Per-thread log of operations, so annealing threads never write to the shared accumulators; they
+    //fold their Buffer in with merge() at checkpoints.  Same increments, same order as calling incChangeOp().
+    class Buffer {
+    public:
+        void incChangeOp(uint source, uint betterHole, double pBad, double meanPBad) {
+            ops.push_back({source, betterHole, pBad, meanPBad});
+        }
+        void incSwapOp(uint source1, uint source2, uint betterDest1, uint betterDest2, double pBad, double meanPBad) {
+            ops.push_back({source1, betterDest1, pBad, meanPBad});
+            ops.push_back({source2, betterDest2, pBad, meanPBad});
+        }
+        size_t size() const { return ops.size(); }
+    private:
+        friend class CoreScoreData;
+        struct Op { uint peg, hole; double pBad, meanPBad; };
+        vector<Op> ops;
+    };
+    void merge(Buffer& buf); //thread-safe; empties buf
+
+private:
+    void inc(uint peg, uint hole, double pBad, double meanPBad);
 };
 
 #endif
@@ -3,92 +3,134 @@
 #include "ComputeGraphletsWrapper.hpp"
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cstring>
 #include "computeGraphlets.hpp"
 #include "FileIO.hpp"
 using namespace std;
 
-vector<vector<uint>> ComputeGraphletsWrapper::loadGraphletDegreeVectors(const Graph& G, uint maxGraphletSize) {
-    string graphletSizeStr = to_string(maxGraphletSize);
-    string subfolder = "gdv"+graphletSizeStr+"/";
+GDVMatrix ComputeGraphletsWrapper::computeGDVs(const Graph& G, uint maxGraphletSize) {
+    cout<<"Computing Graphlet Degree Vectors... "<<endl;
+    return computeGraphletsSource::computeGDVs(maxGraphletSize, G.getNumNodes(), *(G.getEdgeList()));
+}
+
+GDVMatrix ComputeGraphletsWrapper::loadGDVs(const Graph& G, uint maxGraphletSize) {
+    if (maxGraphletSize != 4 and maxGraphletSize != 5)
+        throw runtime_error("only 4 or 5 max graphlet size supported");
+    string subfolder = "gdv"+to_string(maxGraphletSize)+"/";
     FileIO::createFolder(AUTOGENEREATED_FILES_FOLDER + subfolder);
-    string gdvsFileName = AUTOGENEREATED_FILES_FOLDER+subfolder+"/"+G.getName()+"_gdv"+graphletSizeStr+".bin";
-    uint n = G.getNumNodes();
-    if (FileIO::fileExists(gdvsFileName) and not newerGraphAvailable(G.getFilePath(), gdvsFileName)) {
-        uint degVecLen;
-        if (maxGraphletSize == 4) degVecLen = 15;
-        else if (maxGraphletSize == 5) degVecLen = 73;
-        else throw runtime_error("only 4 or 5 max graphlet size supported");
-        vector<vector<uint>> gdvs(n, vector<uint> (degVecLen));
-        readMatrixFromBinaryFile(gdvs, gdvsFileName);
-        return gdvs;
-    }
+    array<uint64_t, 2> hash = edgeListHash(G);
+    string gdvsFileName = cacheFileName(G, maxGraphletSize, hash);
+    GDVMatrix gdvs;
+    if (readGDVCache(gdvsFileName, G, maxGraphletSize, hash, gdvs)) return gdvs;
+
     cout << "Computing " << gdvsFileName << " ... ";
     Timer T;
     T.start();
-    vector<vector<uint>> gdvs = computeGraphletDegreeVectors(G, maxGraphletSize);
-    cout << "loadGraphletDegreeVectors done (" << T.elapsedString() << ")" << endl;
-    writeMatrixToBinaryFile(gdvs, gdvsFileName);
-    string readeableVersionFile = AUTOGENEREATED_FILES_FOLDER+subfolder+G.getName()+"_gdv"+graphletSizeStr+".txt";
-    writeMatrixToFile(gdvs, readeableVersionFile);
+    gdvs = computeGDVs(G, maxGraphletSize);
+    cout << "loadGDVs done (" << T.elapsedString() << ")" << endl;
+    writeGDVCache(gdvsFileName, G, maxGraphletSize, hash, gdvs);
     return gdvs;
 }
 
-bool ComputeGraphletsWrapper::newerGraphAvailable(const string& graphDir, const string& binaryDir) {
-    struct stat st;
-    stat(graphDir.c_str(), &st);
-    time_t graphTime = st.st_mtime;
-    if (stat(binaryDir.c_str(), &st) != 0) return true;
-    return graphTime > st.st_mtime;
+vector<vector<uint>> ComputeGraphletsWrapper::loadGraphletDegreeVectors(const Graph& G, uint maxGraphletSize) {
+    return loadGDVs(G, maxGraphletSize).toVectors();
 }
 
 vector<vector<uint>> ComputeGraphletsWrapper::computeGraphletDegreeVectors(const Graph& G, uint maxGraphletSize) {
-    cout<<"Computing Graphlet Degree Vectors... "<<endl;
-    FILE *fp = tmpfile();
-    fprintf(fp, "%d %d\n", G.getNumNodes(), G.getNumEdges()); 
-    for (const auto& edge : *(G.getEdgeList())) {
-        fprintf(fp, "%d %d\n", edge[0], edge[1]);
-    }
-    rewind(fp); //because computeGraphlets starts reading the file from the start
-    vector<vector<uint>> gdvs = computeGraphletsSource::computeGraphlets(maxGraphletSize, fp);
-    fclose(fp);
-    return gdvs;
+    return computeGDVs(G, maxGraphletSize).toVectors();
 }
 
 void ComputeGraphletsWrapper::saveGraphletsAsSigs(const Graph& G, uint maxGraphletSize, const string& fileName) {
-    vector<vector<uint>> graphlets = computeGraphletDegreeVectors(G, maxGraphletSize);
+    GDVMatrix graphlets = computeGDVs(G, maxGraphletSize);
     ofstream ofs(fileName);
     for (unsigned int i = 0; i < G.getNumNodes(); i++) {
         ofs << G.getNodeName(i) << "\t";
-        for (int j = 0; j < 73; j++) { //why 73? doesn't it depend on maxGraphletSize? -Nil
+        for (uint j = 0; j < graphlets.numOrbits; j++) {
             ofs << graphlets[i][j] << "\t";
         }
         ofs<<endl;
     }
 }
 
-void ComputeGraphletsWrapper::writeMatrixToFile(const vector<vector<uint>>& matrix, const string& fileName) {
-    uint n1 = matrix.size(), n2 = matrix[0].size();
-    ofstream ofs(fileName);
-    for (uint i = 0; i < n1; i++) {
-        for (uint j = 0; j < n2; j++) {
-            ofs << matrix[i][j] << " ";
-        }
-        ofs << endl;
+//each edge contributes a mixed key to a sum and (mixed again) to an xor, so the order of the edge list
+//and of the two endpoints of an edge don't matter
+array<uint64_t, 2> ComputeGraphletsWrapper::edgeListHash(const Graph& G) {
+    using computeGraphletsSource::mix64;
+    array<uint64_t, 2> h = {{mix64(G.getNumNodes()), mix64(~(uint64_t)G.getNumNodes())}};
+    for (const auto& edge : *(G.getEdgeList())) {
+        uint64_t lo = min(edge[0], edge[1]), hi = max(edge[0], edge[1]);
+        uint64_t k = mix64(lo<<32 | hi);
+        h[0] += k;
+        h[1] ^= mix64(k + 0x9e3779b97f4a7c15ULL);
     }
+    return h;
 }
 
-void ComputeGraphletsWrapper::writeMatrixToBinaryFile(const vector<vector<uint>>& matrix, const string& fileName) {
-    uint n1 = matrix.size(), n2 = matrix[0].size();
-    ofstream ofs(fileName, ios::out | ios::binary);
-    for (uint i = 0; i < n1; i++) {
-        ofs.write((char*)&matrix[i][0], n2*sizeof(uint));
+string ComputeGraphletsWrapper::cacheFileName(const Graph& G, uint maxGraphletSize, const array<uint64_t, 2>& hash) {
+    char hex[33];
+    snprintf(hex, sizeof(hex), "%016llx%016llx", (unsigned long long)hash[0], (unsigned long long)hash[1]);
+    string k = to_string(maxGraphletSize);
+    return AUTOGENEREATED_FILES_FOLDER+"gdv"+k+"/"+G.getName()+"_gdv"+k+"_"+hex+".gdv";
+}
+
+//false if the file is missing, truncated, or was made for a different graph, graphlet size or machine
+bool ComputeGraphletsWrapper::readGDVCache(const string& fileName, const Graph& G, uint maxGraphletSize,
+                                           const array<uint64_t, 2>& hash, GDVMatrix& gdv) {
+    int fd = open(fileName.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+    struct stat st;
+    if (fstat(fd, &st) != 0 or (size_t)st.st_size < sizeof(GDVCacheHeader)) { close(fd); return false; }
+    void *map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) return false;
+
+    const GDVCacheHeader *h = (const GDVCacheHeader*)map;
+    uint numOrbits = (maxGraphletSize == 4 ? 15 : 73);
+    size_t dataBytes = (size_t)G.getNumNodes()*numOrbits*sizeof(uint64_t);
+    bool ok = memcmp(h->magic, "GDVCACHE", 8) == 0 and h->version == GDV_CACHE_VERSION
+        and h->byteOrder == 0x01020304 and h->maxGraphletSize == maxGraphletSize and h->numOrbits == numOrbits
+        and h->numNodes == G.getNumNodes() and h->numEdges == G.getNumEdges()
+        and h->edgeHash[0] == hash[0] and h->edgeHash[1] == hash[1]
+        and h->dataOffset >= sizeof(GDVCacheHeader) and h->dataOffset % sizeof(uint64_t) == 0
+        and (size_t)st.st_size >= h->dataOffset + dataBytes;
+    if (ok) {
+        gdv.numNodes = G.getNumNodes();
+        gdv.numOrbits = numOrbits;
+        gdv.counts.resize((size_t)gdv.numNodes*numOrbits);
+        memcpy(gdv.counts.data(), (const char*)map + h->dataOffset, dataBytes);
     }
+    munmap(map, st.st_size);
+    return ok;
 }
 
-void ComputeGraphletsWrapper::readMatrixFromBinaryFile(vector<vector<uint>>& matrix, const string& fileName) {
-    uint n1 = matrix.size(), n2 = matrix[0].size();
-    ifstream ifs(fileName, ios::in | ios::binary);
-    for (uint i = 0; i < n1; i++) {
-        ifs.read((char*)&matrix[i][0], n2*sizeof(uint));
+//written to a temporary name and renamed into place, so concurrent runs never see a partial file
+void ComputeGraphletsWrapper::writeGDVCache(const string& fileName, const Graph& G, uint maxGraphletSize,
+                                            const array<uint64_t, 2>& hash, const GDVMatrix& gdv) {
+    GDVCacheHeader h;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, "GDVCACHE", 8);
+    h.version = GDV_CACHE_VERSION;
+    h.byteOrder = 0x01020304;
+    h.maxGraphletSize = maxGraphletSize;
+    h.numOrbits = gdv.numOrbits;
+    h.numNodes = gdv.numNodes;
+    h.numEdges = G.getNumEdges();
+    h.edgeHash[0] = hash[0]; h.edgeHash[1] = hash[1];
+    h.dataOffset = 64;
+    static_assert(sizeof(GDVCacheHeader) <= 64, "GDVCacheHeader must fit before the data");
+
+    string tmpName = fileName + ".tmp" + to_string(getpid());
+    ofstream ofs(tmpName, ios::out | ios::binary);
+    char pad[64] = {0};
+    memcpy(pad, &h, sizeof(h));
+    ofs.write(pad, sizeof(pad));
+    ofs.write((const char*)gdv.counts.data(), gdv.counts.size()*sizeof(uint64_t));
+    ofs.close();
+    if (not ofs or rename(tmpName.c_str(), fileName.c_str()) != 0) {
+        cerr << "Warning: could not write GDV cache " << fileName << endl;
+        remove(tmpName.c_str());
     }
 }
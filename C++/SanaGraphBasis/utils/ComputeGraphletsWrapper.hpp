@@ -9,19 +9,45 @@
 #include "../Graph.hpp"
 
 using namespace std;
+using computeGraphletsSource::GDVMatrix;
 
 //wrapper around the computeGraphlets algorithm/file
 class ComputeGraphletsWrapper {
 public:
+//GDVs straight from G's edge list in memory (no files involved)
+static GDVMatrix computeGDVs(const Graph& G, uint maxGraphletSize);
+//same, but cached under AUTOGENEREATED_FILES_FOLDER in a file named by the hash of G's edge list,
+//so a graph is recomputed only when its edges actually change (not when its file is touched)
+static GDVMatrix loadGDVs(const Graph& G, uint maxGraphletSize);
+
+//older interface: the same results as one vector per node
 static vector<vector<uint>> loadGraphletDegreeVectors(const Graph& G, uint maxGraphletSize);
 static vector<vector<uint>> computeGraphletDegreeVectors(const Graph& G, uint maxGraphletSize);
 static void saveGraphletsAsSigs(const Graph& G, uint maxGraphletSize, const string& fileName);
 
+//128-bit hash of the number of nodes and the set of edges, independent of edge order and orientation
+static array<uint64_t, 2> edgeListHash(const Graph& G);
+
 private:
-static bool newerGraphAvailable(const string& graphDir, const string& binaryDir);
-static void writeMatrixToFile(const vector<vector<uint>>& matrix, const string& fileName);
-static void writeMatrixToBinaryFile(const vector<vector<uint>>& matrix, const string& fileName);
-static void readMatrixFromBinaryFile(vector<vector<uint>>& matrix, const string& fileName);
+/* On-disk cache layout: this header, then numNodes*numOrbits uint64_t counts (row-major, native byte order)
+** starting at byte dataOffset.  The file can be mmap'ed and used in place. */
+struct GDVCacheHeader {
+    char magic[8];          // "GDVCACHE"
+    uint32_t version;       // GDV_CACHE_VERSION
+    uint32_t byteOrder;     // 0x01020304 as written by the creating machine
+    uint32_t maxGraphletSize, numOrbits;
+    uint32_t numNodes, reserved;
+    uint64_t numEdges;
+    uint64_t edgeHash[2];
+    uint64_t dataOffset;
+};
+static const uint32_t GDV_CACHE_VERSION = 1;
+
+static string cacheFileName(const Graph& G, uint maxGraphletSize, const array<uint64_t, 2>& hash);
+static bool readGDVCache(const string& fileName, const Graph& G, uint maxGraphletSize,
+                         const array<uint64_t, 2>& hash, GDVMatrix& gdv);
+static void writeGDVCache(const string& fileName, const Graph& G, uint maxGraphletSize,
+                          const array<uint64_t, 2>& hash, const GDVMatrix& gdv);
 };
 
 #endif /* COMPUTEGRAPHLETSWRAPPER_H_ */
@@ -14,11 +14,196 @@
 #include <unordered_map>
 #include <algorithm>
 #include <vector>
+#include <array>
+#include <thread>
+#include <atomic>
+#include <chrono>
 #include "utils.hpp"
 
 namespace computeGraphletsSource {
 
-std::vector<std::vector<uint>> computeGraphlets(int maxGraphletSize, FILE *fp);
+typedef int64_t int64; // same width as the uint64_t that GDVMatrix hands out
+typedef pair<int,int> PII;
+
+struct PAIR {
+    int a, b;
+    PAIR(int a0, int b0) { a=min(a0,b0); b=max(a0,b0); }
+    static PAIR none() { return PAIR(-1,-1); } // marks an empty FlatCounter slot
+};
+inline bool operator<(const PAIR &x, const PAIR &y) {
+    if (x.a==y.a) return x.b<y.b;
+    else return x.a<y.a;
+}
+inline bool operator==(const PAIR &x, const PAIR &y) {
+    return x.a==y.a && x.b==y.b;
+}
+// splitmix64 finalizer: every input bit affects every output bit, so packed node IDs spread over the whole table
+inline uint64_t mix64(uint64_t z) {
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+struct hash_PAIR {
+    size_t operator()(const PAIR &x) const {
+        return mix64((uint64_t)(uint32_t)x.a<<32 | (uint32_t)x.b);
+    }
+};
+
+struct TRIPLE {
+    int a, b, c;
+    TRIPLE(int a0, int b0, int c0) {
+        a=a0; b=b0; c=c0;
+        if (a>b) swap(a,b);
+        if (b>c) swap(b,c);
+        if (a>b) swap(a,b);
+    }
+    static TRIPLE none() { return TRIPLE(-1,-1,-1); } // marks an empty FlatCounter slot
+};
+inline bool operator<(const TRIPLE &x, const TRIPLE &y) {
+    if (x.a==y.a) {
+        if (x.b==y.b) return x.c<y.c;
+        else return x.b<y.b;
+    } else return x.a<y.a;
+}
+inline bool operator==(const TRIPLE &x, const TRIPLE &y) {
+    return x.a==y.a && x.b==y.b && x.c==y.c;
+}
+struct hash_TRIPLE {
+    size_t operator()(const TRIPLE &x) const {
+        return mix64(mix64((uint64_t)(uint32_t)x.a<<32 | (uint32_t)x.b) ^ (uint32_t)x.c);
+    }
+};
+
+/* Open-addressing KEY->count table with linear probing.  Each key is stored next to its count, so a lookup
+** usually touches one cache line, and there is no per-entry allocation.  KEY is PAIR or TRIPLE; a slot holding
+** KEY::none(), whose a == -1, is empty (node IDs are never negative).  Lookups through get() are read-only and may run
+** concurrently; operator[] may grow the table and must not. */
+template <typename KEY, typename HASH> class FlatCounter {
+public:
+    FlatCounter() : mask(0), used(0) {}
+    size_t size() const { return used; }
+    void reserve(size_t n) { // make room for n keys without rehashing
+        size_t cap = 16;
+        while (cap*MAX_LOAD_NUM < n*MAX_LOAD_DEN) cap *= 2;
+        if (cap > slots.size()) rehash(cap);
+    }
+    int &operator[](const KEY &k) {
+        if ((used+1)*MAX_LOAD_DEN > slots.size()*MAX_LOAD_NUM) rehash(slots.empty() ? 16 : 2*slots.size());
+        size_t i = HASH()(k) & mask;
+        while (slots[i].key.a != -1 && !(slots[i].key == k)) i = (i+1) & mask;
+        if (slots[i].key.a == -1) { slots[i].key = k; ++used; }
+        return slots[i].count;
+    }
+    int get(const KEY &k) const {
+        if (slots.empty()) return 0;
+        size_t i = HASH()(k) & mask;
+        for (; slots[i].key.a != -1; i = (i+1) & mask)
+            if (slots[i].key == k) return slots[i].count;
+        return 0;
+    }
+    size_t bytes() const { return slots.size()*sizeof(Slot); }
+
+private:
+    enum { MAX_LOAD_NUM = 7, MAX_LOAD_DEN = 10 }; // keep probe sequences short
+    struct Slot { KEY key; int count; };
+    std::vector<Slot> slots;
+    size_t mask, used;
+
+    static Slot emptySlot() { Slot e = {KEY::none(), 0}; return e; }
+    void rehash(size_t cap) {
+        std::vector<Slot> old(cap, emptySlot());
+        old.swap(slots);
+        mask = cap-1;
+        for (const Slot &o : old) if (o.key.a != -1) {
+            size_t i = HASH()(o.key) & mask;
+            while (slots[i].key.a != -1) i = (i+1) & mask;
+            slots[i] = o;
+        }
+    }
+};
+
+
+/* Graphlet degree vectors of a whole graph in one contiguous row-major block: row i holds the numOrbits
+** (15 for 4-node, 73 for 5-node graphlets) orbit counts of node i. */
+struct GDVMatrix {
+    uint numNodes=0, numOrbits=0;
+    std::vector<uint64_t> counts;
+    uint64_t *operator[](uint node) { return &counts[(size_t)node*numOrbits]; }
+    const uint64_t *operator[](uint node) const { return &counts[(size_t)node*numOrbits]; }
+    std::vector<std::vector<uint>> toVectors() const; // one vector per node, as computeGraphlets() returns
+};
+
+/* All of ORCA's state for one graph.  Nothing is shared between instances, so several graphs can be
+** counted concurrently; within one instance the per-node loops run on numThreads threads. */
+class Orca {
+public:
+    Orca(int maxGraphletSize, int numThreads=0); // numThreads<=0 means one per core
+    // Each init returns false (with a message on cerr) on bad input: node IDs out of range, self-loops or
+    // duplicate edges.
+    bool init(FILE *fp); // read "n m" followed by m edges
+    bool init(uint numNodes, const std::vector<std::array<uint,2>>& edgeList); // eg. Graph::getEdgeList()
+    bool init(uint numNodes, const uint *rowStart, const uint *nbrs); // CSR: nbrs[rowStart[u]..rowStart[u+1]-1]
+    void count4(); // count graphlets on max 4 nodes
+    void count5(); // count graphlets on max 5 nodes
+    void count() { if (GS==4) count4(); else count5(); }
+    std::vector<std::vector<uint>> results() const;
+    GDVMatrix takeResults(); // hands over the orbit counts without copying; the Orca is then spent
+
+private:
+    struct Scratch { // per-thread work arrays, each of length n
+        std::vector<int64> C;
+        std::vector<int> neigh, neigh2;
+        std::vector<int> common_x, common_x_list, common_a, common_a_list;
+        int ncx=0, nca=0;
+    };
+
+    int GS, numThreads;
+    int n,m; // n = number of nodes, m = number of edges
+    std::vector<int> deg; // degrees of individual nodes
+    std::vector<PAIR> edges; // list of edges
+    std::vector<int*> adj; // adj[x] - adjacency list of node x
+    std::vector<PII*> inc; // inc[x] - incidence list of node x: (y, edge id)
+    std::vector<int> adj_store;
+    std::vector<PII> inc_store;
+    int *adj_matrix; // compressed adjacency matrix, or NULL if it would be too big
+    std::vector<int> adj_matrix_store;
+    static const int adj_chunk = 8*sizeof(int);
+    std::vector<int64*> orbit; // orbit[x][o] - how many times does node x participate in orbit o
+    std::vector<uint64_t> orbit_store;
+    std::vector<int> tri; // tri[e] - number of triangles containing edge e
+    std::vector<int64> C; // C[x] - number of 4- or 5-cliques containing node x
+#if ORCA_STD_MAPS // the original node-per-entry maps and hashes, kept for benchmarking against FlatCounter
+    struct shift_hash_PAIR { size_t operator()(const PAIR &x) const { return (x.a<<8) ^ (x.b<<0); } };
+    struct shift_hash_TRIPLE { size_t operator()(const TRIPLE &x) const { return (x.a<<16) ^ (x.b<<8) ^ (x.c<<0); } };
+    std::unordered_map<PAIR, int, shift_hash_PAIR> common2;
+    std::unordered_map<TRIPLE, int, shift_hash_TRIPLE> common3;
+#else
+    FlatCounter<PAIR, hash_PAIR> common2; // common2[(a,b)] - number of common neighbours of a and b
+    FlatCounter<TRIPLE, hash_TRIPLE> common3; // common3[(a,b,c)] - same, for triples that are at least a path
+#endif
+    std::vector<Scratch> scratch;
+
+    bool adjacent(int x, int y) const {
+        if (adj_matrix) return adj_matrix[(x*n+y)/adj_chunk]&(1<<((x*n+y)%adj_chunk));
+        return std::binary_search(adj[x],adj[x]+deg[x],y);
+    }
+    bool build();
+    int common2_get(const PAIR &x) const;
+    int common3_get(const TRIPLE &x) const;
+    template <typename F> void parallelFor(int count, F body);
+    void countTriangles();
+    void reserveCommon();
+    void sumCliqueCounts();
+    void equations4(int x, Scratch &s);
+    void equations5(int x, Scratch &s);
+};
+
+// Reentrant: each call builds its own Orca.  numThreads<=0 means one per core.  All throw on bad input.
+std::vector<std::vector<uint>> computeGraphlets(int maxGraphletSize, FILE *fp, int numThreads=0);
+GDVMatrix computeGDVs(int maxGraphletSize, uint numNodes, const std::vector<std::array<uint,2>>& edgeList,
+    int numThreads=0);
+GDVMatrix computeGDVs(int maxGraphletSize, uint numNodes, const uint *rowStart, const uint *nbrs, int numThreads=0);
 
 }
 
@@ -0,0 +1,173 @@
+// This software is part of github.com/waynebhayes/libwayne, and is Copyright(C) Wayne B. Hayes 2025, under the GNU LGPL 3.0
+// (GNU Lesser General Public License, version 3, 2007), a copy of which is contained at the top of the repo.
+// Work-stealing thread pool; see thread-pool.h for the C interface.
+
+#include "ThreadPool.hpp"
+
+// which pool (if any) the current thread works for, and its number there
+static thread_local ThreadPool *_myPool = NULL;
+static thread_local int _myWorker = -1;
+
+// The decrement to zero happens under the lock, so once a waiter holding the lock sees zero, the
+// finishing thread is done with the group and the waiter may destroy it.
+void TaskGroup::Finished(void) {
+    long r = remaining.load();
+    while(r > 1 && !remaining.compare_exchange_weak(r, r-1))
+	;
+    if(r > 1) return;
+    std::lock_guard<std::mutex> lk(lock);
+    remaining--;
+    done.notify_all();
+}
+
+ThreadPool::ThreadPool(int n) : queued(0), nextQueue(0), stopping(false) {
+    if(n <= 0) n = std::thread::hardware_concurrency();
+    if(n <= 0) n = 1;
+    numWorkers = n;
+    workers = new Worker[n];
+    for(int w=0; w<n; w++) threads.push_back(std::thread(&ThreadPool::WorkerLoop, this, w));
+}
+
+ThreadPool::~ThreadPool(void) {
+    Wait(submitted);
+    {
+	std::lock_guard<std::mutex> lk(sleepLock);
+	stopping = true;
+    }
+    wake.notify_all();
+    for(auto &t : threads) t.join();
+    for(int w=0; w<numWorkers; w++) free(workers[w].scratch);
+    delete [] workers;
+}
+
+// Workers push onto their own deque; anybody else spreads tasks round-robin.
+void ThreadPool::Push(const PoolTask &t) {
+    int w = (_myPool == this ? _myWorker : nextQueue++ % numWorkers);
+    {
+	std::lock_guard<std::mutex> lk(workers[w].lock);
+	workers[w].tasks.push_back(t);
+    }
+    {
+	std::lock_guard<std::mutex> lk(sleepLock);
+	queued++;
+    }
+    wake.notify_one();
+}
+
+bool ThreadPool::Pop(int w, PoolTask &t) {
+    std::lock_guard<std::mutex> lk(workers[w].lock);
+    if(workers[w].tasks.empty()) return false;
+    t = workers[w].tasks.back();
+    workers[w].tasks.pop_back();
+    queued--;
+    return true;
+}
+
+bool ThreadPool::Steal(int w, PoolTask &t) {
+    for(int i=1; i<numWorkers; i++) {
+	Worker &v = workers[(w+i) % numWorkers];
+	std::lock_guard<std::mutex> lk(v.lock);
+	if(v.tasks.empty()) continue;
+	t = v.tasks.front();
+	v.tasks.pop_front();
+	queued--;
+	return true;
+    }
+    return false;
+}
+
+// A range task bigger than its grain hands its upper halves back to the pool before doing the rest itself,
+// so a parallel-for starts as one task and fans out only as fast as idle workers steal the pieces.
+void ThreadPool::Run(int w, PoolTask &t) {
+    if(t.range) {
+	while(t.end - t.begin > t.grain) {
+	    PoolTask half = t;
+	    half.begin = t.begin + (t.end - t.begin)/2;
+	    t.end = half.begin;
+	    t.group->remaining++;
+	    Push(half);
+	}
+	t.range(w, t.begin, t.end, t.arg);
+    }
+    else t.task(w, t.f);
+    t.group->Finished();
+}
+
+// Workers of this pool keep running tasks while they wait (which is what makes nested parallelism safe);
+// anybody else just sleeps.
+void ThreadPool::Wait(TaskGroup &g) {
+    if(_myPool == this) {
+	PoolTask t;
+	while(g.remaining > 0) {
+	    if(FindTask(_myWorker, t)) Run(_myWorker, t);
+	    else std::this_thread::yield();
+	}
+    }
+    std::unique_lock<std::mutex> lk(g.lock);
+    g.done.wait(lk, [&]{ return g.remaining == 0; });
+}
+
+void ThreadPool::WorkerLoop(int w) {
+    _myPool = this;
+    _myWorker = w;
+    PoolTask t;
+    for(;;) {
+	if(FindTask(w, t)) { Run(w, t); continue; }
+	std::unique_lock<std::mutex> lk(sleepLock);
+	wake.wait(lk, [&]{ return queued > 0 || stopping; });
+	if(stopping && queued == 0) return;
+    }
+}
+
+void ThreadPool::ParallelFor(long begin, long end, long grain, pPoolRangeFunc f, void *arg) {
+    if(end <= begin) return;
+    if(grain <= 0) { // aim for several pieces per worker so stealing can even out the load
+	grain = (end - begin) / (8*numWorkers);
+	if(grain < 1) grain = 1;
+    }
+    TaskGroup g;
+    PoolTask t;
+    t.range = f; t.task = NULL; t.begin = begin; t.end = end; t.grain = grain; t.arg = arg; t.group = &g;
+    g.remaining = 1;
+    Push(t);
+    Wait(g);
+}
+
+void ThreadPool::Submit(pPoolTaskFunc f, foint arg) {
+    PoolTask t;
+    t.range = NULL; t.task = f; t.arg = NULL; t.f = arg; t.group = &submitted;
+    submitted.remaining++;
+    Push(t);
+}
+
+void *ThreadPool::Scratch(int w, size_t size) {
+    assert(0 <= w && w < numWorkers);
+    Worker &v = workers[w];
+    if(size > v.scratchSize) {
+	v.scratch = realloc(v.scratch, size);
+	if(!v.scratch) Fatal("ThreadPoolScratch: out of memory allocating %lu bytes", (unsigned long)size);
+	v.scratchSize = size;
+    }
+    return v.scratch;
+}
+
+extern "C" {
+    THREAD_POOL *ThreadPoolAlloc(int numWorkers) { return (THREAD_POOL*)new ThreadPool(numWorkers); }
+
+    THREAD_POOL *ThreadPoolDefault(void) {
+	static ThreadPool *pool = new ThreadPool(0); // C++11 makes this initialization thread-safe
+	return (THREAD_POOL*)pool;
+    }
+
+    void ThreadPoolFree(THREAD_POOL *pool) { delete (ThreadPool*)pool; }
+    int ThreadPoolSize(const THREAD_POOL *pool) { return ((const ThreadPool*)pool)->Size(); }
+    int ThreadPoolWorker(void) { return _myWorker; }
+
+    void ThreadPoolParallelFor(THREAD_POOL *pool, long begin, long end, long grain, pPoolRangeFunc f, void *arg) {
+	((ThreadPool*)pool)->ParallelFor(begin, end, grain, f, arg);
+    }
+
+    void ThreadPoolSubmit(THREAD_POOL *pool, pPoolTaskFunc f, foint arg) { ((ThreadPool*)pool)->Submit(f, arg); }
+    void ThreadPoolWait(THREAD_POOL *pool) { ((ThreadPool*)pool)->Wait(); }
+    void *ThreadPoolScratch(THREAD_POOL *pool, int worker, size_t size) { return ((ThreadPool*)pool)->Scratch(worker, size); }
+}
@@ -0,0 +1,67 @@
+// This software is part of github.com/waynebhayes/libwayne, and is Copyright(C) Wayne B. Hayes 2025, under the GNU LGPL 3.0
+// (GNU Lesser General Public License, version 3, 2007), a copy of which is contained at the top of the repo.
+// This is NOT the header file that C code should include; that's thread-pool.h. This is used when compiling the C++ code.
+
+#include "misc.h"
+#include "thread-pool.h"
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Counts the outstanding tasks of one parallel-for or of all submitted tasks; Wait() returns when it hits zero.
+struct TaskGroup {
+    std::atomic<long> remaining;
+    std::mutex lock;
+    std::condition_variable done;
+    TaskGroup() : remaining(0) {}
+    void Finished(void);
+};
+
+struct PoolTask {
+    pPoolRangeFunc range; // exactly one of range and task is set
+    pPoolTaskFunc task;
+    long begin, end, grain;
+    void *arg;
+    foint f;
+    TaskGroup *group;
+};
+
+class ThreadPool {
+    public:
+	ThreadPool(int numWorkers);
+	~ThreadPool(void);
+	int Size(void) const { return numWorkers; }
+	void ParallelFor(long begin, long end, long grain, pPoolRangeFunc f, void *arg);
+	void Submit(pPoolTaskFunc f, foint arg);
+	void Wait(void) { Wait(submitted); }
+	void *Scratch(int worker, size_t size);
+
+    private:
+	struct Worker {
+	    std::mutex lock; // owner pushes and pops at the back, thieves take from the front
+	    std::deque<PoolTask> tasks;
+	    void *scratch;
+	    size_t scratchSize;
+	    Worker() : scratch(NULL), scratchSize(0) {}
+	};
+	int numWorkers;
+	Worker *workers;
+	std::vector<std::thread> threads;
+	std::atomic<long> queued; // tasks sitting in any deque; sleepers wait for this to go positive
+	std::atomic<unsigned> nextQueue; // round-robin target for tasks pushed from outside the pool
+	std::mutex sleepLock;
+	std::condition_variable wake;
+	bool stopping;
+	TaskGroup submitted;
+
+	void Push(const PoolTask &t);
+	bool Pop(int w, PoolTask &t);
+	bool Steal(int w, PoolTask &t);
+	bool FindTask(int w, PoolTask &t) { return Pop(w, t) || Steal(w, t); }
+	void Run(int w, PoolTask &t);
+	void Wait(TaskGroup &g);
+	void WorkerLoop(int w);
+};
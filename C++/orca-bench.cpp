@@ -0,0 +1,70 @@
+// This software is part of github.com/waynebhayes/libwayne, and is Copyright(C) Wayne B. Hayes 2025, under the GNU LGPL 3.0
+// (GNU Lesser General Public License, version 3, 2007), a copy of which is contained at the top of the repo.
+// Benchmark ORCA's graphlet counting: wall time and peak RSS of one run.  "make orca-bench" builds two binaries,
+// orca-bench-std (common2/common3 as std::unordered_map, ie. -DORCA_STD_MAPS=1) and orca-bench-flat (FlatCounter);
+// peak RSS is per process, so compare them by running each separately on the same input.
+//
+// USAGE: orca-bench [-t threads] {edgeFile | n m} [4|5]
+//    edgeFile is in ORCA's input format ("n m" followed by m lines "u v" with 0<=u,v<n); otherwise a random
+//    G(n,m) graph is generated with a fixed seed.  The last line printed is a checksum of all the orbit counts.
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <set>
+#include <random>
+#include <chrono>
+#include <sys/time.h>
+#include <sys/resource.h>
+#include "SanaGraphBasis/utils/computeGraphlets.hpp"
+
+static FILE *RandomGraph(int n, int m) {
+    std::mt19937 rng(1);
+    std::set<std::pair<int,int>> edges;
+    if (m > (long long)n*(n-1)/2) { fprintf(stderr, "too many edges for %d nodes\n", n); exit(1); }
+    while ((int)edges.size() < m) {
+	int a = rng()%n, b = rng()%n;
+	if (a == b) continue;
+	edges.insert(std::make_pair(std::min(a,b), std::max(a,b)));
+    }
+    FILE *fp = tmpfile();
+    fprintf(fp, "%d %d\n", n, m);
+    for (const auto &e : edges) fprintf(fp, "%d %d\n", e.first, e.second);
+    rewind(fp);
+    return fp;
+}
+
+int main(int argc, char *argv[]) {
+    int threads = 0, k = 5;
+    if (argc > 2 && strcmp(argv[1], "-t") == 0) { threads = atoi(argv[2]); argc -= 2; argv += 2; }
+    FILE *fp;
+    if (argc >= 3 && strspn(argv[1], "0123456789") == strlen(argv[1])) { // n m
+	fp = RandomGraph(atoi(argv[1]), atoi(argv[2]));
+	if (argc > 3) k = atoi(argv[3]);
+    }
+    else if (argc >= 2) {
+	fp = fopen(argv[1], "r");
+	if (argc > 2) k = atoi(argv[2]);
+    }
+    else {
+	fprintf(stderr, "USAGE: orca-bench [-t threads] {edgeFile | n m} [4|5]\n");
+	return 1;
+    }
+    if (!fp) { perror(argv[1]); return 1; }
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::vector<uint>> gdv = computeGraphletsSource::computeGraphlets(k, fp, threads);
+    double sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    struct rusage ru;
+    getrusage(RUSAGE_SELF, &ru);
+    unsigned long long h = 1469598103934665603ULL; // FNV-1a over all orbit counts
+    for (const auto &v : gdv) for (uint x : v) { h ^= x; h *= 1099511628211ULL; }
+#if ORCA_STD_MAPS
+    const char *maps = "unordered_map";
+#else
+    const char *maps = "FlatCounter";
+#endif
+    printf("count%d with %s: %.3f sec wall, peak RSS %ld MB\n", k, maps, sec, ru.ru_maxrss/1024);
+    printf("checksum %llx\n", h);
+    return 0;
+}
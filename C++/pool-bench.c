@@ -0,0 +1,99 @@
+// This software is part of github.com/waynebhayes/libwayne, and is Copyright(C) Wayne B. Hayes 2025, under the GNU LGPL 3.0
+// (GNU Lesser General Public License, version 3, 2007), a copy of which is contained at the top of the repo.
+// Microbenchmark of per-task overhead: a thread per task (what ThreadSetRunAll used to do) vs. the thread pool.
+// Usage: pool-bench [numTasks [numWorkers]]
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <pthread.h>
+#include "misc.h"
+#include "thread-sets.h"
+#include "thread-pool.h"
+
+static double Now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + 1e-9*ts.tv_nsec;
+}
+
+static long _sum[1024]; // per worker, so no locking needed
+
+static void *PthreadTask(void *arg) { _sum[0] += (long)arg; return arg; }
+static foint AsyncTask(const foint f) { return f; }
+static void SubmitTask(int worker, foint f) { _sum[worker] += f.l; }
+static void RangeTask(int worker, long begin, long end, void *arg) {
+    long i, *scratch = ThreadPoolScratch((THREAD_POOL*)arg, worker, sizeof(long));
+    for(i=begin; i<end; i++) *scratch += i;
+    _sum[worker] = *scratch;
+}
+static void NestedTask(int worker, long begin, long end, void *arg) {
+    long i;
+    for(i=begin; i<end; i++) ThreadPoolParallelFor((THREAD_POOL*)arg, 0, 100, 1, RangeTask, arg);
+}
+
+static long SumAndClear(THREAD_POOL *pool) {
+    long total = 0;
+    int w;
+    for(w=0; w<ThreadPoolSize(pool); w++) {
+	total += _sum[w];
+	_sum[w] = 0;
+	*(long*)ThreadPoolScratch(pool, w, sizeof(long)) = 0; // NOTE: only safe because the pool is idle
+    }
+    return total;
+}
+
+#define REPORT(name, n, t) printf("%-28s %10.1f ns/task\n", name, 1e9*(t)/(n))
+
+int main(int argc, char *argv[]) {
+    long i, n = argc > 1 ? atol(argv[1]) : 100000;
+    int numWorkers = argc > 2 ? atoi(argv[2]) : 0;
+    THREAD_POOL *pool = ThreadPoolAlloc(numWorkers);
+    assert(ThreadPoolSize(pool) <= 1024);
+    printf("%d workers, %ld tasks\n", ThreadPoolSize(pool), n);
+    double t;
+
+    long nThreads = n < 10000 ? n : 10000; // creating 100k threads takes a while
+    t = Now();
+    for(i=0; i<nThreads; i++) {
+	pthread_t th;
+	pthread_create(&th, NULL, PthreadTask, (void*)i);
+	pthread_join(th, NULL);
+    }
+    REPORT("pthread_create+join", nThreads, Now()-t);
+    SumAndClear(pool);
+
+    foint *inputs = Malloc(n*sizeof(foint));
+    for(i=0; i<n; i++) inputs[i].l = i;
+    THREAD_SET *ts = ThreadSetAlloc(AsyncTask, n, inputs);
+    t = Now();
+    foint *out = ThreadSetRunAll(ts);
+    REPORT("ThreadSetRunAll", n, Now()-t);
+    for(i=0; i<n; i++) assert(out[i].l == i);
+    ThreadSetFree(ts);
+    Free(inputs);
+
+    const long expect = n*(n-1)/2;
+    t = Now();
+    for(i=0; i<n; i++) { foint f; f.l = i; ThreadPoolSubmit(pool, SubmitTask, f); }
+    ThreadPoolWait(pool);
+    REPORT("ThreadPoolSubmit+Wait", n, Now()-t);
+    assert(SumAndClear(pool) == expect);
+
+    t = Now();
+    ThreadPoolParallelFor(pool, 0, n, 1, RangeTask, pool);
+    REPORT("ThreadPoolParallelFor grain 1", n, Now()-t);
+    SumAndClear(pool);
+
+    t = Now();
+    ThreadPoolParallelFor(pool, 0, n, 0, RangeTask, pool);
+    REPORT("ThreadPoolParallelFor auto", n, Now()-t);
+    assert(SumAndClear(pool) == expect);
+
+    t = Now();
+    ThreadPoolParallelFor(pool, 0, n/100, 1, NestedTask, pool);
+    REPORT("nested ParallelFor grain 1", n/100*100, Now()-t);
+    SumAndClear(pool);
+
+    ThreadPoolFree(pool);
+    return 0;
+}
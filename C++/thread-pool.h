@@ -0,0 +1,44 @@
+// This software is part of github.com/waynebhayes/libwayne, and is Copyright(C) Wayne B. Hayes 2025, under the GNU LGPL 3.0
+// (GNU Lesser General Public License, version 3, 2007), a copy of which is contained at the top of the repo.
+/*
+** A persistent pool of worker threads, for C code that wants to run many small pieces of work in parallel
+** without paying for thread creation each time. Each worker has its own deque of tasks; it works LIFO off
+** its own and, when that's empty, steals FIFO from the others, so a parallel loop keeps all the workers busy
+** even when its chunks take very different amounts of time.
+**
+** Workers are numbered 0..ThreadPoolSize()-1, and that number is passed to every callback so it can index
+** per-worker data (eg. ThreadPoolScratch) without locking. Callbacks may themselves call ThreadPoolParallelFor
+** or ThreadPoolSubmit/Wait: a worker that waits runs other tasks rather than blocking.
+*/
+
+typedef void THREAD_POOL;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "misc.h"
+
+typedef void (*pPoolRangeFunc)(int worker, long begin, long end, void *arg); // process indices [begin,end)
+typedef void (*pPoolTaskFunc)(int worker, foint arg);
+
+THREAD_POOL *ThreadPoolAlloc(int numWorkers); // numWorkers <= 0 means one per CPU
+THREAD_POOL *ThreadPoolDefault(void); // a shared pool with one worker per CPU, created on first use; never free it
+void         ThreadPoolFree(THREAD_POOL *pool); // waits for submitted tasks, then stops the workers
+int          ThreadPoolSize(const THREAD_POOL *pool);
+int          ThreadPoolWorker(void); // the calling thread's worker number in whatever pool it belongs to; -1 if none
+
+// Call f on consecutive sub-ranges of [begin,end) of at most grain indices each (grain <= 0: pick one
+// automatically), in parallel, and return when all are done.
+void ThreadPoolParallelFor(THREAD_POOL *pool, long begin, long end, long grain, pPoolRangeFunc f, void *arg);
+
+void ThreadPoolSubmit(THREAD_POOL *pool, pPoolTaskFunc f, foint arg); // queue f(worker,arg) and return immediately
+void ThreadPoolWait(THREAD_POOL *pool); // wait until every task submitted so far has finished
+
+// At least size bytes that belong to the given worker and persist between calls (contents are kept when it
+// doesn't need to grow). Only call it for your own worker number.
+void *ThreadPoolScratch(THREAD_POOL *pool, int worker, size_t size);
+
+#ifdef __cplusplus
+}
+#endif
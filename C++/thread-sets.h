@@ -4,6 +4,8 @@
 ** This little library allows you to do "lightweight threadding" by splitting calls to the same function among multiple
 ** You specify a function pointer, the number of threads, and an array of foint inputs[numThreads].
 ** The function should take just one foint as argument, and return one foint.
+** The calls run on the persistent workers of ThreadPoolDefault() (see thread-pool.h), so numThreads may exceed
+** the number of CPUs, but no more than one call per worker runs at a time.
 */
 
 typedef void THREAD_SET;
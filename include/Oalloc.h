@@ -6,6 +6,8 @@ extern "C" {
 #ifndef _OALLOC_H
 #define _OALLOC_H
 #include <sys/types.h>
+#include <stddef.h>
+#include <stdint.h>
 
 /*
 Oalloc library: these functions are best used when you need to
@@ -28,6 +30,10 @@ Orealloc can't be implemented, because we don't know the size of the old
 storage, so we don't know how much to copy over, and just copying over
 the new space may result in memory faults while reading past the end of
 the old space.
+
+Omalloc, Ocalloc and Ofree work on one ARENA (below) shared by all
+threads, behind a lock, so Ofree frees every thread's objects.  For
+objects private to a thread, use an ARENA of its own instead.
 */
 
 void *Omalloc(unsigned n);
@@ -35,6 +41,87 @@ void *Ocalloc(unsigned n, size_t s);
 
 void Ofree(void);   /* note there are no arguments */
 
+
+/*
+ARENA: the same idea with an explicit handle, so you can have as many as
+you like with different lifetimes.  An ARENA isn't locked: use each one
+from one thread at a time (eg. one per thread, or one per data structure
+that's already locked).  Allocations are aligned for any type, like malloc.
+
+ArenaMark and ArenaRewind free everything allocated since the mark, and
+ArenaReset everything; the memory is kept for reuse until ArenaFree.
+
+An arena allocated with ARENA_SIZE_CLASSES can also take back single
+objects of up to ARENA_MAX_CLASS bytes with ArenaRelease, giving the size
+you allocated; ArenaMalloc then reuses them for objects of about the same
+size.  (Releasing is O(1), but the memory goes back to the arena, not the
+system.)  Rewinding or resetting empties the free lists.
+*/
+
+#ifdef __cplusplus
+#define ARENA_ALIGN alignof(max_align_t)
+#else
+#define ARENA_ALIGN _Alignof(max_align_t)
+#endif
+#define ARENA_SIZE_CLASSES 1	/* flag for ArenaAlloc */
+#define ARENA_MAX_CLASS 256	/* largest object ArenaRelease will keep */
+
+typedef struct _arena {
+    char *next, *end;	/* the unused part of the current chunk */
+    struct _arenaChunk *chunk;	/* the current chunk, which links to the earlier ones */
+    struct _arenaChunk *spare;	/* chunks freed by ArenaRewind, kept for reuse */
+    size_t chunkSize, nextChunkSize;	/* chunks start small and double up to chunkSize */
+    void **freeList;	/* ARENA_SIZE_CLASSES only: freeList[c] holds objects of ARENA_ALIGN*(c+1) bytes */
+} ARENA;
+
+typedef struct _arenaMark { struct _arenaChunk *chunk; char *next; } ARENA_MARK;
+
+ARENA *ArenaAlloc(size_t chunkSize, int flags); /* chunkSize 0 means the default, 64kB */
+void ArenaFree(ARENA *a);
+void ArenaReset(ARENA *a);
+ARENA_MARK ArenaMark(ARENA *a);
+void ArenaRewind(ARENA *a, ARENA_MARK mark);
+void *ArenaCalloc(ARENA *a, size_t n, size_t size);
+char *ArenaStrdup(ARENA *a, const char *s); /* packed, not aligned */
+void ArenaRelease(ARENA *a, void *p, size_t n); /* a no-op unless ARENA_SIZE_CLASSES */
+
+void *ArenaMallocSlow(ARENA *a, size_t n, size_t align); /* for the inline functions below: start a new chunk */
+
+/* align must be a power of 2 */
+static inline void *ArenaMallocAligned(ARENA *a, size_t n, size_t align)
+{
+    if(n == 0) n = 1; /* so a zero-byte object is still a real pointer, distinct from the next one */
+    uintptr_t p = ((uintptr_t)a->next + align-1) & ~(uintptr_t)(align-1);
+    if(p + n <= (uintptr_t)a->end) {
+	a->next = (char*)p + n;
+	return (void*)p;
+    }
+    return ArenaMallocSlow(a, n, align);
+}
+
+static inline void *ArenaMalloc(ARENA *a, size_t n)
+{
+    if(a->freeList && n && n <= ARENA_MAX_CLASS) {
+	void **head = &a->freeList[(n-1)/ARENA_ALIGN], *p = *head;
+	if(p) {
+	    *head = *(void**)p;
+	    return p;
+	}
+	n = ((n-1)/ARENA_ALIGN + 1) * ARENA_ALIGN; /* the whole size class, so anything in the class fits when it's reused */
+    }
+    return ArenaMallocAligned(a, n, ARENA_ALIGN);
+}
+
+/* The calling thread's own arena, with size classes, created on first use.
+** It's for objects that are released one at a time (Ofree doesn't touch it),
+** and only by the same thread, since an ARENA isn't locked.  It's freed when
+** the thread exits, so don't hand its objects to anything that outlives it.
+*/
+extern __thread ARENA *_arenaThread;
+ARENA *ArenaThreadInit(void);
+#define ArenaThread() (_arenaThread ? _arenaThread : ArenaThreadInit())
+void ArenaThreadFree(void); /* free it sooner, once nothing it allocated is in use */
+
 #endif /* _OALLOC_H */
 #ifdef __cplusplus
 } // end extern "C"
@@ -10,6 +10,7 @@ extern "C" {
 #include <stdio.h>
 #include <stdint.h>
 #include "misc.h"   /* for foint */
+#include "Oalloc.h"
 
 #if __GNUC__ <= 5 // POSIX rwlock doesn't work in GCC 5.x
 #define AVL_MUTEX_ONLY
@@ -36,6 +37,14 @@ const char getBalance(AVLTREENODE* node);
 
 void setBalance(AVLTREENODE* node, char balance);
 
+/*
+** Writers lock the tree, but lookups normally don't: they read optimistically, and check the tree's sequence
+** number (which writers make odd while they're at it) to see if a writer got in the way, in which case they
+** try again, and eventually lock.  So lookups don't write to anything shared, and scale with the number of threads.
+** Deleted nodes (and their keys and info) aren't freed until no lookup that started before the delete is still
+** running, so your cmpKey never sees a freed key.  Set optimistic to false (before the tree is shared) if
+** lookups should always lock, eg. because your cmpKey has side effects.  Traversals always lock.
+*/
 typedef struct _avlTree
 {
     unsigned n; // total number of entries in the tree
@@ -43,6 +52,11 @@ typedef struct _avlTree
     pCmpFcn cmpKey;
     pFointCopyFcn copyKey, copyInfo;
     pFointFreeFcn freeKey, freeInfo;
+    ARENA *nodes; // where the AVLTREENODEs come from; only touched while writing
+    unsigned seq; // odd while a writer is changing the tree
+    Boolean optimistic; // true (the default) if lookups don't lock
+    struct _avlRetired *retired; // deleted nodes that lookups may still be looking at
+    unsigned numRetired, maxRetired, reclaimAt;
 #ifdef AVL_MUTEX_ONLY
     pthread_mutex_t readLock, globalLock;
     int blockingReaders;
@@ -9,6 +9,7 @@ extern "C" {
 #include <malloc.h>
 #include <stdio.h>
 #include "misc.h"   /* for foint */
+#include "Oalloc.h"
 
 
 /*-------------------  Types  ------------------*/
@@ -27,6 +28,7 @@ typedef struct _binTree
     pCmpFcn cmpKey;
     pFointCopyFcn copyKey, copyInfo;
     pFointFreeFcn freeKey, freeInfo;
+    ARENA *nodes; // where the BINTREENODEs come from
 } BINTREE;
 
 /*-----------   Function Prototypes  -----------*/
@@ -0,0 +1,92 @@
+// This software is part of github.com/waynebhayes/libwayne, and is Copyright(C) Wayne B. Hayes 2025, under the GNU LGPL 3.0
+// (GNU Lesser General Public License, version 3, 2007), a copy of which is contained at the top of the repo.
+#ifdef __cplusplus
+extern "C" {
+#endif
+#ifndef _BPTREE_H
+#define _BPTREE_H
+
+#include <stdio.h>
+#include "misc.h"   /* for foint */
+#include "Oalloc.h"
+
+/*
+** BPTREE: a B+-tree with the same interface as BINTREE and AVLTREE (see tree.h to make it the TREETYPE).
+** Instead of one node per key, each node holds up to BPTREE_ORDER keys (foints, stored inline) in an array
+** that fills exactly BPTREE_ORDER/8 cache lines, so a lookup touches a handful of cache lines per level
+** and there are only log_16(n) or so levels.  The data is all in the leaves, which are linked in order,
+** so traversals and range queries just walk along the leaves.
+**
+** A NULL cmpKey compares the keys' .i (like the other trees), and cmpKey == strcmp is called directly;
+** both are faster than going through a pointer to your own function.
+**
+** Deleting just takes the key out of its leaf, without merging leaves that get small; once the tree
+** is down to an eighth full, it's rebuilt from scratch (which is O(n), like BinTreeRebalance).
+*/
+
+#define BPTREE_ORDER 32	/* keys per node */
+
+/*-------------------  Types  ------------------*/
+
+typedef struct _bpTreeNode
+{
+    foint key[BPTREE_ORDER];	/* first, so it starts on a cache line */
+    unsigned short n;	/* keys in use; an internal node has n+1 children */
+    Boolean leaf;
+    union {
+	struct _bpTreeNode *child[BPTREE_ORDER+1];	/* internal: child[i] has the keys in [key[i-1], key[i]) */
+	struct { foint info[BPTREE_ORDER]; struct _bpTreeNode *next; } l;	/* leaf: next is the leaf after this one */
+    } u;
+} BPTREENODE;
+
+typedef struct _bpTree
+{
+    unsigned n, depth;	/* number of entries, and levels of internal nodes above the leaves */
+    unsigned leaves, internals;	/* nodes in use */
+    BPTREENODE *root, *first;	/* first is the leftmost leaf */
+    pCmpFcn cmpKey;
+    pFointCopyFcn copyKey, copyInfo;	/* internal nodes keep their own copies of the keys they need */
+    pFointFreeFcn freeKey, freeInfo;
+    ARENA *nodes;	/* where the nodes come from; they're only given back all at once */
+} BPTREE;
+
+/*-----------   Function Prototypes  -----------*/
+
+BPTREE *BpTreeAlloc(pCmpFcn cmpKey, pFointCopyFcn copyKey, pFointFreeFcn freeKey,
+	    pFointCopyFcn copyInfo, pFointFreeFcn freeInfo);
+
+/* Insert n entries with keys in strictly increasing order into an empty tree, in O(n); the leaves come out full. */
+void BpTreeBulkLoad(BPTREE *, unsigned n, foint keys[], foint info[]);
+
+void BpTreeInsert(BPTREE *, foint key, foint info); // replaces info if the key already exists
+/*
+** UnsafeBpTreeInsert: returns a foint* so that you can modify the inserted element without
+** having to insert it again. Use this with care and disregard the result as soon as you're done with it,
+** as the pointer becomes invalid at the next insertion or deletion.
+*/
+foint* const UnsafeBpTreeInsert(BPTREE *, foint key, foint info);
+
+Boolean BpTreeLookDel(BPTREE *, foint key, foint *pInfo);
+/*
+** UnsafeBpTreeLookDel: returns a foint* so that you can modify the element at key without having to re-insert it,
+** or NULL upon deletion or if no element is found. The same caveats as UnsafeBpTreeInsert apply.
+*/
+foint* const UnsafeBpTreeLookDel(BPTREE *tree, foint key, Boolean delete);
+#define BpTreeLookup(t,k,p) BpTreeLookDel((t),(k),(p))
+#define BpTreeDelete(t,k)   BpTreeLookDel((t),(k),(foint*)1)
+
+/*
+** BpTreeTraverse: call your function on each element, in order. It should return 1 to continue, 0 to stop,
+** and -1 to DELETE the current element. It returns 0 or 1 as returned by your function.
+** BpTreeTraverseRange does the same, but only for keys k with lo <= k < hi.
+*/
+int BpTreeTraverse(foint globals, BPTREE *, pFointTraverseFcn);
+int BpTreeTraverseRange(foint globals, BPTREE *, foint lo, foint hi, pFointTraverseFcn);
+
+Boolean BpTreeSanityCheck(BPTREE *); // returns true if success, otherwise generates an assertion failure
+void BpTreeFree(BPTREE *);
+
+#endif  /* _BPTREE_H */
+#ifdef __cplusplus
+} // end extern "C"
+#endif
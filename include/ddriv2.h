@@ -23,8 +23,6 @@ extern "C" {
 **
 */
 
-typedef double (*G_EVAL)(int N, double T, double *Y, int IROOT);
-
 typedef struct _ddriv2
 {
     int N, MSTATE, NROOT, MINT, LW, *IW, LIW, whichRoot;
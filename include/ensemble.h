@@ -0,0 +1,68 @@
+// This software is part of github.com/waynebhayes/libwayne, and is Copyright(C) Wayne B. Hayes 2025, under the GNU LGPL 3.0
+// (GNU Lesser General Public License, version 3, 2007), a copy of which is contained at the top of the repo.
+#ifdef __cplusplus
+extern "C" {
+#endif
+#ifndef _ENSEMBLE_H
+#define _ENSEMBLE_H
+
+#include "misc.h"
+#include "f_eval.h"
+
+/*
+** Integrate M copies ("members") of the same N-dimensional ODE at once, eg. thousands of initial conditions or
+** parameter values. Rather than one F_EVAL call per member per stage, the derivative is computed for every
+** member in one call, and the state is kept as a structure of arrays: component i of member m is
+** Y[i*M + m]. Each stage is then a loop over m with unit stride, which the compiler vectorizes, and a
+** well-written F_EVAL_BATCH can do the same.
+**
+** ENSEMBLE_RK4:  classical RK4 with a fixed timestep; all members share T.
+** ENSEMBLE_RK23: Bogacki-Shampine 2(3) with a separate adaptive step for each member. Members advance in
+**		  lockstep (one F call per stage for everyone), but each has its own T[m] and H[m]; a member whose
+**		  step is rejected, or that has already reached TOUT, takes a step of size 0 that round.
+*/
+
+/*
+** T[m] is the time of member m. Ydot has the same layout as Y. arg is passed through from EnsembleAlloc,
+** typically an array of per-member parameters. Members that are idle this stage are still passed in
+** (with their current state), so F must not mind being called on them.
+*/
+typedef void (*F_EVAL_BATCH)(int N, int M, const double *T, const double *Y, double *Ydot, void *arg);
+
+typedef enum { ENSEMBLE_RK4, ENSEMBLE_RK23 } ENSEMBLE_METHOD;
+
+typedef struct _ensemble {
+    ENSEMBLE_METHOD method;
+    int N, M;
+    double *Y; // the caller's N*M state, updated in place
+    double *T, *H; // per member: time, and the next step to try
+    double TOL, HMIN, HMAX; // RK23's tolerance and step limits (0 and infinity by default; set them after Alloc)
+    F_EVAL_BATCH F;
+    void *arg;
+    double *work; // stage vectors
+    long nEval, nAccept, nReject; // counted per member (nEval counts F calls, each of which covers all members)
+} ENSEMBLE;
+
+/*
+** dt is the timestep for RK4, or the first step to try for RK23. tol is ignored by RK4; for RK23 each
+** component's local error must be below tol*max(1,|y|).
+*/
+ENSEMBLE *EnsembleAlloc(ENSEMBLE_METHOD method, int n, int m, double t, double *y, F_EVAL_BATCH f, void *arg,
+    double dt, double tol);
+double EnsembleIntegrate(ENSEMBLE *e, double tout); // advance every member to tout; returns tout
+void EnsembleFree(ENSEMBLE *e);
+
+// Copy member m out of, or into, the structure-of-arrays block.
+void EnsembleGetMember(const ENSEMBLE *e, int m, double *y);
+void EnsembleSetMember(ENSEMBLE *e, int m, const double *y);
+
+/*
+** An F_EVAL_BATCH that calls an ordinary F_EVAL on each member in turn, so an existing system can be run as
+** an ensemble before it's rewritten in batch form. Pass a pointer to the F_EVAL as arg.
+*/
+void EnsembleScalarF(int N, int M, const double *T, const double *Y, double *Ydot, void *arg);
+
+#endif  /* _ENSEMBLE_H */
+#ifdef __cplusplus
+} // end extern "C"
+#endif
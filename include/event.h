@@ -41,6 +41,43 @@ EventInfo *EventNext(void);
 extern Time _event_now;
 #define EventNow() _event_now
 
+
+/*
+** EVENT_LIST: an independent event list, as many as you like, each with its own
+** clock.  It's a calendar queue (R. Brown, CACM 31(10), 1988): events are hashed
+** by time into an array of "day" buckets, each a short sorted list, and the
+** number and width of the days follow the number of pending events and their
+** spacing, so both insert and next are O(1) amortized rather than the heap's
+** O(log n).  Events scheduled for the same time run in the order they were
+** inserted.  EventInfo records come from a pool owned by the list, so
+** EventListNext recycles them itself: don't free them.
+*/
+typedef struct _eventList EVENT_LIST;
+
+/* Records are reused, so a handle carries the generation of the record it was
+** given for, and goes stale when that event runs or is cancelled.
+*/
+typedef struct { EventInfo *info; unsigned gen; } EVENT_HANDLE;
+
+EVENT_LIST *EventListAlloc(void);
+void EventListFree(EVENT_LIST *L);
+
+/* Schedule event(object) at EventListNow(L) + delta.  The returned handle is
+** only good for EventListCancel.
+*/
+EVENT_HANDLE EventListInsert(EVENT_LIST *L, Event event, Time delta, Object object);
+
+/* Remove a pending event; returns 0 if it had already run or been cancelled,
+** even if its record now holds a newer event.
+*/
+int EventListCancel(EVENT_LIST *L, EVENT_HANDLE handle);
+
+/* Advance the clock to the next event and run it; returns 0 if there were none. */
+int EventListNext(EVENT_LIST *L);
+
+Time EventListNow(EVENT_LIST *L);
+int EventListSize(EVENT_LIST *L); /* number of pending events */
+
 #endif  /* _EVENT_H */
 #ifdef __cplusplus
 } // end extern "C"
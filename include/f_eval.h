@@ -12,6 +12,9 @@ typedef void (*F_EVAL)(int N, double T, double *Y, double *Ydot);
 /* Long Double (== Fortran's QUAD or REAL*16 on Suns, or 12-byte on i686) */
 typedef void (*LD_EVAL)(int N, long double T, long double *Y, long double *Ydot);
 
+/* Root (event) functions: integrators that support root finding stop where one of these changes sign */
+typedef double (*G_EVAL)(int N, double T, double *Y, int IROOT);
+
 #endif  /* _F_EVAL_H */
 #ifdef __cplusplus
 } // end extern "C"
@@ -11,6 +11,7 @@ extern "C" {
 #include "combin.h"
 #include <stdio.h>
 #include "tree.h" // to support node names
+#include "Oalloc.h"
 
 #define SORT_NEIGHBORS 0 // Thought this might speed things up but it appears not to.
 
@@ -35,6 +36,7 @@ typedef struct _Graph {
     Boolean supportNodeNames;
     TREETYPE *nameDict;	// string to int map
     char **name;	// int to string map (inverse of the above)
+    ARENA *nameArena;	// if non-NULL, the name strings all live here (and are the nameDict keys)
     GraphEdgeWeightFn edgeWeightFn; // optional callback supplying computed edge weights
 } GRAPH;
 
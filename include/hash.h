@@ -18,7 +18,7 @@ extern "C" {
 #define HASH_OMEM -1     /* Out of Memory */
 #define HASH_OK 0    /* OK */
 
-typedef int (*PFhash_t)(int key, foint data); // a function of this type is called during HashIterate
+typedef int (*PFhash_t)(int key, foint data); // a function of this type is called during HashIterate; return HASH_OK to continue
 
 typedef struct _hashtype
 {
@@ -37,7 +37,11 @@ Boolean HashGet(HASH*, int key, foint *f);
 Boolean HashGetOne(HASH*, int *keyp, Boolean del);
 
 Boolean HashDelete(HASH*, int key);
-int	HashIterate(HASH*, PFhash_t);
+int	HashIterate(HASH*, PFhash_t); // returns HASH_OK, or whatever else your function returned to stop it
+
+// HashNext steps through the elements without a callback: start with *iter = 0; it returns false when
+// there are no more.  Don't insert or delete in the meantime.
+Boolean HashNext(HASH*, int *iter, int *keyp, foint *f);
 
 #endif  /* _HASH_H */
 #ifdef __cplusplus
@@ -12,6 +12,12 @@ extern "C" {
 // The hierarchy has a fixed depth, and when you insert or lookup an element, you specify a depth you wish to go,
 // and an array of keys with length equal to the depth you're searching.
 // Both keys and data are foints; the user is responsible for knowing what's actually stored.
+//
+// HTreeAllocFlat makes an HTREE that works the same way but isn't a tree at all: the whole key path is hashed
+// into one open-addressing table, so an insert or lookup is one probe sequence rather than a search at each
+// level, and nothing's allocated per level.  A second table keeps, for each prefix of the path, the number of
+// keys below it (which is all HTreeSizes needs).  HTreeTraverse is the only ordered thing you can do with it,
+// and sorts the entries to do so; deleting a sub-tree (UnsafeHTreeLookDel with a targetDepth) scans the table.
 
 #include "tree.h" // switches between AVL and BINTREE
 
@@ -25,6 +31,9 @@ typedef struct _hTree
     pFointCopyFcn copyKey, copyInfo;
     pFointFreeFcn freeKey, freeInfo;
     int n; // total number of elements across all sub-trees.
+    pFointHashFcn hashKey; // the rest are only for HTreeAllocFlat, which leaves tree NULL
+    struct _hTreeTable *paths, *prefixes; // keys[] -> info, and keys[0..L) -> number of distinct keys[L] below it
+    int topN; // number of distinct keys[0]
 } HTREE;
 
 /*-----------   Function Prototypes  -----------*/
@@ -32,6 +41,13 @@ typedef struct _hTree
 HTREE *HTreeAlloc(unsigned char depth, pCmpFcn cmpKey, pFointCopyFcn copyKey, pFointFreeFcn freeKey,
     pFointCopyFcn copyInfo, pFointFreeFcn freeInfo);
 
+/*
+** hashKey must agree with cmpKey (keys that compare equal hash the same); it can be NULL if cmpKey is NULL
+** (compare .i) or strcmp, for which there are built-in hashes.
+*/
+HTREE *HTreeAllocFlat(unsigned char depth, pFointHashFcn hashKey, pCmpFcn cmpKey, pFointCopyFcn copyKey,
+    pFointFreeFcn freeKey, pFointCopyFcn copyInfo, pFointFreeFcn freeInfo);
+
 // keys is an array with exactly "depth" elements, info is what you want to put at the lowest level.
 void HTreeInsert(HTREE *, foint keys[], foint info);
 /*
@@ -50,6 +66,7 @@ Boolean HTreeLookDel(HTREE *, foint keys[], foint *pInfo);
 ** would instead point to a TREETYPE*) by targeting a depth besides the lowest level,
 ** although a targetDepth of 0 will default to the lowest level. Use this with care and disregard
 ** the result as soon as you're done with it, as the pointer could later become invalid.
+** (A flat HTREE has no sub-trees, so looking one up instead points to the number of keys directly below it.)
 */
 foint* const UnsafeHTreeLookDel(HTREE *, foint keys[], unsigned char targetDepth, Boolean delete);
 #define HTreeLookup(h,k,p) HTreeLookDel((h),(k),(p))
@@ -59,6 +76,14 @@ foint* const UnsafeHTreeLookDel(HTREE *, foint keys[], unsigned char targetDepth
 // which should be equal to depth.
 int HTreeSizes(HTREE *, foint keys[], int sizes[]);
 
+/*
+** HTreeTraverse: call your function on every element, in order of keys[0], then keys[1], and so on.
+** It should return 1 to continue and 0 to stop (don't change the HTREE meanwhile); HTreeTraverse returns
+** what your function last did.
+*/
+typedef int (*pHTreeTraverseFcn)(foint globals, foint keys[], foint info);
+int HTreeTraverse(foint globals, HTREE *, pHTreeTraverseFcn);
+
 void HTreeFree(HTREE *);
 
 #endif  /* _HTREE_H */
@@ -0,0 +1,57 @@
+// This software is part of github.com/waynebhayes/libwayne, and is Copyright(C) Wayne B. Hayes 2025, under the GNU LGPL 3.0
+// (GNU Lesser General Public License, version 3, 2007), a copy of which is contained at the top of the repo.
+#ifdef __cplusplus
+extern "C" {
+#endif
+#ifndef _IHEAP_H
+#define _IHEAP_H
+
+/*
+** Indexed heap: a smallest-at-top priority queue of items 0..maxItems-1 (eg. node numbers in Dijkstra's
+** algorithm), each with a key, where you can change the key of an item already in the heap, or delete it,
+** in O(log n) instead of inserting duplicates. Unlike HEAP there's no comparison function: the keys are
+** stored inline next to their items, and compared directly.
+** It's 4-ary rather than binary: half as deep, and the four children of a node share one 64-byte cache
+** line, so each level of a sift down costs one cache miss rather than two.
+**
+** Keys are doubles, or use the U64 functions to give them as unsigned 64-bit integers; but don't mix the two
+** in one heap. (Doubles are stored as integers that order the same way, so comparisons are integer ones.)
+*/
+
+#include "misc.h"
+
+typedef struct _iheapEntry { uint64_t key; int item; } IHEAP_ENTRY;
+
+typedef struct _iheap {
+    int n, maxItems;
+    IHEAP_ENTRY *heap; // heap[0..n-1], cache-line aligned so siblings share a line
+    int *pos; // pos[item] is where item is in heap[], or -1 if it's not in the heap
+    void *space; // what heap points into
+} IHEAP;
+
+IHEAP *IHeapAlloc(int maxItems);
+void IHeapFree(IHEAP *h);
+void IHeapReset(IHEAP *h); // make it empty
+int IHeapSize(IHEAP *h);
+Boolean IHeapContains(IHEAP *h, int item);
+
+void IHeapInsert(IHEAP *h, int item, double key); // item must not already be in the heap
+void IHeapChangeKey(IHEAP *h, int item, double key); // increase or decrease; item must be in the heap
+void IHeapInsertOrChange(IHEAP *h, int item, double key);
+double IHeapKey(IHEAP *h, int item); // item must be in the heap
+int IHeapPeek(IHEAP *h); // the item with the smallest key; the heap must not be empty
+double IHeapPeekKey(IHEAP *h);
+int IHeapNext(IHEAP *h); // remove and return the item with the smallest key
+void IHeapDelete(IHEAP *h, int item); // item must be in the heap
+
+void IHeapInsertU64(IHEAP *h, int item, uint64_t key);
+void IHeapChangeKeyU64(IHEAP *h, int item, uint64_t key);
+uint64_t IHeapKeyU64(IHEAP *h, int item);
+uint64_t IHeapPeekKeyU64(IHEAP *h);
+
+int IHeapSanityCheck(IHEAP *h); // assert the heap property and the index; returns 1
+
+#endif  /* _IHEAP_H */
+#ifdef __cplusplus
+} // end extern "C"
+#endif
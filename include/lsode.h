@@ -15,6 +15,8 @@ typedef struct _lsode
     double RTOL,ATOL,*RWORK;
     double *Y,T;
     F_EVAL F;
+    double *RSAV; int *ISAV; // LSODE's COMMON blocks, saved while another LSODE object is using them
+    int saved;
 } LSODE;
 
 
@@ -28,11 +30,12 @@ typedef struct _lsode
 ** eps = allowable relative error.
 ** zero = "problem zero"; I think it's allowable absolute error.
 **
-** WARNING: although you can have multiple invokations of the integrator
-** running using this interface, each time you switch which LSODE "object"
-** you're integrating, there is some restart overhead.  So, it's quite a bit
-** more efficient to do a bunch of LSODE integrations in series than in
-** parallel.
+** You can have any number of LSODE objects, and use them from any threads.
+** The Fortran code keeps part of its state in COMMON blocks, though, so
+** calls into it are serialized by a mutex, and when a different object
+** than last time comes along, the COMMON blocks are swapped out with
+** SRCOM (no restart needed unless LSODE_HAVE_SRCOM is 0). Do not call
+** LsodeIntegrate from inside your f.
 */
 LSODE *LsodeAlloc(int n, double t, double *y, F_EVAL f, int stiff_flag,
     double eps, double zero);
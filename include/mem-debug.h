@@ -18,6 +18,8 @@ extern "C" {
 #ifndef _DEBUG_H_
 #define _DEBUG_H_ /* to ensure we don't include it more than once */
 
+#include "mem-prof.h" /* the sampling profiler, which is cheap enough to use without memory tracking */
+
 
 /*
 ** Fatal (FATAL): Display an error message and terminate the program.  If
@@ -0,0 +1,58 @@
+// This software is part of github.com/waynebhayes/libwayne, and is Copyright(C) Wayne B. Hayes 2025, under the GNU LGPL 3.0
+// (GNU Lesser General Public License, version 3, 2007), a copy of which is contained at the top of the repo.
+#ifdef __cplusplus
+extern "C" {
+#endif
+#ifndef _MEM_PROF_H
+#define _MEM_PROF_H
+#include <stdio.h>
+#include <stdint.h>
+
+/*
+** Sampling allocation profiler (implemented in mem-debug.c).  Unlike memory
+** tracking it adds no header to blocks and keeps no list of them, so it's
+** cheap enough to leave on in optimized and -pg builds.  It sees everything
+** that goes through Malloc, Calloc, Realloc, Strdup and Free, whether from
+** misc.c (call sites are then return addresses: use addr2line) or the
+** mem-debug.h macros (call sites are file:line).
+**
+** Every allocation and free is counted exactly, per thread, and folded into
+** the global totals (live bytes, peak live bytes) every 256kB or so of change.
+** One allocation in every `period', on average, is sampled: its call site's
+** counters (scaled up by period, so they're estimates unless period is 1)
+** and a histogram of its sizes are updated in a lock-free hash table, and now
+** and then a point is added to a timeline of live bytes and RSS.
+**
+** The report lists the busiest call sites, the timeline and the peak RSS.
+** It's written at exit, when MemProfReport is called, and after SIGUSR1 (at
+** the next sampled allocation, since it's not safe in the handler itself).
+**
+** You can also turn it on without changing the program, by setting
+**     LIBWAYNE_MEMPROF=period[:reportFile]
+** in the environment, as long as mem-debug.o is linked in.  From libwayne.a
+** it only is if something calls one of these functions or uses mem-debug.h,
+** since misc.c reaches the profiler through hooks that MemProfEnable sets; to
+** get it anyway, link with -Wl,-u,MemProfEnable (and -lpthread).
+*/
+
+void MemProfEnable(unsigned period, const char *reportFile); /* reportFile NULL means stderr */
+void MemProfDisable(void);
+void MemProfReport(FILE *fp);
+
+/* Statistics so far; any of the pointers may be NULL */
+void MemProfTotals(uint64_t *allocs, uint64_t *frees, uint64_t *bytesAllocated, int64_t *liveBytes, int64_t *peakLiveBytes);
+
+/* The hooks: call them only if _memProfEnabled.  block is what malloc returned; size is what the caller asked for.
+** The call site is file and line if file isn't NULL, else the return address in line.  misc.c calls them
+** through _memProfAlloc and _memProfFree, which are NULL until MemProfEnable.
+*/
+extern int _memProfEnabled;
+extern void (*_memProfAlloc)(void *block, size_t size, const char *file, uintptr_t line);
+extern void (*_memProfFree)(void *block);
+void MemProfAlloc(void *block, size_t size, const char *file, uintptr_t line);
+void MemProfFree(void *block);
+
+#endif /* _MEM_PROF_H */
+#ifdef __cplusplus
+} // end extern "C"
+#endif
@@ -101,6 +101,11 @@ typedef union _voidInt {
 */
 typedef int (*pCmpFcn)(foint, foint);
 
+/* The hash function type, for hash tables of foints: keys that compare
+** equal must hash the same.
+*/
+typedef uint64_t (*pFointHashFcn)(foint);
+
 /* Copy a foint.  In all instances, you are expected to know what the
 ** foint actually is, and return a copy of it.  If a FointCopy function
 ** pointer is ever NULL, the code will do a shallow copy.
@@ -48,7 +48,7 @@ typedef LINKED_LIST PRIORITY_QUEUE;
 #define PriorityQueueSize LinkedListSize
 #define PriorityQueueFree LinkedListFree
 #define PriorityQueuePeek LinkedListPeek
-#define PriorityQueueNext LinkedListNext
+#define PriorityQueueNext LinkedListPop
 #define PriorityQueueInsert LinkedListInsert
 #define PriorityQueueDelete LinkedListDelete
 #define PriorityQueueSanityCheck(p) LinkedListSanityCheck(p,true)
@@ -56,6 +56,28 @@ typedef LINKED_LIST PRIORITY_QUEUE;
 #define PriorityQueueTypePrint LinkedListTypePrint
 
 #endif /* PQ_HEAP / PQ_LL */
+
+/*
+** Either way, if your entries are integers 0..n-1 with numeric priorities, and you need to change the priority
+** of one already queued (decrease-key, as in Dijkstra), use the indexed queue instead; see iheap.h.
+*/
+#include "iheap.h"
+
+typedef IHEAP INDEXED_PRIORITY_QUEUE;
+
+#define IndexedPriorityQueueAlloc IHeapAlloc
+#define IndexedPriorityQueueReset IHeapReset
+#define IndexedPriorityQueueSize IHeapSize
+#define IndexedPriorityQueueFree IHeapFree
+#define IndexedPriorityQueueContains IHeapContains
+#define IndexedPriorityQueuePeek IHeapPeek
+#define IndexedPriorityQueuePeekKey IHeapPeekKey
+#define IndexedPriorityQueueNext IHeapNext
+#define IndexedPriorityQueueInsert IHeapInsert
+#define IndexedPriorityQueueChangeKey IHeapChangeKey
+#define IndexedPriorityQueueKey IHeapKey
+#define IndexedPriorityQueueDelete IHeapDelete
+#define IndexedPriorityQueueSanityCheck IHeapSanityCheck
 #endif  /* _PRIORITY_QUEUE_H */
 #ifdef __cplusplus
 } // end extern "C"
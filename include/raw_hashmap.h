@@ -12,6 +12,14 @@ extern "C" {
 
 #ifndef __RAW_HASHMAP_H__
 #define __RAW_HASHMAP_H__
+#include <stdint.h>
+
+/*
+ * WBH: the original table is gone, replaced by Robin Hood hashing with
+ * power-of-two sizes, 64-bit keys, and backward-shift deletion (see
+ * raw_hashmap.c); the interface is the same apart from the key type.
+ * The order of iteration is arbitrary, and changes as the map grows.
+ */
 
 #define RAW_HASHMAP_MISSING -3  /* No such element */
 #define RAW_HASHMAP_FULL -2     /* Hashmap is full */
@@ -28,7 +36,7 @@ typedef void *any_t;
  * PFany is a pointer to a function that can take two any_t arguments
  * and return an integer. Returns status code..
  */
-typedef int (*PFany)(int key, any_t data);
+typedef int (*PFany)(int64_t key, any_t data);
 
 /*
  * raw_hashmap_t is a pointer to an internally maintained data structure.
@@ -51,26 +59,33 @@ extern raw_hashmap_t raw_hashmap_new(void);
  */
 extern int raw_hashmap_iterate(raw_hashmap_t in, PFany f);
 
+/*
+ * Step through the elements without a callback: set *iter = 0, then each call
+ * gives the next element's key and data (either pointer may be NULL), until it
+ * returns RAW_HASHMAP_MISSING.  Don't put or remove anything meanwhile.
+ */
+extern int raw_hashmap_next(raw_hashmap_t in, int *iter, int64_t *keyp, any_t *arg);
+
 /*
  * Add an element to the hashmap. Return RAW_HASHMAP_OK or RAW_HASHMAP_OMEM.
  */
-extern int raw_hashmap_put(raw_hashmap_t in, int key, any_t value);
+extern int raw_hashmap_put(raw_hashmap_t in, int64_t key, any_t value);
 
 /*
  * Get an element from the hashmap. Return RAW_HASHMAP_OK or RAW_HASHMAP_MISSING.
  */
-extern int raw_hashmap_get(raw_hashmap_t in, int key, any_t *arg);
+extern int raw_hashmap_get(raw_hashmap_t in, int64_t key, any_t *arg);
 
 /*
  * Remove an element from the hashmap. Return RAW_HASHMAP_OK or RAW_HASHMAP_MISSING.
  */
-extern int raw_hashmap_remove(raw_hashmap_t in, int key);
+extern int raw_hashmap_remove(raw_hashmap_t in, int64_t key);
 
 /*
  * Get the KEY of an arbitrary element. NOT RANDOM, may return the same item every
  * time unless "remove" is true. Return RAW_HASHMAP_OK or RAW_HASHMAP_MISSING if empty.
  */
-extern int raw_hashmap_get_one(raw_hashmap_t in, int *keyp, int remove);
+extern int raw_hashmap_get_one(raw_hashmap_t in, int64_t *keyp, int remove);
 
 /*
  * Free the hashmap
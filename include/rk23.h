@@ -15,6 +15,9 @@ typedef struct _rk23
     int n;
     double TOL,HMAX,HMIN,H,T,*w;
     F_EVAL F;
+    int nroot, whichRoot;
+    G_EVAL G;
+    double *g0; // the root functions at T
 } RK23;
 
 
@@ -23,7 +26,26 @@ RK23 *Rk23Alloc(int n, double t, double *y, F_EVAL f, int stiff_flag,
 
 double Rk23Integrate(RK23 *r, double B);
 
-#define Rk23Free(r) Free(r)
+/*
+** Dense output: fill yout[k*n .. k*n+n-1] with the solution at tout[k], for k=0..nOut-1 (tout increasing and
+** not before T). Rather than shortening steps to land on every tout[k] as repeated calls to Rk23Integrate
+** would, it takes its natural steps and evaluates the cubic Hermite interpolant of each step, which is
+** third order and free since RK23's last stage is the derivative at the end of the step. Only the last step
+** is shortened, so T ends at tout[nOut-1].
+** If a root search is on (see Rk23PrepRoot) and some g changes sign first, the root is located on the
+** interpolant, T and the state are set to it, and the number of outputs filled so far is returned; call
+** again with the remaining outputs to carry on. Otherwise returns nOut.
+*/
+int Rk23IntegrateDense(RK23 *r, int nOut, const double *tout, double *yout);
+
+/*
+** Like Ddriv2PrepRoot: look for sign changes in g(n, t, y, i), i=0..nroot-1, during Rk23IntegrateDense.
+** Call with nroot = 0 and g = NULL to cancel. Rk23WhichRoot tells you which one stopped the integration.
+*/
+void Rk23PrepRoot(RK23 *r, int nroot, G_EVAL g);
+int Rk23WhichRoot(RK23 *r);
+
+void Rk23Free(RK23 *r);
 #ifdef __cplusplus
 } // end extern "C"
 #endif
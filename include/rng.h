@@ -0,0 +1,69 @@
+// This software is part of github.com/waynebhayes/libwayne, and is Copyright(C) Wayne B. Hayes 2025, under the GNU LGPL 3.0
+// (GNU Lesser General Public License, version 3, 2007), a copy of which is contained at the top of the repo.
+#ifdef __cplusplus
+extern "C" {
+#endif
+#ifndef _RNG_H
+#define _RNG_H
+
+#include "misc.h"
+
+/*
+** Random number generators whose entire state is in an RNG you pass to every call, so each thread (or each
+** independent computation) can own one without locking, unlike drand48() and Stream48().
+**
+** RNG_XOSHIRO: xoshiro256** (Blackman & Vigna), 32 bytes of state, very fast; RngJump() advances it 2^128 steps.
+** RNG_PHILOX:  Philox4x32-10 (Salmon et al.), counter-based: output block i is a pure function of (key, i), so
+**		any point of the stream can be reached in O(1) (RngSkip), and RngJump() moves to a disjoint
+**		2^96-block substream. Slower per number, but the results of a parallel computation can be made
+**		independent of how it was split among threads.
+** Either way, RngStreams() gives n non-overlapping streams from one seed, one per thread.
+*/
+
+typedef enum { RNG_XOSHIRO, RNG_PHILOX } RNG_TYPE;
+
+typedef struct _rng {
+    RNG_TYPE type;
+    union {
+	uint64_t s[4]; // xoshiro state
+	struct { uint32_t key[2], ctr[4], out[4]; int used; } philox; // out[used..3] are still unused
+    } u;
+    Boolean haveNormal; // RngNormal() makes two at a time
+    double nextNormal;
+} RNG;
+
+void RngInit(RNG *r, RNG_TYPE type, uint64_t seed); // any seed is fine, including 0
+RNG *RngAlloc(RNG_TYPE type, uint64_t seed);
+RNG *RngStreams(RNG_TYPE type, uint64_t seed, int n); // array of n RNGs, each RngJump()ed from the previous
+void RngFree(RNG *r); // for both RngAlloc and RngStreams
+
+uint64_t RngNext64(RNG *r);
+uint32_t RngNext32(RNG *r);
+double RngUniform(RNG *r); // [0,1), 53 random bits
+long RngInt(RNG *r, long minimum, long maximum); // min, max inclusive, unbiased
+double RngNormal(RNG *r); // mean 0, stddev 1
+
+void RngJump(RNG *r); // skip to the next non-overlapping stream (see above)
+void RngSkip(RNG *r, uint64_t n); // discard n 32-bit outputs; O(1) for Philox, O(n) for xoshiro
+
+// Fill out[0..n-1] with the same numbers n calls to RngUniform or RngNormal would give, just faster.
+void RngUniformBulk(RNG *r, double *out, size_t n);
+void RngNormalBulk(RNG *r, double *out, size_t n);
+
+/*
+** Replacements for the Stream48 API (see stream48.h) on top of RNG, usable from multiple threads: each thread
+** has its own current stream, so as long as no two threads use the same stream at once no locking is needed.
+** Call RngStreamInit() before starting any threads; otherwise the first call uses one stream seeded with 0.
+*/
+void RngStreamInit(RNG_TYPE type, int n, uint64_t seed);
+int RngStream(int n); // choose the calling thread's current stream; returns the previous one
+int RngStreamWhich(void);
+RNG *RngStreamState(void); // the current stream's RNG, to call the Rng* functions directly
+long RngStreamRandomize(void); // reseed the current stream from the time and pid; return the seed
+long RngStreamRandInt(long minimum, long maximum); // min, max inclusive
+double RngStreamRand(void); // in (0,1): like Stream48Rand, never returns 0
+
+#endif  /* _RNG_H */
+#ifdef __cplusplus
+} // end extern "C"
+#endif
@@ -173,9 +173,13 @@ char *SSetToString(int len, char s[], SSET set);
 
 /* SSET dictionary - a set of small sets */
 typedef struct _ssetDict SSETDICT;
-SSETDICT *SSetDictAlloc(int init_size);
+SSETDICT *SSetDictAlloc(int init_size); /* init_size is how many you expect; it grows if need be */
 SSETDICT *SSetDictAdd(SSETDICT*, SSET);
 Boolean SSetDictIn(SSETDICT*, SSET);
+unsigned long SSetDictSize(SSETDICT*); /* number of distinct sets added */
+/* In concurrent mode, any number of threads may call SSetDictAdd and SSetDictIn at once.
+** Turn it on and off only while no other thread is using the dictionary. */
+void SSetDictConcurrent(SSETDICT*, Boolean on);
 void SSetDictFree(SSETDICT*);
 
 #ifndef TINY_SET_SIZE
@@ -19,6 +19,7 @@ typedef double (*pScoreFunc)(Boolean global, const foint); // user-provided func
 typedef double (*pMoveFunc)(const foint solution);
 typedef Boolean  (*pAcceptFunc)(const Boolean accept, const foint solution); // returns whether it ACTUALLY accepted
 typedef void  (*pReportFunc)(int iter, foint f);
+typedef void  (*pCopyFunc)(foint dst, const foint src); // deep-copy solution src into the already-allocated dst
 
 
 #define PBAD_CIRC_BUF 1000
@@ -32,6 +33,10 @@ typedef struct _sim_anneal {
     pAcceptFunc Accept;
     pScoreFunc Score;
     pReportFunc Report;
+    unsigned short rng[3]; // erand48() state for accept/reject, so annealers don't share drand48()'s stream
+    int prevPctDone;
+    Boolean adaptive; // if true, temperature is scaled by tScale, which is retuned online to track the target pBad
+    double tScale;
 } SIM_ANNEAL;
 
 // direction < 0 to minimize, > 0 to maximize
@@ -39,10 +44,44 @@ SIM_ANNEAL *SimAnnealAlloc(double direction, foint initSol, pMoveFunc Move, pSco
     unsigned long maxIters, double pBadStart, double pBadEnd, pReportFunc Report);
 Boolean SimAnnealSetSchedule(SIM_ANNEAL *sa, double tInitial, double tDecay);
 void SimAnnealAutoSchedule(SIM_ANNEAL *sa); // to automatically create schedule
+// Schedule from the distribution of numSamples proposed-then-rejected move deltas; false if none were bad.
+Boolean SimAnnealSampleSchedule(SIM_ANNEAL *sa, int numSamples);
+// Retune the temperature during the run so pBad follows pBadStart..pBadEnd log-linearly.
+void SimAnnealSetAdaptive(SIM_ANNEAL *sa, Boolean adaptive);
 int SimAnnealRun(SIM_ANNEAL *sa); // returns >0 if success, 0 if not done and can continue, <0 if error
 foint SimAnnealSol(SIM_ANNEAL *sa);
 void SimAnnealFree(SIM_ANNEAL *sa);
 
+/*
+** Parallel tempering (replica exchange): numReplicas chains, each a SIM_ANNEAL at a fixed temperature on a
+** geometric ladder from tMin (replica 0) to tMax, each running on its own thread with its own solution and
+** RNG state.  Every swapInterval iterations the threads meet and neighboring replicas try to exchange
+** solutions with the usual Metropolis criterion, so good solutions found hot drift down to the cold chains.
+** The Move, Accept and Score functions are shared by all replicas and are called concurrently, so they must
+** keep all their state in the solution they are passed (including any random number state they use).
+** solutions[0..numReplicas-1] are independent, caller-allocated solutions (eg. copies of one initial one);
+** best is one more, into which Copy() stores the best solution seen at any swap point.
+*/
+typedef struct _sim_anneal_pt {
+    int numReplicas, direction, prevPctDone;
+    unsigned long itersPerReplica, swapInterval, swapsTried, swapsAccepted;
+    double bestScore;
+    foint best;
+    pCopyFunc Copy;
+    pReportFunc Report;
+    SIM_ANNEAL **replica; // replica[r]->temperature is its rung of the ladder
+    unsigned short rng[3]; // for swap decisions
+} SIM_ANNEAL_PT;
+
+SIM_ANNEAL_PT *SimAnnealPTAlloc(double direction, int numReplicas, foint solutions[], foint best, pCopyFunc Copy,
+    pMoveFunc Move, pScoreFunc Score, pAcceptFunc Accept, unsigned long itersPerReplica, unsigned long swapInterval,
+    pReportFunc Report);
+Boolean SimAnnealPTSetLadder(SIM_ANNEAL_PT *pt, double tMin, double tMax);
+void SimAnnealPTAutoLadder(SIM_ANNEAL_PT *pt); // tMax, tMin from SimAnnealAutoSchedule() on replica 0
+int SimAnnealPTRun(SIM_ANNEAL_PT *pt); // returns >0 if success, <0 if error
+foint SimAnnealPTBest(SIM_ANNEAL_PT *pt, double *score); // best solution seen; its score if score != NULL
+void SimAnnealPTFree(SIM_ANNEAL_PT *pt); // frees the replicas but not the caller's solutions
+
 #endif  /* _SIM_ANNEAL_H */
 
 #ifdef __cplusplus
@@ -9,6 +9,8 @@ extern "C" {
 #include <assert.h>
 #include <alloca.h>
 #include <stdlib.h> /* to ensure our definition of SortFcn matches theirs */
+#include <stddef.h>
+#include <stdint.h>
 
 typedef int (*pfnCmpFcn)(const void*, const void*);
 
@@ -28,8 +30,90 @@ extern SortFcn
     MergeSort,	    /* nlogn, but requires n*w extra space. */
     InsertionSort,  /* n^2 insertion sort, in-place. */
     PileSort,       /* Wayne's sorting method... HayesSort? */
-    FredSort;       /* Fredrickson's O(n^2 log n) space*time algorithm */
+    FredSort,       /* Fredrickson's O(n^2 log n) space*time algorithm */
+    ParallelSort;   /* sample sort: splits the array into buckets by sampled splitters, then qsorts them in parallel */
+extern int ParallelSortThreads; // how many threads ParallelSort uses; 0 (the default) means one per CPU
 extern void InsertionSortInt(int A[],size_t k);
+extern int PileSortInts(int *a, size_t n);
+
+/*
+** Radix sorts: no comparisons at all, just a few linear passes over the keys, so they beat qsort by a wide
+** margin on large arrays of plain numbers. Each is LSD (least significant byte first), needs n keys' worth
+** of scratch space (plus n payloads for the Pairs versions), and skips any byte that's the same in every key,
+** so eg. node IDs below 2^16 take two passes rather than four. They're stable, which is what lets the Pairs
+** versions sort (key,payload) pairs: the payload moves with its key, and equal keys keep their order.
+** The floating-point ones order -0.0 before 0.0, and NaNs at the ends.
+** The InPlace versions are MSD (most significant byte first, American flag sort): no extra memory, not stable.
+** Small arrays fall through to an inlined comparison sort.
+*/
+void RadixSortU32(uint32_t *a, size_t n);
+void RadixSortU64(uint64_t *a, size_t n);
+void RadixSortFloat(float *a, size_t n);
+void RadixSortDouble(double *a, size_t n);
+void RadixSortU32Pairs(uint32_t *key, uint32_t *payload, size_t n);
+void RadixSortU64Pairs(uint64_t *key, uint64_t *payload, size_t n);
+void RadixSortInPlaceU32(uint32_t *a, size_t n);
+void RadixSortInPlaceU64(uint64_t *a, size_t n);
+
+/*
+** SORT_INLINE_DEFINE(name, TYPE, LESS) defines "static void name(TYPE *a, size_t n)", an introsort with the
+** comparison LESS(x,y) (a macro or inline function returning x<y) compiled inline rather than called through
+** a pfnCmpFcn. Use it for arrays of structs where a radix sort doesn't apply, eg.
+**	#define EDGE_LESS(x,y) ((x).u < (y).u || ((x).u == (y).u && (x).v < (y).v))
+**	SORT_INLINE_DEFINE(EdgeSort, EDGE, EDGE_LESS)
+*/
+#define SORT_INLINE_DEFINE(name, TYPE, LESS) \
+static inline void name##Insertion(TYPE *a, size_t n) { \
+    size_t i, j; \
+    for(i=1; i<n; i++) { \
+	TYPE x = a[i]; \
+	for(j=i; j>0 && LESS(x, a[j-1]); j--) a[j] = a[j-1]; \
+	a[j] = x; \
+    } \
+} \
+static inline void name##Sift(TYPE *a, size_t root, size_t n) { \
+    TYPE x = a[root]; \
+    size_t child; \
+    while((child = 2*root+1) < n) { \
+	if(child+1 < n && LESS(a[child], a[child+1])) child++; \
+	if(!LESS(x, a[child])) break; \
+	a[root] = a[child]; root = child; \
+    } \
+    a[root] = x; \
+} \
+/* quicksort down to pieces of 16, or heapsort if it's going quadratic; the final insertion sort finishes up */ \
+static inline void name##Intro(TYPE *a, size_t n, int depth) { \
+    while(n > 16) { \
+	TYPE t, pivot; \
+	size_t mid = n/2; \
+	ptrdiff_t i = -1, j = n; \
+	if(depth-- == 0) { \
+	    size_t k; \
+	    for(k=n/2; k-- > 0;) name##Sift(a, k, n); \
+	    for(k=n-1; k>0; k--) { t = a[0]; a[0] = a[k]; a[k] = t; name##Sift(a, 0, k); } \
+	    return; \
+	} \
+	if(LESS(a[mid], a[0])) { t = a[mid]; a[mid] = a[0]; a[0] = t; } \
+	if(LESS(a[n-1], a[mid])) { t = a[n-1]; a[n-1] = a[mid]; a[mid] = t; \
+	    if(LESS(a[mid], a[0])) { t = a[mid]; a[mid] = a[0]; a[0] = t; } } \
+	pivot = a[mid]; \
+	for(;;) { /* Hoare partition: afterwards a[0..j] <= pivot <= a[j+1..n-1] */ \
+	    do i++; while(LESS(a[i], pivot)); \
+	    do j--; while(LESS(pivot, a[j])); \
+	    if(i >= j) break; \
+	    t = a[i]; a[i] = a[j]; a[j] = t; \
+	} \
+	if((size_t)j+1 < n-j-1) { name##Intro(a, j+1, depth); a += j+1; n -= j+1; } \
+	else { name##Intro(a+j+1, n-j-1, depth); n = j+1; } \
+    } \
+} \
+static inline void name(TYPE *a, size_t n) { \
+    int depth = 0; \
+    size_t m; \
+    for(m=n; m > 1; m >>= 1) depth += 2; \
+    name##Intro(a, n, depth); \
+    name##Insertion(a, n); \
+}
 /*
 ** PointerSort is useful for sorting large data items.  In that case, it's
 ** more efficient to create an array of pointers, sort the pointers, and
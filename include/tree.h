@@ -13,8 +13,24 @@ extern "C" {
 #else
 #define TREE_USES_AVL 0
 #endif
+#ifndef TREE_USES_BPTREE
+#define TREE_USES_BPTREE 0 // set to 1 (eg. -DTREE_USES_BPTREE=1) to use the B+-tree, which is fastest for big trees
+#endif
 
-#if TREE_USES_AVL
+#if TREE_USES_BPTREE
+#include "bptree.h"
+#define TREETYPE BPTREE
+#define TREE BPTREE
+#define TreeAlloc BpTreeAlloc
+#define TreeInsert BpTreeInsert
+#define UnsafeTreeInsert UnsafeBpTreeInsert
+#define TreeLookup BpTreeLookup
+#define UnsafeTreeLookup(t,k) UnsafeBpTreeLookDel((t),(k),false)
+#define TreeLookDel BpTreeLookDel
+#define TreeDelete BpTreeDelete
+#define TreeTraverse BpTreeTraverse
+#define TreeFree BpTreeFree
+#elif TREE_USES_AVL
 #include "avltree.h"
 #define TREETYPE AVLTREE
 #define TREE AVLTREE
@@ -1,7 +1,7 @@
 // This software is part of github.com/waynebhayes/libwayne, and is Copyright(C) Wayne B. Hayes 2025, under the GNU LGPL 3.0
 // (GNU Lesser General Public License, version 3, 2007), a copy of which is contained at the top of the repo.
 const char USAGE[] = "\
-USAGE: parallel [-s [shell-name]] {n|auto} \n\
+USAGE: parallel [-s [shell-name]] [-m reserve] [-p psi] [-M] [-j joblog] [-o] [-H history] {n|auto} \n\
 parallel(1) reads command lines from the standard input, and keeps\n\
 {n} of them running concurrently.  It defaults to using the SHELL\n\
 environment variable as the executor; '-s' by itself will use the\n\
@@ -10,12 +10,38 @@ like rc(1).  To distinguish '-s {n}' from '-s {shell-name}', it assumes\n\
 your shell name doesn't start with a digit.\n\
 It exits with the number of failed jobs.\n\
 With 'auto', it will attempt to keep all CPUs on the machine busy,\n\
-while attempting to account for jobs not under its control.";
+while attempting to account for jobs not under its control.\n\
+Before each launch it also checks memory (Linux only): a job is held back if\n\
+MemAvailable, less what running jobs are still expected to grow into and what\n\
+the new one is expected to use, would fall below the reserve (-m, eg. 2G or 10%;\n\
+default 10% in auto mode, else none), or if the memory pressure stall\n\
+(PSI 'some avg10', percent) exceeds -p (default 20 in auto mode, else none).\n\
+A job is expected to use the largest peak RSS (of it and its descendants) seen\n\
+so far among its siblings, unless -M is given and its line starts with a hint\n\
+like 'mem=4G ', which is used instead (and stripped); until that's known, jobs\n\
+start at most one per second.  If nothing is running, a job is always launched.\n\
+-j joblog appends one tab-separated line per finished job to the file joblog:\n\
+its input line number, start and end times (seconds since the epoch), wall,\n\
+user and system seconds, peak RSS in kB, exit status (negative: killed by that\n\
+signal), and the command.\n\
+-o buffers each job's standard output and error, and writes them out only when\n\
+the job finishes, so the output of concurrent jobs isn't interleaved.\n\
+-H history reads all the command lines first, then starts those never seen\n\
+before (in input order) followed by the rest longest-expected-first, using the\n\
+run times recorded in the file history (keyed by the command line with runs of\n\
+whitespace collapsed); on exit it records the new run times there.";
 
 #include <strings.h>
 #include <string.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+#include <sys/select.h>
 #include <sys/wait.h>
 #include <signal.h>
 #include <unistd.h>
@@ -91,40 +117,445 @@ void SigAlarmHandler(int sig)
 }
 
 
+/*
+** Memory-aware admission control. Everything is in kB, as in /proc. On systems without /proc the readers
+** return -1 and the corresponding check is skipped.
+*/
+#define POLL_MS 1000 // how often to re-check while a job is being held back
+static long memReserveKB = -1, memTotalKB; // -1 means no reserve
+static double memReservePct = -1, psiMax = -1; // -1 means unset
+static int memHints;
+
+typedef struct _job {
+    pid_t pid;
+    long memHintKB; // from "mem=SIZE", or 0
+    long peakKB; // largest RSS we've seen for it while running
+    long seq; // input line number
+    struct timeval start;
+    char *cmd; // only kept if we're writing a joblog
+    FILE *out, *err; // with -o: unlinked temporary files holding its output until it finishes
+} JOB;
+static JOB *job; // running jobs are job[0..numRunning-1]
+static int numRunning, maxRunning;
+static long maxPeakKB; // largest peak RSS of any job so far, running or finished
+static int numFinished;
+static struct timeval lastLaunch;
+static FILE *jobLog;
+static int bufferOutput;
+
+static int selfPipe[2]; // SIGCHLD writes a byte here so the main loop's select() wakes up immediately
+
+void SigChldHandler(int sig)
+{
+    int saveErrno = errno;
+    if(write(selfPipe[1], "c", 1) < 0) {} // if the pipe is full, there's already a wakeup pending
+    errno = saveErrno;
+}
+
+// value of the "key:" line of a /proc file like meminfo or status, in kB; -1 if not found
+long ProcKB(const char *file, const char *key)
+{
+    char buf[256];
+    long val = -1;
+    size_t len = strlen(key);
+    FILE *fp = fopen(file, "r");
+    if(!fp) return -1;
+    while(fgets(buf, sizeof(buf), fp))
+	if(strncmp(buf, key, len) == 0 && buf[len] == ':') { val = atol(buf+len+1); break; }
+    fclose(fp);
+    return val;
+}
+
+// "some avg10" from /proc/pressure/memory, as a percentage; -1 if unavailable (no PSI, or kernel < 4.20)
+double MemPressure(void)
+{
+    double avg10 = -1;
+    FILE *fp = fopen("/proc/pressure/memory", "r");
+    if(!fp) return -1;
+    if(fscanf(fp, "some avg10=%lf", &avg10) != 1) avg10 = -1;
+    fclose(fp);
+    return avg10;
+}
+
+// Resident set size of a job: the shell we started plus all its descendants (Linux 3.5+ lists them in
+// /proc/PID/task/PID/children; without that we see only the shell itself).
+long JobRSSKB(pid_t pid, int depth)
+{
+    char file[64];
+    int child;
+    sprintf(file, "/proc/%d/status", (int)pid);
+    long kB = ProcKB(file, "VmRSS");
+    if(kB < 0) return 0;
+    sprintf(file, "/proc/%d/task/%d/children", (int)pid, (int)pid);
+    FILE *fp = depth < 16 ? fopen(file, "r") : NULL;
+    if(fp) {
+	while(fscanf(fp, "%d", &child) == 1) kB += JobRSSKB(child, depth+1);
+	fclose(fp);
+    }
+    return kB;
+}
+
+// "4G", "512M", "100000" (kB) or "10%" (of MemTotal, returned negated so the caller can tell)
+long ParseSizeKB(const char *s)
+{
+    char *end;
+    double x = strtod(s, &end);
+    if(end == s || x < 0) Fatal("parallel: bad memory size");
+    switch(toupper(*end)) {
+    case '%': return -(long)(x*100); // hundredths of a percent
+    case 'T': x *= 1024; // fall through
+    case 'G': x *= 1024; // fall through
+    case 'M': x *= 1024; // fall through
+    case 'K': case '\0': break;
+    default: Fatal("parallel: bad memory size suffix (use K, M, G, T or %)");
+    }
+    return (long)x;
+}
+
+// If line begins with "mem=SIZE" plus whitespace, strip it and return SIZE in kB; else 0.
+long StripMemHint(char *line)
+{
+    if(strncmp(line, "mem=", 4) != 0) return 0;
+    char *p = line+4;
+    while(*p && !isspace((unsigned char)*p)) p++;
+    if(!*p) return 0; // nothing after the hint to run
+    *p = '\0';
+    long kB = ParseSizeKB(line+4);
+    if(kB < 0) Fatal("parallel: a per-line mem= hint can't be a percentage");
+    memmove(line, p+1, strlen(p+1)+1);
+    return kB;
+}
+
+long ExpectedKB(long hintKB) { return hintKB ? hintKB : maxPeakKB; }
+
+// Refresh each running job's peak RSS. Returns how much more they are expected to grow, in total.
+long PendingGrowthKB(void)
+{
+    long growth = 0;
+    int i;
+    for(i=0; i<numRunning; i++) {
+	long kB = JobRSSKB(job[i].pid, 0);
+	if(kB > job[i].peakKB) job[i].peakKB = kB;
+	if(job[i].peakKB > maxPeakKB && !job[i].memHintKB) maxPeakKB = job[i].peakKB;
+	long expect = ExpectedKB(job[i].memHintKB);
+	if(expect > job[i].peakKB) growth += expect - job[i].peakKB;
+    }
+    return growth;
+}
+
+// Whether a job expected to use hintKB (0 if unknown) may start now. Reasons for holding back are reported
+// once each time we go from admitting to not.
+int Admit(long hintKB)
+{
+    static int wasHeld;
+    char why[256] = "";
+    long reserveKB = memReserveKB;
+    if(memReservePct >= 0) reserveKB = memTotalKB * memReservePct / 100;
+
+    if(numRunning == 0) { wasHeld = 0; return 1; } // always make progress
+    if(reserveKB >= 0) {
+	long availKB = ProcKB("/proc/meminfo", "MemAvailable");
+	if(availKB >= 0) {
+	    long growthKB = PendingGrowthKB(), needKB = ExpectedKB(hintKB);
+	    struct timeval now;
+	    gettimeofday(&now, NULL);
+	    double sinceLaunch = (now.tv_sec - lastLaunch.tv_sec) + 1e-6*(now.tv_usec - lastLaunch.tv_usec);
+	    if(availKB - growthKB - needKB < reserveKB)
+		sprintf(why, "MemAvailable %ldM - running jobs' growth %ldM - new job %ldM < reserve %ldM",
+		    availKB/1024, growthKB/1024, needKB/1024, reserveKB/1024);
+	    // Until one has finished we don't know how big jobs get, so give each one a moment to show up in MemAvailable and RSS
+	    // before starting the next, so a burst of big ones can't all get in before we notice.
+	    else if(!hintKB && !numFinished && sinceLaunch < POLL_MS/1000.0)
+		sprintf(why, "job sizes not yet known; starting one per %gs", POLL_MS/1000.0);
+	}
+    }
+    if(!*why && psiMax >= 0) {
+	double psi = MemPressure();
+	if(psi > psiMax) sprintf(why, "memory pressure %.1f%% > %.1f%%", psi, psiMax);
+    }
+    if(*why) {
+	if(!wasHeld) fprintf(stderr, "parallel: holding back new jobs (%d running): %s\n", numRunning, why);
+	wasHeld = 1;
+	return 0;
+    }
+    wasHeld = 0;
+    return 1;
+}
+
+void Launch(const char *SHELL, const char *SH_argv0, const char *line, long hintKB, long seq)
+{
+    FILE *out = NULL, *err = NULL;
+    if(bufferOutput) {
+	if(!(out = tmpfile()) || !(err = tmpfile())) Fatal("parallel: can't create temporary file for -o");
+	fcntl(fileno(out), F_SETFD, FD_CLOEXEC); // so other jobs don't inherit them; our child's dup2 copies stay open
+	fcntl(fileno(err), F_SETFD, FD_CLOEXEC);
+    }
+    fflush(stdout); fflush(stderr); // so the child doesn't inherit (and repeat) anything we've buffered
+    pid_t pid = fork();
+    if(pid < 0) {
+	perror("parallel: fork"); ++numFailed;
+	if(out) fclose(out);
+	if(err) fclose(err);
+	return;
+    }
+    if(pid == 0)  /* child */
+    {
+	signal(SIGCHLD, SIG_DFL);
+	close(selfPipe[0]); close(selfPipe[1]);
+	if(bufferOutput) { dup2(fileno(out), 1); dup2(fileno(err), 2); }
+	execlp(SHELL, SH_argv0, "-c", line, NULL);
+	perror(SHELL);
+	exit(1);
+    }
+    if(numRunning == maxRunning) {
+	maxRunning = 2*maxRunning + 16;
+	job = realloc(job, maxRunning*sizeof(JOB));
+	if(!job) Fatal("parallel: out of memory");
+    }
+    job[numRunning].pid = pid;
+    job[numRunning].memHintKB = hintKB;
+    job[numRunning].peakKB = 0;
+    job[numRunning].seq = seq;
+    job[numRunning].cmd = jobLog ? strdup(line) : NULL;
+    job[numRunning].out = out;
+    job[numRunning].err = err;
+    gettimeofday(&lastLaunch, NULL);
+    job[numRunning].start = lastLaunch;
+    ++numRunning;
+}
+
+static double Seconds(struct timeval t) { return t.tv_sec + 1e-6*t.tv_usec; }
+
+/*
+** Longest-expected-first (-H). The history file has one "seconds<TAB>command" line per distinct command,
+** where the command is normalized by NormalizeCmd; a new run time is averaged in with the old one.
+*/
+typedef struct _queued {
+    char *line, *key; // key is the normalized line
+    long hintKB;
+    double expect, wall; // from the history (-1 if unknown), and this time (-1 if not run)
+} QUEUED;
+static QUEUED *queue; // every input line, in input order; queue[seq-1]
+static long numQueued;
+
+typedef struct _hist { char *key; double sec; } HIST;
+static const char *history;
+static HIST *hist;
+static long numHist, maxHist;
+
+// Copy of line with leading and trailing whitespace removed and internal runs of it made one space.
+char *NormalizeCmd(const char *line)
+{
+    char *key = malloc(strlen(line)+1), *k = key;
+    if(!key) Fatal("parallel: out of memory");
+    for(; *line; line++) {
+	if(isspace((unsigned char)*line)) { if(k > key && k[-1] != ' ') *k++ = ' '; }
+	else *k++ = *line;
+    }
+    if(k > key && k[-1] == ' ') k--;
+    *k = '\0';
+    return key;
+}
+
+int HistCmp(const void *a, const void *b) { return strcmp(((const HIST*)a)->key, ((const HIST*)b)->key); }
+
+void HistAdd(char *key, double sec)
+{
+    if(numHist == maxHist) {
+	maxHist = 2*maxHist + 64;
+	if(!(hist = realloc(hist, maxHist*sizeof(HIST)))) Fatal("parallel: out of memory");
+    }
+    hist[numHist].key = key;
+    hist[numHist++].sec = sec;
+}
+
+int HistKeyCmp(const void *key, const void *h) { return strcmp((const char*)key, ((const HIST*)h)->key); }
+
+HIST *HistFind(const char *key, long n) // among hist[0..n-1], which must be sorted
+{
+    return bsearch(key, hist, n, sizeof(HIST), HistKeyCmp);
+}
+
+void ReadHistory(void)
+{
+    static char buf[1024000];
+    FILE *fp = fopen(history, "r");
+    if(!fp) return; // first run
+    while(fgets(buf, sizeof(buf), fp)) {
+	char *tab = strchr(buf, '\t');
+	if(!tab) continue;
+	*tab = '\0';
+	HistAdd(NormalizeCmd(tab+1), atof(buf));
+    }
+    fclose(fp);
+    qsort(hist, numHist, sizeof(HIST), HistCmp);
+}
+
+// Merge this run's times into the history and rewrite it atomically.
+void WriteHistory(void)
+{
+    long i, j, numOld = numHist;
+    for(i=0; i<numQueued; i++) {
+	if(queue[i].wall < 0) continue;
+	HIST *h = HistFind(queue[i].key, numOld);
+	if(h) h->sec = (h->sec + queue[i].wall)/2;
+	else HistAdd(queue[i].key, queue[i].wall);
+    }
+    // new commands that ran more than once this time: average them into one entry
+    qsort(hist, numHist, sizeof(HIST), HistCmp);
+    for(i=j=0; i<numHist; i++) {
+	if(j > 0 && strcmp(hist[j-1].key, hist[i].key) == 0) hist[j-1].sec = (hist[j-1].sec + hist[i].sec)/2;
+	else hist[j++] = hist[i];
+    }
+    numHist = j;
+    char *tmp = malloc(strlen(history)+16);
+    if(!tmp) Fatal("parallel: out of memory");
+    sprintf(tmp, "%s.%d", history, (int)getpid());
+    FILE *fp = fopen(tmp, "w");
+    if(!fp) { perror(tmp); free(tmp); return; }
+    for(i=0; i<numHist; i++) fprintf(fp, "%.3f\t%s\n", hist[i].sec, hist[i].key);
+    if(fclose(fp) != 0 || rename(tmp, history) != 0) perror(history);
+    free(tmp);
+}
+
+static long *order; // indices into queue[], in the order to start them
+
+int LongestFirst(const void *a, const void *b)
+{
+    const QUEUED *x = &queue[*(const long*)a], *y = &queue[*(const long*)b];
+    if((x->expect < 0) != (y->expect < 0)) return x->expect < 0 ? -1 : 1; // never-seen ones first
+    if(x->expect > y->expect) return -1;
+    if(x->expect < y->expect) return 1;
+    return x < y ? -1 : x > y; // then input order, since qsort isn't stable
+}
+
+// Read all of stdin, look each line up in the history, and decide the order to start them in.
+void QueueAll(FILE *in)
+{
+    static char buf[1024000];
+    long i, maxQueued = 0;
+    ReadHistory();
+    while(fgets(buf, sizeof(buf), in)) {
+	if(numQueued == maxQueued) {
+	    maxQueued = 2*maxQueued + 256;
+	    if(!(queue = realloc(queue, maxQueued*sizeof(QUEUED)))) Fatal("parallel: out of memory");
+	}
+	QUEUED *q = &queue[numQueued++];
+	q->hintKB = memHints ? StripMemHint(buf) : 0;
+	if(!(q->line = strdup(buf))) Fatal("parallel: out of memory");
+	q->key = NormalizeCmd(buf);
+	HIST *h = HistFind(q->key, numHist);
+	q->expect = h ? h->sec : -1;
+	q->wall = -1;
+    }
+    if(!(order = malloc((numQueued+1)*sizeof(long)))) Fatal("parallel: out of memory");
+    for(i=0; i<numQueued; i++) order[i] = i;
+    qsort(order, numQueued, sizeof(long), LongestFirst);
+}
+
+// Send a finished job's buffered output to where it was headed, in one piece, and discard it.
+void CopyOut(FILE *from, FILE *to)
+{
+    char buf[65536];
+    size_t n;
+    rewind(from);
+    while((n = fread(buf, 1, sizeof(buf), from)) > 0)
+	if(fwrite(buf, 1, n, to) != n) break;
+    fflush(to);
+    fclose(from);
+}
+
+void LogJob(JOB *j, int status, const struct rusage *ru, long peakKB, struct timeval end)
+{
+    char *p;
+    for(p = j->cmd; *p; p++) if(*p == '\t' || *p == '\n' || *p == '\r') *p = ' '; // keep it one TSV field
+    for(--p; p >= j->cmd && *p == ' '; p--) *p = '\0';
+    fprintf(jobLog, "%ld\t%.3f\t%.3f\t%.3f\t%.3f\t%.3f\t%ld\t%d\t%s\n", j->seq, Seconds(j->start), Seconds(end),
+	Seconds(end) - Seconds(j->start), Seconds(ru->ru_utime), Seconds(ru->ru_stime), peakKB,
+	WIFEXITED(status) ? WEXITSTATUS(status) : WIFSIGNALED(status) ? -WTERMSIG(status) : -1, j->cmd);
+    fflush(jobLog);
+    free(j->cmd);
+}
+
+// Collect every child that has exited, without blocking.
+void Reap(void)
+{
+    int status, i;
+    pid_t pid;
+    struct rusage ru;
+    while((pid = wait4(-1, &status, WNOHANG, &ru)) > 0) {
+	if(!WIFEXITED(status) || WEXITSTATUS(status)) ++numFailed;
+	for(i=0; i<numRunning && job[i].pid != pid; i++)
+	    ;
+	if(i == numRunning) continue; // not one of ours
+	++numFinished;
+#ifdef __APPLE__
+	long peakKB = ru.ru_maxrss / 1024; // bytes on MacOS
+#else
+	long peakKB = ru.ru_maxrss;
+#endif
+	if(peakKB > maxPeakKB && !job[i].memHintKB) maxPeakKB = peakKB;
+	if(job[i].out) { CopyOut(job[i].out, stdout); CopyOut(job[i].err, stderr); }
+	struct timeval end;
+	gettimeofday(&end, NULL);
+	if(history) queue[job[i].seq - 1].wall = Seconds(end) - Seconds(job[i].start);
+	if(jobLog) LogJob(&job[i], status, &ru, peakKB, end);
+	job[i] = job[--numRunning];
+    }
+}
+
+// Sleep until a child exits or a signal arrives, or for at most ms milliseconds if ms >= 0.
+void WaitForEvent(int ms)
+{
+    fd_set fds;
+    struct timeval tv = { ms/1000, (ms%1000)*1000 };
+    char buf[64];
+    FD_ZERO(&fds);
+    FD_SET(selfPipe[0], &fds);
+    if(select(selfPipe[0]+1, &fds, NULL, NULL, ms >= 0 ? &tv : NULL) > 0)
+	while(read(selfPipe[0], buf, sizeof(buf)) > 0)
+	    ;
+}
+
 int main(int argc, char *argv[])
 {
-    int numRunning=0, n_arg = 1, status;
-    char line[1024000];
+    int n_arg, i;
+    static char line[1024000];
     const char *SHELL = getenv("SHELL");
 	const char *SH_argv0;
 
-    switch(argc)
+    if(!SHELL) SHELL = "/bin/sh";
+    for(i=1; i < argc-1 && argv[i][0] == '-'; i++)
     {
-    case 1:
-	Fatal(USAGE);
-	break;
-    case 2:	/* no args other than n */
-	n_arg = 1;
-	break;
-
-    case 3:	/* parallel -s n */
-	if(strcmp(argv[1], "-s"))
-	    Fatal(USAGE);
-	n_arg = 2;
-	SHELL = "/bin/sh";
-	break;
-
-    case 4:	/* parallel -s SHELL n */
-	if(strcmp(argv[1], "-s"))
+	if(strcmp(argv[i], "-s") == 0) {	/* -s [SHELL] */
+	    SHELL = "/bin/sh";
+	    if(i+1 < argc-1 && !isdigit((unsigned char)argv[i+1][0]) && argv[i+1][0] != '-')
+		SHELL = argv[++i];
+	}
+	else if(strcmp(argv[i], "-m") == 0 && i+1 < argc-1) {
+	    long kB = ParseSizeKB(argv[++i]);
+	    if(kB < 0) memReservePct = -kB/100.0;
+	    else memReserveKB = kB;
+	}
+	else if(strcmp(argv[i], "-p") == 0 && i+1 < argc-1)
+	    psiMax = atof(argv[++i]);
+	else if(strcmp(argv[i], "-M") == 0)
+	    memHints = 1;
+	else if(strcmp(argv[i], "-j") == 0 && i+1 < argc-1) {
+	    if(!(jobLog = fopen(argv[++i], "a"))) { perror(argv[i]); exit(1); }
+	    if(ftell(jobLog) == 0)
+		fprintf(jobLog, "Seq\tStart\tEnd\tWall\tUser\tSys\tMaxRSS_kB\tExit\tCommand\n");
+	}
+	else if(strcmp(argv[i], "-o") == 0)
+	    bufferOutput = 1;
+	else if(strcmp(argv[i], "-H") == 0 && i+1 < argc-1)
+	    history = argv[++i];
+	else
 	    Fatal(USAGE);
-	SHELL = argv[2];
-	n_arg = 3;
-	break;
-
-    default:
-	Fatal(USAGE);
-	break;
     }
+    if(i != argc-1)
+	Fatal(USAGE);
+    n_arg = i;
 
     SH_argv0 = rindex(SHELL, '/');	/* basename of SHELL */
     if(SH_argv0 == NULL)
@@ -137,44 +568,61 @@ int main(int argc, char *argv[])
 	parallel = cpus-GetLoadAv(0.0);
 	if(parallel<=0) parallel=1;
 	fprintf(stderr, "using AUTO with number of cpus %d; current load %d; initial parallel %d\n", cpus, load_av, parallel);
+	if(memReserveKB < 0 && memReservePct < 0) memReservePct = 10;
+	if(psiMax < 0) psiMax = 20;
 	signal(SIGALRM, SigAlarmHandler);
 	alarm(DELAY);
     }
     else
 	parallel = atoi(argv[n_arg]);
+    if(parallel < 1) Fatal(USAGE);
+    memTotalKB = ProcKB("/proc/meminfo", "MemTotal");
 
+    if(pipe(selfPipe) < 0) Fatal("parallel: can't create pipe");
+    for(i=0; i<2; i++) {
+	fcntl(selfPipe[i], F_SETFL, fcntl(selfPipe[i], F_GETFL) | O_NONBLOCK);
+	fcntl(selfPipe[i], F_SETFD, FD_CLOEXEC);
+    }
+    signal(SIGCHLD, SigChldHandler);
     signal(SIGUSR1, SigHandler_changeParallel);
     signal(SIGUSR2, SigHandler_changeParallel);
 
-    while(fgets(line, sizeof(line), stdin))
+    int haveLine = 0, eof = 0;
+    long hintKB = 0, seq = 0, next = 0;
+    const char *cmd = line;
+    if(history) QueueAll(stdin);
+    for(;;)
     {
-	while(numRunning >= parallel)
-	{
-	    wait(&status);
-	    if(!WIFEXITED(status) || WEXITSTATUS(status)) ++numFailed;
-	    --numRunning;
+	Reap();
+	if(!haveLine && !eof && history) {
+	    if(next < numQueued) {
+		haveLine = 1;
+		seq = order[next++] + 1;
+		cmd = queue[seq-1].line;
+		hintKB = queue[seq-1].hintKB;
+	    }
+	    else eof = 1;
 	}
-	if(fork() == 0)  /* child */
-	{
-	    execlp(SHELL, SH_argv0, "-c", line, NULL);
-	    perror(SHELL);
-	    exit(1);
+	else if(!haveLine && !eof) {
+	    if(fgets(line, sizeof(line), stdin)) {
+		haveLine = 1;
+		++seq;
+		hintKB = memHints ? StripMemHint(line) : 0;
+	    }
+	    else if(errno == EINTR && !feof(stdin)) { clearerr(stdin); continue; }
+	    else eof = 1;
 	}
-	else
-	{
-	    if(++numRunning >= parallel)
-	    {
-		wait(&status);
-		if(!WIFEXITED(status) || WEXITSTATUS(status)) ++numFailed;
-		--numRunning;
+	if(eof && numRunning == 0) break;
+	if(haveLine && numRunning < parallel) {
+	    if(Admit(hintKB)) {
+		Launch(SHELL, SH_argv0, cmd, hintKB, seq);
+		haveLine = 0;
+		continue;
 	    }
+	    WaitForEvent(POLL_MS); // held back: re-check memory soon, or as soon as something finishes
 	}
+	else WaitForEvent(-1);
     }
-#if 1
-    while(numRunning-- > 0) { /* wait for everyone to finish */
-	wait(&status);
-	if(!WIFEXITED(status) || WEXITSTATUS(status)) ++numFailed;
-    }
-#endif
+    if(history) WriteHistory();
     return numFailed;
 }
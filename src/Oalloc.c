@@ -4,56 +4,175 @@
 extern "C" {
 #endif
 #include <stdio.h>
-#include <malloc.h>
+#include <string.h>
+#include <pthread.h>
 #include "misc.h"
-#include "stack.h"
 #include "Oalloc.h"
 
-#define MAX_NUM_SETS 128    /* initial guess */
-#define SET_SIZE (512*1024)  /* maximum of 64 megabytes */
+#define DEFAULT_CHUNK (64*1024)
+#define FIRST_CHUNK 256	/* so that lots of little arenas (eg. one per tree) stay little */
 
-#define ALIGN_2 1   /* boolean */
-#define ALIGN_4 0   /* boolean: if true then ALIGN_2 must also be true */
+typedef struct _arenaChunk {
+    struct _arenaChunk *prev;	/* the chunk before this one (or the next spare) */
+    size_t size;	/* of the data, which follows the header */
+} ARENA_CHUNK;
 
-static int numLeft = 0;
-static STACK *Set, *BigSet;
+#define HEADER (((sizeof(ARENA_CHUNK) + ARENA_ALIGN-1) / ARENA_ALIGN) * ARENA_ALIGN)
+#define DATA(c) ((char*)(c) + HEADER)
 
-/* alloc and clear n bytes. Ofree frees ALL previously alloc'd sets.
-** Use stacks to keep track of the set's we've alloc'd.
-*/
-void *Omalloc(unsigned n)
+ARENA *ArenaAlloc(size_t chunkSize, int flags)
 {
-    static char *currentSet;
-    if(n == 0)
-	return malloc(0);       /* do whatever the system does with 0 */
-    else if(n > SET_SIZE) /* too big for us, pass on to Malloc directly */
-    {
-	if(!BigSet)
-	    BigSet = StackAlloc(MAX_NUM_SETS);
-	return StackPush(BigSet, (foint)Calloc(1,n)).v;
+    ARENA *a = Calloc(1, sizeof(ARENA));
+    a->chunkSize = chunkSize ? chunkSize : DEFAULT_CHUNK;
+    a->nextChunkSize = MIN(FIRST_CHUNK, a->chunkSize);
+    if(flags & ARENA_SIZE_CLASSES)
+	a->freeList = Calloc(ARENA_MAX_CLASS/ARENA_ALIGN, sizeof(void*));
+    return a;
+}
+
+void *ArenaMallocSlow(ARENA *a, size_t n, size_t align)
+{
+    size_t need = n + align-1; // room to align it in a chunk we haven't seen
+    ARENA_CHUNK *c;
+    if(need > a->chunkSize/4) { // too big to share a chunk: it gets its own
+	c = Malloc(HEADER + need);
+	c->size = need;
+    }
+    else if(a->spare && a->spare->size >= need) {
+	c = a->spare;
+	a->spare = c->prev;
     }
-    else if(n > numLeft) /* this set is exhausted, get another one */
-    {
-	if(!Set)
-	    Set = StackAlloc(MAX_NUM_SETS);
-	currentSet = StackPush(Set, (foint)Calloc(1,SET_SIZE)).v;
-	numLeft = SET_SIZE;
+    else {
+	size_t size = MAX(a->nextChunkSize, need);
+	c = Malloc(HEADER + size);
+	c->size = size;
+	if(a->nextChunkSize < a->chunkSize)
+	    a->nextChunkSize = MIN(2*a->nextChunkSize, a->chunkSize);
     }
+    c->prev = a->chunk;
+    a->chunk = c;
+    a->next = DATA(c);
+    a->end = DATA(c) + c->size;
+    return ArenaMallocAligned(a, n, align);
+}
 
-    /* Cheap attempt at alignment */
-#if ALIGN_2
-    if(n > 1 && (n & 1)) n++;
-#endif
-#if ALIGN_4
-    if(n > 3 && (n & 3)) n += 2;
-#endif
-    numLeft -= n;
-    return (currentSet + SET_SIZE - numLeft - n);
+ARENA_MARK ArenaMark(ARENA *a)
+{
+    ARENA_MARK m;
+    m.chunk = a->chunk;
+    m.next = a->next;
+    return m;
+}
+
+void ArenaRewind(ARENA *a, ARENA_MARK mark)
+{
+    while(a->chunk != mark.chunk) {
+	ARENA_CHUNK *c = a->chunk;
+	assert(c); // else the mark isn't from this arena, or we've already rewound past it
+	a->chunk = c->prev;
+	if(c->size <= a->chunkSize) { // keep it for next time
+	    c->prev = a->spare;
+	    a->spare = c;
+	}
+	else Free(c);
+    }
+    a->next = mark.next;
+    a->end = a->chunk ? DATA(a->chunk) + a->chunk->size : NULL;
+    if(a->freeList) // objects released since the mark are gone, and we can't tell which they are
+	memset(a->freeList, 0, ARENA_MAX_CLASS/ARENA_ALIGN * sizeof(void*));
+}
+
+void ArenaReset(ARENA *a)
+{
+    ARENA_MARK start = {NULL, NULL};
+    ArenaRewind(a, start);
+}
+
+void ArenaFree(ARENA *a)
+{
+    ArenaReset(a);
+    while(a->spare) {
+	ARENA_CHUNK *c = a->spare;
+	a->spare = c->prev;
+	Free(c);
+    }
+    if(a->freeList) Free(a->freeList);
+    Free(a);
+}
+
+void *ArenaCalloc(ARENA *a, size_t n, size_t size)
+{
+    if(size && n > (size_t)-1 / size) Fatal("ArenaCalloc(%lu, %lu): too big", (unsigned long)n, (unsigned long)size);
+    void *p = ArenaMalloc(a, n*size);
+    memset(p, 0, n*size);
+    return p;
+}
+
+char *ArenaStrdup(ARENA *a, const char *s)
+{
+    size_t len = strlen(s) + 1;
+    return memcpy(ArenaMallocAligned(a, len, 1), s, len);
+}
+
+void ArenaRelease(ARENA *a, void *p, size_t n)
+{
+    if(a->freeList && p && n && n <= ARENA_MAX_CLASS) {
+	void **head = &a->freeList[(n-1)/ARENA_ALIGN];
+	*(void**)p = *head;
+	*head = p;
+    }
+}
+
+__thread ARENA *_arenaThread;
+
+static pthread_key_t _arenaKey; /* so that a thread's arena is freed when it exits */
+static pthread_once_t _arenaKeyOnce = PTHREAD_ONCE_INIT;
+static void ArenaThreadExit(void *a) { ArenaFree((ARENA*)a); _arenaThread = NULL; }
+static void ArenaMakeKey(void) { pthread_key_create(&_arenaKey, ArenaThreadExit); }
+
+ARENA *ArenaThreadInit(void)
+{
+    if(!_arenaThread) {
+	_arenaThread = ArenaAlloc(0, ARENA_SIZE_CLASSES);
+	pthread_once(&_arenaKeyOnce, ArenaMakeKey);
+	pthread_setspecific(_arenaKey, _arenaThread);
+    }
+    return _arenaThread;
+}
+
+void ArenaThreadFree(void)
+{
+    if(_arenaThread) {
+	pthread_setspecific(_arenaKey, NULL);
+	ArenaFree(_arenaThread);
+    }
+    _arenaThread = NULL;
+}
+
+
+/*
+** Omalloc and friends: one arena shared by all threads, with big chunks since
+** it's meant for lots of objects.
+*/
+#define SET_SIZE (512*1024)
+
+static ARENA *_Oarena;
+static pthread_mutex_t _Olock = PTHREAD_MUTEX_INITIALIZER;
+
+/* alloc and clear n bytes. Ofree frees ALL previously alloc'd sets.
+*/
+void *Omalloc(unsigned n)
+{
+    return Ocalloc(1, n);
 }
 
 void *Ocalloc(unsigned n, size_t s)
 {
-    return Omalloc(s*n);
+    pthread_mutex_lock(&_Olock);
+    if(!_Oarena) _Oarena = ArenaAlloc(SET_SIZE, 0);
+    void *p = ArenaCalloc(_Oarena, n, s);
+    pthread_mutex_unlock(&_Olock);
+    return p;
 }
 
 /* Orealloc can't be implemented, because we don't know the size of the
@@ -64,21 +183,10 @@ void *Ocalloc(unsigned n, size_t s)
 
 void Ofree(void)
 {
-    if(Set)
-    {
-	while(StackSize(Set))
-	    free(StackPop(Set).v);
-	StackFree(Set);
-	Set = NULL;
-    }
-    if(BigSet)
-    {
-	while(StackSize(BigSet))
-	    free(StackPop(BigSet).v);
-	StackFree(BigSet);
-	BigSet = NULL;
-    }
-    numLeft = 0;
+    pthread_mutex_lock(&_Olock);
+    if(_Oarena) ArenaFree(_Oarena);
+    _Oarena = NULL;
+    pthread_mutex_unlock(&_Olock);
 }
 #ifdef __cplusplus
 } // end extern "C"
@@ -63,6 +63,136 @@ void setBalance(AVLTREENODE* node, char balance)
 	node->right = (AVLTREENODE*)( ((uintptr_t)node->right & ~3) | (balance & 3) );
 }
 
+/*
+** Optimistic lookups and deferred freeing (see avltree.h).  Each thread that looks things up has a
+** reader record, on a cache line of its own, in which it announces the global epoch when it starts a
+** lookup, and 0 when it's done.  A deleted node is retired with the epoch at the time, and freed once
+** every lookup in progress started in a later epoch, since those can't have found it.  One epoch and
+** one list of readers serve all the trees.
+*/
+#define CACHE_LINE 64
+#define AVL_TRIES 4	/* optimistic lookups to try before locking */
+#define AVL_MAX_STEPS 128	/* deeper than any AVL tree can be, so a writer has led us in circles */
+#define AVL_RECLAIM 64	/* retired nodes to collect before trying to free them */
+
+typedef struct _avlReader {
+    uint64_t epoch;	/* 0 if not looking anything up */
+    int inUse;	/* by a thread; when it exits, another can have it */
+    struct _avlReader *next;
+} AVL_READER;
+
+struct _avlRetired { AVLTREENODE *node; uint64_t epoch; };
+
+static uint64_t _avlEpoch = 1;
+static AVL_READER *_avlReaders;
+static __thread AVL_READER *_avlReader;
+static pthread_key_t _avlReaderKey;
+static pthread_once_t _avlReaderKeyOnce = PTHREAD_ONCE_INIT;
+
+static void AvlReaderExit(void *r) { __atomic_store_n(&((AVL_READER*)r)->inUse, 0, __ATOMIC_RELEASE); }
+static void AvlMakeReaderKey(void) { pthread_key_create(&_avlReaderKey, AvlReaderExit); }
+
+static AVL_READER *AvlReaderInit(void)
+{
+    AVL_READER *r;
+    for(r = __atomic_load_n(&_avlReaders, __ATOMIC_ACQUIRE); r; r = r->next) {
+	int idle = 0;
+	if(__atomic_load_n(&r->inUse, __ATOMIC_RELAXED) == 0 &&
+	    __atomic_compare_exchange_n(&r->inUse, &idle, 1, false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) break;
+    }
+    if(!r) { // they're never freed, so keep them each to a cache line without worrying about where Malloc put it
+	char *mem = Malloc(2*CACHE_LINE);
+	r = (AVL_READER*)(((uintptr_t)mem + CACHE_LINE-1) & ~(uintptr_t)(CACHE_LINE-1));
+	r->epoch = 0;
+	r->inUse = 1;
+	r->next = __atomic_load_n(&_avlReaders, __ATOMIC_RELAXED);
+	while(!__atomic_compare_exchange_n(&_avlReaders, &r->next, r, true, __ATOMIC_RELEASE, __ATOMIC_RELAXED))
+	    ;
+    }
+    pthread_once(&_avlReaderKeyOnce, AvlMakeReaderKey);
+    pthread_setspecific(_avlReaderKey, r);
+    return _avlReader = r;
+}
+
+/* Announce the epoch, making sure that it's still current once everyone can see the announcement */
+static void AvlReaderStart(AVL_READER *r)
+{
+    uint64_t e;
+    do {
+	e = __atomic_load_n(&_avlEpoch, __ATOMIC_SEQ_CST);
+	__atomic_store_n(&r->epoch, e, __ATOMIC_SEQ_CST);
+    } while(__atomic_load_n(&_avlEpoch, __ATOMIC_SEQ_CST) != e);
+}
+
+static void AvlFreeNode(AVLTREE *tree, AVLTREENODE *p)
+{
+    tree->freeKey(p->key);
+    tree->freeInfo(p->info);
+    ArenaRelease(tree->nodes, p, sizeof(AVLTREENODE));
+}
+
+/* Free the retired nodes that no lookup can be looking at; called by writers */
+static void AvlReclaim(AVLTREE *tree)
+{
+    uint64_t oldest = __atomic_add_fetch(&_avlEpoch, 1, __ATOMIC_SEQ_CST); // lookups after this can't find any of them
+    AVL_READER *r;
+    unsigned i, j;
+    for(r = __atomic_load_n(&_avlReaders, __ATOMIC_ACQUIRE); r; r = r->next) {
+	uint64_t e = __atomic_load_n(&r->epoch, __ATOMIC_SEQ_CST);
+	if(e && e < oldest) oldest = e;
+    }
+    for(i=j=0; i<tree->numRetired; i++) {
+	if(tree->retired[i].epoch < oldest) AvlFreeNode(tree, tree->retired[i].node);
+	else tree->retired[j++] = tree->retired[i];
+    }
+    tree->numRetired = j;
+    tree->reclaimAt = MAX(AVL_RECLAIM, 2*j); // a lookup that's taking its time shouldn't make every delete reclaim
+}
+
+static void AvlRetire(AVLTREE *tree, AVLTREENODE *p)
+{
+    if(!tree->optimistic) { AvlFreeNode(tree, p); return; }
+    if(tree->numRetired == tree->maxRetired) {
+	tree->maxRetired = MAX(2*tree->maxRetired, AVL_RECLAIM);
+	tree->retired = Realloc(tree->retired, tree->maxRetired * sizeof(struct _avlRetired));
+    }
+    tree->retired[tree->numRetired].node = p;
+    tree->retired[tree->numRetired++].epoch = __atomic_load_n(&_avlEpoch, __ATOMIC_SEQ_CST);
+    if(tree->numRetired >= tree->reclaimAt) AvlReclaim(tree);
+}
+
+/* Look key up without locking; return false if writers kept getting in the way */
+static Boolean AvlOptimisticLookup(AVLTREE *tree, foint key, foint **pResult, foint *pInfo)
+{
+    AVL_READER *r = _avlReader ? _avlReader : AvlReaderInit();
+    Boolean done = false;
+    int tries, steps;
+    AvlReaderStart(r);
+    for(tries=0; tries<AVL_TRIES && !done; tries++) {
+	unsigned seq = __atomic_load_n(&tree->seq, __ATOMIC_ACQUIRE);
+	AVLTREENODE *p, *found = NULL;
+	foint info;
+	if(seq & 1) continue; // a writer is at it
+	p = __atomic_load_n(&tree->root, __ATOMIC_CONSUME);
+	for(steps=0; p && steps<AVL_MAX_STEPS; steps++) {
+	    foint k;
+	    k.ul = __atomic_load_n(&p->key.ul, __ATOMIC_RELAXED);
+	    int cmp = tree->cmpKey(key, k);
+	    if(cmp == 0) { found = p; info.ul = __atomic_load_n(&p->info.ul, __ATOMIC_RELAXED); break; }
+	    else if(cmp < 0) p = __atomic_load_n(&p->left, __ATOMIC_CONSUME);
+	    else p = (AVLTREENODE*)((uintptr_t)__atomic_load_n(&p->right, __ATOMIC_CONSUME) & ~3);
+	}
+	__atomic_thread_fence(__ATOMIC_ACQUIRE);
+	if(steps < AVL_MAX_STEPS && __atomic_load_n(&tree->seq, __ATOMIC_RELAXED) == seq) {
+	    *pResult = found ? &found->info : NULL;
+	    if(found && pInfo) *pInfo = info;
+	    done = true;
+	}
+    }
+    __atomic_store_n(&r->epoch, 0, __ATOMIC_RELEASE);
+    return done;
+}
+
 static foint CopyInt(foint i)
 {
     return i;
@@ -85,6 +215,12 @@ AVLTREE *AvlTreeAlloc(pCmpFcn cmpKey,
     tree->copyInfo = copyInfo ? copyInfo : CopyInt;
     tree->freeInfo = freeInfo ? freeInfo : FreeInt;
     tree->n = 0;
+    tree->nodes = ArenaAlloc(0, ARENA_SIZE_CLASSES);
+    tree->seq = 0;
+    tree->optimistic = true;
+    tree->retired = NULL;
+    tree->numRetired = tree->maxRetired = 0;
+    tree->reclaimAt = AVL_RECLAIM;
 
 #ifdef AVL_MUTEX_ONLY
 	pthread_mutex_init(&tree->readLock, NULL);
@@ -194,10 +330,13 @@ void StartWrite(AVLTREE *tree)
 #else
 	pthread_rwlock_wrlock(&tree->lock);
 #endif
+	__atomic_store_n(&tree->seq, tree->seq + 1, __ATOMIC_RELAXED); // odd: optimistic lookups will try again
+	__atomic_thread_fence(__ATOMIC_RELEASE);
 }
 
 void EndWrite(AVLTREE *tree)
 {
+	__atomic_store_n(&tree->seq, tree->seq + 1, __ATOMIC_RELEASE);
 #ifdef AVL_MUTEX_ONLY
 	pthread_mutex_unlock(&tree->globalLock);
 #else
@@ -260,11 +399,12 @@ foint* const UnsafeAvlTreeInsert(AVLTREE *tree, foint key, foint info)
 		return &p->info;
     }
 
-    p = (AVLTREENODE*) Calloc(1,sizeof(AVLTREENODE)); // insert a new leaf
+    p = (AVLTREENODE*) ArenaCalloc(tree->nodes, 1, sizeof(AVLTREENODE)); // insert a new leaf
     assert( ((uintptr_t)p & 3) == 0 ); // assert that the lower 2 bits can be used for balance
     p->key = tree->copyKey(key);
     p->info = tree->copyInfo(info);
     p->left = p->right = NULL; // also sets balance to 0
+	__atomic_thread_fence(__ATOMIC_RELEASE); // so that optimistic lookups can't find it before its key is there
 	setNodeFromLocative(P, p);
 
     // Now rotate and adjust balance at critical node, if any
@@ -339,17 +479,17 @@ Boolean AvlTreeLookDel(AVLTREE *tree, foint key, foint *pInfo)
 }
 
 
+static foint* const AvlLockedLookup(AVLTREE *tree, foint key, foint *pInfo);
+
 Boolean AvlTreeLookup(AVLTREE *tree, foint key, foint *pInfo)
 {
-	foint *result = UnsafeAvlTreeLookup(tree, key);
-
-	if (result != NULL) 
+	foint *result, info;
+	if (tree->optimistic && AvlOptimisticLookup(tree, key, &result, &info))
 	{
-		*pInfo = *result;
-		return true;
+		if (result && pInfo) *pInfo = info; // the copy we made while we knew it was right
+		return result != NULL;
 	}
-	else
-		return false;
+	return AvlLockedLookup(tree, key, pInfo) != NULL;
 }
 
 static void StartRead(AVLTREE *tree)
@@ -380,7 +520,8 @@ static void EndRead(AVLTREE * tree)
 #endif
 }
 
-foint* const UnsafeAvlTreeLookup(AVLTREE *tree, foint key)
+// if pInfo isn't NULL, copy the info into it while we still have the lock
+static foint* const AvlLockedLookup(AVLTREE *tree, foint key, foint *pInfo)
 {
     foint* result = NULL;
     StartRead(tree);
@@ -393,11 +534,19 @@ foint* const UnsafeAvlTreeLookup(AVLTREE *tree, foint key)
 		else if(cmp < 0) p = p->left;
 		else             p = getRight(p);
     }
+    if(result && pInfo) *pInfo = *result;
     
     EndRead(tree);
     return result;
 }
 
+foint* const UnsafeAvlTreeLookup(AVLTREE *tree, foint key)
+{
+    foint* result;
+    if(tree->optimistic && AvlOptimisticLookup(tree, key, &result, NULL)) return result;
+    return AvlLockedLookup(tree, key, NULL);
+}
+
 
 Boolean AvlTreeDelete(AVLTREE *tree, foint key)
 {
@@ -436,9 +585,7 @@ Boolean AvlTreeDelete(AVLTREE *tree, foint key)
 		q->left=p->left; q->right=p->right; // Directly using p->right OK because we want the balance as well
 	}
 
-	tree->freeKey(p->key);
-	tree->freeInfo(p->info);
-	Free(p);
+	AvlRetire(tree, p); // optimistic lookups may still be looking at it
 	tree->n--;
 
 	if (parent == p) // Edge case where <= 2 nodes are left and we delete the root
@@ -685,14 +832,17 @@ static void AvlTreeFreeHelper(AVLTREE *tree, AVLTREENODE *t)
 	tree->freeInfo(t->info);
 	assert(tree->n > 0);
 	tree->n--;
-	free(t);
     }
 }
 
 void AvlTreeFree(AVLTREE *tree)
 {
+    unsigned i;
     AvlTreeFreeHelper(tree, tree->root);
     assert(tree->n == 0);
+    for(i=0; i<tree->numRetired; i++) AvlFreeNode(tree, tree->retired[i].node); // nobody can be looking now
+    if(tree->retired) Free(tree->retired);
+    ArenaFree(tree->nodes); // all the nodes at once
 #ifdef AVL_MUTEX_ONLY
     pthread_mutex_destroy(&tree->readLock);
     pthread_mutex_destroy(&tree->globalLock);
@@ -40,6 +40,7 @@ BINTREE *BinTreeAlloc(pCmpFcn cmpKey,
     tree->copyInfo = copyInfo ? copyInfo : CopyInt;
     tree->freeInfo = freeInfo ? freeInfo : FreeInt;
     tree->physical_n = tree->n = tree->maxDepth = tree->depthSum = tree->depthSamples = 0;
+    tree->nodes = ArenaAlloc(0, ARENA_SIZE_CLASSES);
     return tree;
 }
 
@@ -74,7 +75,7 @@ foint* const UnsafeBinTreeInsert(BINTREE *tree, foint key, foint info)
     }
     tree->maxDepth = MAX(tree->maxDepth, depth); 
 
-    p = (BINTREENODE*) Calloc(1,sizeof(BINTREENODE));
+    p = (BINTREENODE*) ArenaCalloc(tree->nodes, 1, sizeof(BINTREENODE));
     p->key = tree->copyKey(key);
     p->info = tree->copyInfo(info);
     p->left = p->right = NULL;
@@ -107,7 +108,7 @@ void BinTreeDelNode(BINTREE *tree, BINTREENODE *p, BINTREENODE **P)
 	tree->freeKey(p->key);
 	assert(tree->physical_n > 0);
 	tree->physical_n--;
-	Free(p);
+	ArenaRelease(tree->nodes, p, sizeof(BINTREENODE));
     }
     assert(tree->n > 0); tree->n--;
 }
@@ -238,7 +239,6 @@ static void BinTreeFreeHelper(BINTREE *tree, BINTREENODE *p)
 	tree->freeKey(p->key);
 	tree->freeInfo(p->info);
 	if(!p->deleted) {assert(tree->n > 0); tree->n--; }
-	Free(p);
 	assert(tree->physical_n > 0);
 	tree->physical_n--;
     }
@@ -249,6 +249,7 @@ void BinTreeFree(BINTREE *tree)
     assert(0 <= tree->n && tree->n <= tree->physical_n);
     BinTreeFreeHelper(tree, tree->root);
     assert(tree->n == 0 && tree->physical_n == 0);
+    ArenaFree(tree->nodes); // all the nodes at once
     Free(tree);
 }
 
@@ -306,6 +307,7 @@ void BinTreeRebalance(BINTREE *tree, Boolean force)
     // Swap the roots and physical_n values
     int       tmpN = tree->physical_n; tree->physical_n = newTree->physical_n; newTree->physical_n = tmpN;
     BINTREENODE *p = tree->root;       tree->root       = newTree->root;       newTree->root       = p;
+    ARENA *nodes = tree->nodes;        tree->nodes      = newTree->nodes;      newTree->nodes      = nodes;
     BinTreeFree(newTree);
     inRebalance = false;
     fprintf(stderr,"r");
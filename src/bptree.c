@@ -0,0 +1,364 @@
+// This software is part of github.com/waynebhayes/libwayne, and is Copyright(C) Wayne B. Hayes 2025, under the GNU LGPL 3.0
+// (GNU Lesser General Public License, version 3, 2007), a copy of which is contained at the top of the repo.
+#ifdef __cplusplus
+extern "C" {
+#endif
+/* B+-tree: see bptree.h.  Leaves split in half when they fill up, and the split propagates up the
+** path we came down (kept in an array, so there's no recursion and no parent pointers).
+*/
+#include <string.h>
+#include "bptree.h"
+
+#define CACHE_LINE 64
+#define MAX_DEPTH 64	/* internal nodes have at least 2 children, so this is plenty */
+#define HALF (BPTREE_ORDER/2)
+
+static foint CopyInt(foint i) { return i; }
+static void FreeInt(foint i) {}
+
+BPTREE *BpTreeAlloc(pCmpFcn cmpKey,
+    pFointCopyFcn copyKey, pFointFreeFcn freeKey,
+    pFointCopyFcn copyInfo, pFointFreeFcn freeInfo)
+{
+    BPTREE *tree = Calloc(1, sizeof(BPTREE));
+    tree->cmpKey = cmpKey; // NULL means compare .i: see Cmp and Search
+    tree->copyKey = copyKey ? copyKey : CopyInt;
+    tree->freeKey = freeKey ? freeKey : FreeInt;
+    tree->copyInfo = copyInfo ? copyInfo : CopyInt;
+    tree->freeInfo = freeInfo ? freeInfo : FreeInt;
+    tree->nodes = ArenaAlloc(0, 0);
+    return tree;
+}
+
+static int Cmp(BPTREE *tree, foint a, foint b)
+{
+    if(!tree->cmpKey) return (a.i > b.i) - (a.i < b.i);
+    if(tree->cmpKey == (pCmpFcn)strcmp) return strcmp(a.s, b.s);
+    return tree->cmpKey(a, b);
+}
+
+/* The index of the first key in p that's >= key (p->n if none are), and whether it's equal. */
+static unsigned Search(BPTREE *tree, BPTREENODE *p, foint key, Boolean *found)
+{
+    unsigned lo = 0, hi = p->n, mid;
+    if(!tree->cmpKey) { // the loops are the same, but each calls its comparison directly
+	while(lo < hi) { mid = (lo+hi)/2; if(p->key[mid].i < key.i) lo = mid+1; else hi = mid; }
+	*found = (lo < p->n && p->key[lo].i == key.i);
+    }
+    else if(tree->cmpKey == (pCmpFcn)strcmp) {
+	while(lo < hi) { mid = (lo+hi)/2; if(strcmp(p->key[mid].s, key.s) < 0) lo = mid+1; else hi = mid; }
+	*found = (lo < p->n && strcmp(p->key[lo].s, key.s) == 0);
+    }
+    else {
+	while(lo < hi) { mid = (lo+hi)/2; if(tree->cmpKey(p->key[mid], key) < 0) lo = mid+1; else hi = mid; }
+	*found = (lo < p->n && tree->cmpKey(p->key[lo], key) == 0);
+    }
+    return lo;
+}
+
+static BPTREENODE *NewNode(BPTREE *tree, Boolean leaf)
+{
+    BPTREENODE *p = ArenaMallocAligned(tree->nodes, sizeof(BPTREENODE), CACHE_LINE);
+    p->n = 0;
+    p->leaf = leaf;
+    if(leaf) { p->u.l.next = NULL; tree->leaves++; }
+    else tree->internals++;
+    return p;
+}
+
+/* Build the tree from n sorted entries, copying them if copy is true, else taking them over.
+** The leaves and internal nodes are as full as they can be, and evenly so.
+*/
+static void Build(BPTREE *tree, unsigned n, foint keys[], foint info[], Boolean copy)
+{
+    unsigned m = (n + BPTREE_ORDER-2) / (BPTREE_ORDER-1), j, k = 0; // a leaf that's full up would split
+    BPTREENODE **level;
+    foint *low; // the smallest key under each node in level[]
+
+    tree->root = tree->first = NULL;
+    tree->depth = 0;
+    if(n == 0) return;
+    level = Malloc(m * sizeof(BPTREENODE*));
+    low = Malloc(m * sizeof(foint));
+    for(j=0; j<m; j++) {
+	BPTREENODE *p = NewNode(tree, true);
+	unsigned s;
+	p->n = n/m + (j < n%m);
+	for(s=0; s<p->n; s++, k++) {
+	    p->key[s] = copy ? tree->copyKey(keys[k]) : keys[k];
+	    p->u.l.info[s] = copy ? tree->copyInfo(info[k]) : info[k];
+	}
+	if(j) level[j-1]->u.l.next = p;
+	level[j] = p;
+	low[j] = p->key[0];
+    }
+    tree->first = level[0];
+    while(m > 1) { // make the level above, in place: we're always reading at or ahead of where we write
+	unsigned parents = (m + BPTREE_ORDER-1) / BPTREE_ORDER, c = 0;
+	for(j=0; j<parents; j++) {
+	    BPTREENODE *q = NewNode(tree, false);
+	    unsigned s, children = m/parents + (j < m%parents);
+	    foint qLow = low[c];
+	    q->n = children - 1;
+	    q->u.child[0] = level[c];
+	    for(s=1; s<children; s++) {
+		q->key[s-1] = tree->copyKey(low[c+s]);
+		q->u.child[s] = level[c+s];
+	    }
+	    c += children;
+	    level[j] = q;
+	    low[j] = qLow;
+	}
+	m = parents;
+	tree->depth++;
+    }
+    tree->root = level[0];
+    Free(level);
+    Free(low);
+}
+
+void BpTreeBulkLoad(BPTREE *tree, unsigned n, foint keys[], foint info[])
+{
+    unsigned i;
+    if(tree->root) Fatal("BpTreeBulkLoad: the tree isn't empty");
+    for(i=1; i<n; i++)
+	if(Cmp(tree, keys[i-1], keys[i]) >= 0) Fatal("BpTreeBulkLoad: keys %u and %u are out of order", i-1, i);
+    tree->n = n;
+    Build(tree, n, keys, info, true);
+}
+
+void BpTreeInsert(BPTREE *tree, foint key, foint info)
+{
+    UnsafeBpTreeInsert(tree, key, info);
+}
+
+foint* const UnsafeBpTreeInsert(BPTREE *tree, foint key, foint info)
+{
+    BPTREENODE *path[MAX_DEPTH], *p, *right;
+    unsigned slot[MAX_DEPTH], d, i;
+    Boolean found;
+    foint *result, sep;
+
+    if(!tree->root) tree->root = tree->first = NewNode(tree, true);
+    for(p = tree->root, d = 0; !p->leaf; d++) {
+	i = Search(tree, p, key, &found) + found;
+	path[d] = p;
+	slot[d] = i;
+	p = p->u.child[i];
+    }
+    i = Search(tree, p, key, &found);
+    if(found) {
+	tree->freeInfo(p->u.l.info[i]);
+	p->u.l.info[i] = tree->copyInfo(info);
+	return &p->u.l.info[i];
+    }
+    memmove(p->key + i+1, p->key + i, (p->n - i) * sizeof(foint));
+    memmove(p->u.l.info + i+1, p->u.l.info + i, (p->n - i) * sizeof(foint));
+    p->key[i] = tree->copyKey(key);
+    p->u.l.info[i] = tree->copyInfo(info);
+    result = &p->u.l.info[i];
+    ++p->n;
+    ++tree->n; assert(tree->n);
+    if(p->n < BPTREE_ORDER) return result;
+
+    // Split the leaf, then insert the new leaf's first key into the parent, and so on up while they're full
+    right = NewNode(tree, true);
+    right->n = BPTREE_ORDER - HALF;
+    memcpy(right->key, p->key + HALF, right->n * sizeof(foint));
+    memcpy(right->u.l.info, p->u.l.info + HALF, right->n * sizeof(foint));
+    p->n = HALF;
+    right->u.l.next = p->u.l.next;
+    p->u.l.next = right;
+    if(i >= HALF) result = &right->u.l.info[i - HALF];
+    sep = tree->copyKey(right->key[0]);
+    while(d > 0) {
+	BPTREENODE *q = path[--d];
+	i = slot[d];
+	memmove(q->key + i+1, q->key + i, (q->n - i) * sizeof(foint));
+	memmove(q->u.child + i+2, q->u.child + i+1, (q->n - i) * sizeof(BPTREENODE*));
+	q->key[i] = sep;
+	q->u.child[i+1] = right;
+	if(++q->n < BPTREE_ORDER) return result;
+	// q has BPTREE_ORDER+1 children: keep HALF+1 of them, and the key between the halves goes up
+	right = NewNode(tree, false);
+	right->n = BPTREE_ORDER - HALF - 1;
+	memcpy(right->key, q->key + HALF+1, right->n * sizeof(foint));
+	memcpy(right->u.child, q->u.child + HALF+1, (right->n + 1) * sizeof(BPTREENODE*));
+	sep = q->key[HALF];
+	q->n = HALF;
+    }
+    p = NewNode(tree, false); // a new root
+    p->n = 1;
+    p->key[0] = sep;
+    p->u.child[0] = tree->root;
+    p->u.child[1] = right;
+    tree->root = p;
+    tree->depth++; assert(tree->depth < MAX_DEPTH);
+    return result;
+}
+
+static void DeleteAt(BPTREE *tree, BPTREENODE *p, unsigned i)
+{
+    tree->freeKey(p->key[i]);
+    tree->freeInfo(p->u.l.info[i]);
+    memmove(p->key + i, p->key + i+1, (p->n - i-1) * sizeof(foint));
+    memmove(p->u.l.info + i, p->u.l.info + i+1, (p->n - i-1) * sizeof(foint));
+    --p->n;
+    assert(tree->n > 0); --tree->n;
+}
+
+static void FreeInternals(BPTREE *tree, BPTREENODE *p)
+{
+    if(!p->leaf) {
+	unsigned i;
+	for(i=0; i<p->n; i++) tree->freeKey(p->key[i]);
+	for(i=0; i<=p->n; i++) FreeInternals(tree, p->u.child[i]);
+    }
+}
+
+/* Leaves aren't merged as they empty, so when there are few keys per leaf, rebuild the tree */
+static void Shrink(BPTREE *tree)
+{
+    if(tree->leaves > 1 && tree->n < tree->leaves * (BPTREE_ORDER/8)) {
+	foint *keys = Malloc(MAX(tree->n, 1) * sizeof(foint)), *info = Malloc(MAX(tree->n, 1) * sizeof(foint));
+	ARENA *old = tree->nodes;
+	BPTREENODE *p;
+	unsigned k = 0;
+	for(p = tree->first; p; p = p->u.l.next) {
+	    memcpy(keys + k, p->key, p->n * sizeof(foint));
+	    memcpy(info + k, p->u.l.info, p->n * sizeof(foint));
+	    k += p->n;
+	}
+	assert(k == tree->n);
+	FreeInternals(tree, tree->root);
+	tree->nodes = ArenaAlloc(0, 0);
+	tree->leaves = tree->internals = 0;
+	Build(tree, tree->n, keys, info, false);
+	ArenaFree(old);
+	Free(keys);
+	Free(info);
+    }
+}
+
+Boolean BpTreeLookDel(BPTREE *tree, foint key, foint *pInfo)
+{
+    Boolean delete = (long)pInfo==1;
+    foint *result = UnsafeBpTreeLookDel(tree, key, delete);
+    if(result != NULL) {
+	if(pInfo && !delete) *pInfo = *result; // lookup with assign
+	return true;
+    }
+    else
+	return false;
+}
+
+foint* const UnsafeBpTreeLookDel(BPTREE *tree, foint key, Boolean delete)
+{
+    BPTREENODE *p = tree->root;
+    Boolean found;
+    unsigned i;
+    if(!p) return NULL;
+    while(!p->leaf) {
+	i = Search(tree, p, key, &found);
+	p = p->u.child[i + found];
+    }
+    i = Search(tree, p, key, &found);
+    if(!found) return NULL;
+    if(!delete) return &p->u.l.info[i];
+    DeleteAt(tree, p, i);
+    Shrink(tree);
+    return (foint*)1;
+}
+
+/* Call f on the entries from leaf p, index i, on, stopping before hi if it's not NULL */
+static int TraverseFrom(foint globals, BPTREE *tree, BPTREENODE *p, unsigned i, foint *hi, pFointTraverseFcn f)
+{
+    int cont = 1;
+    for(; p && cont; p = p->u.l.next, i = 0) {
+	while(i < p->n && cont) {
+	    if(hi && Cmp(tree, p->key[i], *hi) >= 0) { p = NULL; break; }
+	    cont = f(globals, p->key[i], p->u.l.info[i]);
+	    if(cont == -1) DeleteAt(tree, p, i); // and the next one moves down to i
+	    else ++i;
+	}
+	if(!p) break;
+    }
+    Shrink(tree);
+    return cont != 0;
+}
+
+int BpTreeTraverse(foint globals, BPTREE *tree, pFointTraverseFcn f)
+{
+    return TraverseFrom(globals, tree, tree->first, 0, NULL, f);
+}
+
+int BpTreeTraverseRange(foint globals, BPTREE *tree, foint lo, foint hi, pFointTraverseFcn f)
+{
+    BPTREENODE *p = tree->root;
+    Boolean found;
+    if(!p) return 1;
+    while(!p->leaf) {
+	unsigned i = Search(tree, p, lo, &found);
+	p = p->u.child[i + found];
+    }
+    return TraverseFrom(globals, tree, p, Search(tree, p, lo, &found), &hi, f);
+}
+
+/* Check the subtree at p, all of whose keys must be in [*lo, *hi) (NULL meaning unbounded) */
+static unsigned _sanityN, _sanityLeaves, _sanityInternals;
+static BPTREENODE *_sanityLastLeaf;
+static void SanityHelper(BPTREE *tree, BPTREENODE *p, unsigned depth, foint *lo, foint *hi)
+{
+    unsigned i;
+    assert(p->n <= BPTREE_ORDER-1);
+    for(i=0; i<p->n; i++) {
+	if(i) assert(Cmp(tree, p->key[i-1], p->key[i]) < 0);
+	if(lo) assert(Cmp(tree, *lo, p->key[i]) <= 0);
+	if(hi) assert(Cmp(tree, p->key[i], *hi) < 0);
+    }
+    if(p->leaf) {
+	assert(depth == tree->depth);
+	if(_sanityLastLeaf) assert(_sanityLastLeaf->u.l.next == p); // the leaves are linked in order
+	else assert(p == tree->first);
+	_sanityLastLeaf = p;
+	_sanityN += p->n;
+	_sanityLeaves++;
+    }
+    else {
+	_sanityInternals++;
+	for(i=0; i<=p->n; i++)
+	    SanityHelper(tree, p->u.child[i], depth+1, i ? &p->key[i-1] : lo, i < p->n ? &p->key[i] : hi);
+    }
+}
+
+Boolean BpTreeSanityCheck(BPTREE *tree)
+{
+    _sanityN = _sanityLeaves = _sanityInternals = 0;
+    _sanityLastLeaf = NULL;
+    if(tree->root) {
+	SanityHelper(tree, tree->root, 0, NULL, NULL);
+	assert(_sanityLastLeaf->u.l.next == NULL);
+    }
+    else assert(tree->first == NULL && tree->depth == 0);
+    assert(_sanityN == tree->n);
+    assert(_sanityLeaves == tree->leaves && _sanityInternals == tree->internals);
+    return true;
+}
+
+void BpTreeFree(BPTREE *tree)
+{
+    BPTREENODE *p;
+    if(tree->root) FreeInternals(tree, tree->root);
+    for(p = tree->first; p; p = p->u.l.next) {
+	unsigned i;
+	for(i=0; i<p->n; i++) {
+	    tree->freeKey(p->key[i]);
+	    tree->freeInfo(p->u.l.info[i]);
+	}
+    }
+    ArenaFree(tree->nodes); // all the nodes at once
+    Free(tree);
+}
+#ifdef __cplusplus
+} // end extern "C"
+#endif
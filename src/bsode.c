@@ -6,6 +6,7 @@ extern "C" {
 #include <math.h>
 #include <assert.h>
 #include <malloc.h>
+#include <pthread.h>
 #include "misc.h"
 #include "bsode.h"
 #include "matvec.h"
@@ -41,17 +42,30 @@ BSODE *BsodeAlloc(int n, double t, double *y, F_EVAL f, int stiff_flag,
     return b;
 }
 
+/*
+** The Numerical Recipes odeint and its stepper keep state in statics, so only one thread at a time
+** may be inside them, and an integration can't be started from inside another one's F.
+*/
+static pthread_mutex_t _odeintLock = PTHREAD_MUTEX_INITIALIZER;
+static __thread int _inOdeint;
+
 /* Do the actual integration.  Return the actual TOUT */
 double BsodeIntegrate(BSODE *b, double TOUT)
 {
     int direction = TOUT - b->T > 0 ? 1 : -1;
     int nok, nbad;
 
+    if(_inOdeint) Fatal("BsodeIntegrate: can't be called from inside a derivative function odeint is integrating");
+
     while(direction*(b->T - TOUT) < 0)
     {
 	int status;
+	pthread_mutex_lock(&_odeintLock);
+	_inOdeint = 1;
 	status = odeint(b->Y, b->N, &b->T, TOUT, b->EPS, b->H0, b->HMIN,
 	    &nok, &nbad, b->F, bsstep);
+	_inOdeint = 0;
+	pthread_mutex_unlock(&_odeintLock);
 
 	switch(status)
 	{
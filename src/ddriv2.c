@@ -102,10 +102,10 @@ void Ddriv2Free(DDRIV2 *d)
  */
 
 #if INTEGRATOR_PROGRESS
-static double prevTime;
+static __thread double prevTime;
 static integrator_progress = true;
 #endif
-static DDRIV2 *_gd;
+static __thread DDRIV2 *_gd; /* the object this thread is integrating; all DDRIV2's own state is in the object */
 
 
 static void FORT_F(int *NN, double *TT, double *YY, double *YP)
@@ -133,6 +133,7 @@ static double FORT_G(int *NN, double *TT, double *YY, int *IROOT)
 double Ddriv2Integrate(DDRIV2 *d, double TOUT) /* returns actual tout */
 {
     int direction = TOUT - d->T > 0 ? 1 : -1;
+    DDRIV2 *outer = _gd; /* in case we're being called from inside another DDRIV2's F or G */
 
     _gd = d;
 
@@ -156,6 +157,7 @@ double Ddriv2Integrate(DDRIV2 *d, double TOUT) /* returns actual tout */
 	case 5:   /* Root found. Index of which is in 6th element of IWORK */
 	    assert(d->NROOT > 0);
 	    d->whichRoot = IFA(d->IW,6)-1;
+	    _gd = outer;
 	    return d->T;
 	    break;
 	case 6:           /* F set N to zero */
@@ -177,6 +179,7 @@ double Ddriv2Integrate(DDRIV2 *d, double TOUT) /* returns actual tout */
 		(IFA(d->IW,16) == 1 ? "nonstiff" : "STIFF") );
 	#endif
     }
+    _gd = outer;
     return d->T;
 }
 #ifdef __cplusplus
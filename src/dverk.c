@@ -70,7 +70,7 @@ void DverkFree(DVERK *d)
  */
 
 
-static DVERK *gr;
+static __thread DVERK *gr; /* the object this thread is integrating; all DVERK's own state is in the object */
 
 static void FORT_F(int *NN, double *TT, double *YY, double *YP)
 {
@@ -82,6 +82,7 @@ double DverkIntegrate(DVERK *r, double TOUT) /* returns actual tout */
 {
     int direction = TOUT - r->T > 0 ? 1 : -1;
     extern void dverk_(int*,...);
+    DVERK *outer = gr; /* in case we're being called from inside another DVERK's F */
 
     gr = r;
 
@@ -119,6 +120,7 @@ double DverkIntegrate(DVERK *r, double TOUT) /* returns actual tout */
 	    break;
 	}
     }
+    gr = outer;
     return r->T;
 }
 #ifdef __cplusplus
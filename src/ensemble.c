@@ -0,0 +1,198 @@
+// This software is part of github.com/waynebhayes/libwayne, and is Copyright(C) Wayne B. Hayes 2025, under the GNU LGPL 3.0
+// (GNU Lesser General Public License, version 3, 2007), a copy of which is contained at the top of the repo.
+#ifdef __cplusplus
+extern "C" {
+#endif
+#include <math.h>
+#include <float.h>
+#include <assert.h>
+#include "misc.h"
+#include "ensemble.h"
+
+/*
+** Every loop that touches the state is "for(i<N) for(m<M)" with j = i*M+m, so the inner loop is unit stride
+** and, since per-member choices are made with ?: rather than branches, the compiler vectorizes all of them.
+*/
+
+#define RK4_VECS 5	// K, Ytmp, dx1, dx2, dx3
+#define RK23_VECS 6	// K1..K4, Ytmp, Y3
+#define MEMBER_VECS 4	// Tstage, h, err, ok
+
+ENSEMBLE *EnsembleAlloc(ENSEMBLE_METHOD method, int n, int m, double t, double *y, F_EVAL_BATCH f, void *arg,
+    double dt, double tol)
+{
+    ENSEMBLE *e = Calloc(1, sizeof(ENSEMBLE));
+    int i, vecs;
+    assert(n > 0 && m > 0);
+    if(dt <= 0) Fatal("EnsembleAlloc: timestep must be positive, not %g", dt);
+    switch(method) {
+    case ENSEMBLE_RK4: vecs = RK4_VECS; break;
+    case ENSEMBLE_RK23: vecs = RK23_VECS;
+	if(tol <= 0) Fatal("EnsembleAlloc: RK23 needs a positive tolerance, not %g", tol);
+	break;
+    default: Fatal("EnsembleAlloc: unknown method %d", method); vecs = 0;
+    }
+    e->method = method;
+    e->N = n; e->M = m;
+    e->Y = y;
+    e->F = f; e->arg = arg;
+    e->TOL = tol;
+    e->HMIN = 0; e->HMAX = HUGE_VAL;
+    e->T = Malloc(2*m*sizeof(double));
+    e->H = e->T + m;
+    for(i=0; i<m; i++) { e->T[i] = t; e->H[i] = dt; }
+    e->work = Malloc(((size_t)vecs*n*m + MEMBER_VECS*m)*sizeof(double));
+    return e;
+}
+
+void EnsembleFree(ENSEMBLE *e)
+{
+    Free(e->work);
+    Free(e->T);
+    Free(e);
+}
+
+void EnsembleGetMember(const ENSEMBLE *e, int m, double *y)
+{
+    int i;
+    assert(0 <= m && m < e->M);
+    for(i=0; i<e->N; i++) y[i] = e->Y[i*e->M + m];
+}
+
+void EnsembleSetMember(ENSEMBLE *e, int m, const double *y)
+{
+    int i;
+    assert(0 <= m && m < e->M);
+    for(i=0; i<e->N; i++) e->Y[i*e->M + m] = y[i];
+}
+
+void EnsembleScalarF(int N, int M, const double *T, const double *Y, double *Ydot, void *arg)
+{
+    F_EVAL f = *(F_EVAL*)arg;
+    double y[N], ydot[N];
+    int i, m;
+    for(m=0; m<M; m++) {
+	for(i=0; i<N; i++) y[i] = Y[i*M + m];
+	f(N, T[m], y, ydot);
+	for(i=0; i<N; i++) Ydot[i*M + m] = ydot[i];
+    }
+}
+
+// The same arithmetic, in the same order, as Rk4Integrate, so each member gets exactly what Rk4 would give it.
+static void EnsembleRk4(ENSEMBLE *e, double tout)
+{
+    const int N = e->N, M = e->M, NM = N*M;
+    double *restrict Y = e->Y, *restrict K = e->work, *restrict Yt = K + NM;
+    double *restrict dx1 = Yt + NM, *restrict dx2 = dx1 + NM, *restrict dx3 = dx2 + NM, *Ts = dx3 + NM;
+    double T = e->T[0], dt;
+    int nsteps, step, j, m;
+
+    assert(tout >= T);
+    if(T == tout) return;
+    nsteps = ceil((tout - T)/e->H[0]);
+    dt = (tout - T)/nsteps;
+
+    for(step=0; step < nsteps; step++)
+    {
+	for(m=0; m<M; m++) Ts[m] = T;
+	e->F(N, M, Ts, Y, K, e->arg);
+	for(j=0; j<NM; j++) { dx1[j] = dt*K[j]; Yt[j] = Y[j] + dx1[j]/2; }
+
+	for(m=0; m<M; m++) Ts[m] = T+dt/2;
+	e->F(N, M, Ts, Yt, K, e->arg);
+	for(j=0; j<NM; j++) { dx2[j] = dt*K[j]; Yt[j] = Y[j] + dx2[j]/2; }
+
+	e->F(N, M, Ts, Yt, K, e->arg);
+	for(j=0; j<NM; j++) { dx3[j] = dt*K[j]; Yt[j] = Y[j] + dx3[j]; }
+
+	for(m=0; m<M; m++) Ts[m] = T+dt;
+	e->F(N, M, Ts, Yt, K, e->arg);
+	for(j=0; j<NM; j++) Y[j] += (dx1[j] + dt*K[j])/6 + (dx2[j] + dx3[j])/3;
+
+	T += dt;
+	e->nEval += 4;
+    }
+    e->nAccept += (long)nsteps*M;
+    for(m=0; m<M; m++) e->T[m] = tout;
+}
+
+/*
+** Bogacki-Shampine 2(3), first-same-as-last: K4 of an accepted step is K1 of the next. Members are advanced
+** together; a member that's finished, or whose step failed, simply doesn't take this one (its h is 0 or its
+** result is discarded), so there are no per-member branches inside the stage loops.
+*/
+static void EnsembleRk23(ENSEMBLE *e, double tout)
+{
+    const int N = e->N, M = e->M, NM = N*M;
+    double *restrict Y = e->Y, *restrict K1 = e->work, *restrict K2 = K1 + NM, *restrict K3 = K2 + NM;
+    double *restrict K4 = K3 + NM, *restrict Yt = K4 + NM, *restrict Y3 = Yt + NM;
+    double *restrict Ts = Y3 + NM, *restrict h = Ts + M, *restrict err = h + M, *restrict ok = err + M;
+    double *restrict T = e->T, *restrict H = e->H;
+    int i, j, m, active;
+
+    e->F(N, M, T, Y, K1, e->arg);
+    e->nEval++;
+    for(;;)
+    {
+	for(active=0, m=0; m<M; m++) {
+	    assert(T[m] <= tout);
+	    h[m] = T[m] < tout ? MIN(H[m], tout - T[m]) : 0;
+	    active += (h[m] > 0);
+	}
+	if(!active) break;
+
+	for(i=0; i<N; i++) for(m=0; m<M; m++) { j=i*M+m; Yt[j] = Y[j] + h[m]*(K1[j]/2); }
+	for(m=0; m<M; m++) Ts[m] = T[m] + h[m]/2;
+	e->F(N, M, Ts, Yt, K2, e->arg);
+
+	for(i=0; i<N; i++) for(m=0; m<M; m++) { j=i*M+m; Yt[j] = Y[j] + h[m]*(3*K2[j]/4); }
+	for(m=0; m<M; m++) Ts[m] = T[m] + 3*h[m]/4;
+	e->F(N, M, Ts, Yt, K3, e->arg);
+
+	for(i=0; i<N; i++) for(m=0; m<M; m++) {
+	    j=i*M+m; Y3[j] = Y[j] + h[m]*(2*K1[j]/9 + K2[j]/3 + 4*K3[j]/9);
+	}
+	for(m=0; m<M; m++) Ts[m] = T[m] + h[m];
+	e->F(N, M, Ts, Y3, K4, e->arg);
+	e->nEval += 3;
+
+	// error estimate: the 3rd order solution minus the embedded 2nd order one, scaled per component
+	for(m=0; m<M; m++) err[m] = 0;
+	for(i=0; i<N; i++) for(m=0; m<M; m++) {
+	    j=i*M+m;
+	    double est = fabs(h[m]*(-5*K1[j]/72 + K2[j]/12 + K3[j]/9 - K4[j]/8));
+	    double scale = e->TOL * MAX(1.0, MAX(fabs(Y[j]), fabs(Y3[j])));
+	    err[m] = MAX(err[m], est/scale);
+	}
+
+	for(m=0; m<M; m++) {
+	    if(h[m] == 0) { ok[m] = 0; continue; }
+	    ok[m] = (err[m] <= 1 || h[m] <= e->HMIN);
+	    if(!ok[m] && h[m] <= DBL_EPSILON*fabs(T[m])) // includes err == NaN
+		Fatal("EnsembleIntegrate: step size underflow for member %d at T=%g", m, T[m]);
+	    if(ok[m]) e->nAccept++; else e->nReject++;
+	    double factor = err[m] == 0 ? 5 : 0.9*pow(err[m], -1/3.0);
+	    factor = MAX(0.2, MIN(5, factor));
+	    // a step cut short to land on tout says nothing new about how big the next one can be
+	    if(!(ok[m] && h[m] < H[m])) H[m] = MAX(e->HMIN, MIN(e->HMAX, h[m]*factor));
+	    if(ok[m]) T[m] = (h[m] == tout - T[m]) ? tout : T[m] + h[m];
+	}
+	for(i=0; i<N; i++) for(m=0; m<M; m++) {
+	    j=i*M+m;
+	    Y[j] = ok[m] != 0 ? Y3[j] : Y[j];
+	    K1[j] = ok[m] != 0 ? K4[j] : K1[j];
+	}
+    }
+}
+
+double EnsembleIntegrate(ENSEMBLE *e, double tout)
+{
+    switch(e->method) {
+    case ENSEMBLE_RK4: EnsembleRk4(e, tout); break;
+    case ENSEMBLE_RK23: EnsembleRk23(e, tout); break;
+    }
+    return tout;
+}
+#ifdef __cplusplus
+} // end extern "C"
+#endif
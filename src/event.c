@@ -18,6 +18,7 @@ extern "C" {
 #include "misc.h"
 #include "event.h"
 #include "priority-queue.h"
+#include "Oalloc.h"
 
 
 #define SANITY 0	/* perform PriorityQueue Sanity Checks? */
@@ -98,6 +99,201 @@ EventInfo *EventNext(void)
     return next;
 }
 
+
+/*
+** EVENT_LIST: a calendar queue.  Event times are divided into "days" of
+** length width; day d is kept in bucket d % numDays as a list sorted by time,
+** so a bucket holds the events of several "years" interleaved.  EventListNext
+** walks the buckets from today, taking the head of a bucket if it's due
+** today; after a whole year of empty days it finds the earliest event directly.
+** Whenever the number of events passes 2*numDays or drops below numDays/2 the
+** calendar is rebuilt with twice or half as many days, and width re-estimated
+** as 3 times the average gap between the first few pending events, ignoring
+** unusually big gaps (Brown's heuristic).
+*/
+
+#define CQ_MIN_DAYS 16
+#define CQ_SAMPLE 25	/* events sampled to choose the width of a day */
+#define CQ_MAX_DAY 4e18	/* day numbers are clamped to fit in a uint64_t */
+
+typedef struct _calEvent {
+    EventInfo info;	/* first, so that an EventInfo* handle is a CAL_EVENT* */
+    struct _calEvent *next, *prev;
+    uint64_t day;	/* time/width, rounded down */
+    unsigned gen;	/* bumped each time the record is recycled, so old handles don't match */
+    Boolean queued;
+} CAL_EVENT;
+
+struct _eventList {
+    Time now;
+    int n, numDays;	/* numDays is a power of 2 */
+    CAL_EVENT **bucket;
+    double width, invWidth;
+    uint64_t today;	/* no pending event is due before this day */
+    ARENA *pool;	/* of CAL_EVENTs, recycled through its free list */
+};
+
+static uint64_t CqDay(EVENT_LIST *L, Time t)
+{
+    double d = t * L->invWidth;
+    return d < CQ_MAX_DAY ? (uint64_t)d : (uint64_t)CQ_MAX_DAY;
+}
+
+/* Put e in its bucket, after any events with the same time. */
+static void CqAdd(EVENT_LIST *L, CAL_EVENT *e)
+{
+    CAL_EVENT **pp, *prev = NULL;
+    e->day = CqDay(L, e->info.time);
+    pp = &L->bucket[e->day & (L->numDays-1)];
+    while(*pp && (*pp)->info.time <= e->info.time) {
+	prev = *pp;
+	pp = &prev->next;
+    }
+    e->prev = prev;
+    e->next = *pp;
+    if(*pp) (*pp)->prev = e;
+    *pp = e;
+    e->queued = true;
+    ++L->n;
+}
+
+static void CqUnlink(EVENT_LIST *L, CAL_EVENT *e)
+{
+    if(e->prev) e->prev->next = e->next;
+    else L->bucket[e->day & (L->numDays-1)] = e->next;
+    if(e->next) e->next->prev = e->prev;
+    e->queued = false;
+    --L->n;
+}
+
+static CAL_EVENT *CqRemoveFirst(EVENT_LIST *L)
+{
+    const uint64_t mask = L->numDays-1;
+    CAL_EVENT *e;
+    int i;
+    if(L->n == 0) return NULL;
+    for(i=0; i<L->numDays; i++, L->today++) {
+	e = L->bucket[L->today & mask];
+	if(e && e->day <= L->today) {
+	    CqUnlink(L, e);
+	    return e;
+	}
+    }
+    /* nothing for a year: the events are sparse, so jump to the earliest */
+    e = NULL;
+    for(i=0; i<L->numDays; i++)
+	if(L->bucket[i] && (!e || L->bucket[i]->info.time < e->info.time))
+	    e = L->bucket[i];
+    L->today = e->day;
+    CqUnlink(L, e);
+    return e;
+}
+
+static void CqResize(EVENT_LIST *L, int numDays)
+{
+    CAL_EVENT *sample[CQ_SAMPLE], *rest = NULL, **tail = &rest, *e;
+    int i, k = MIN(L->n, CQ_SAMPLE);
+
+    for(i=0; i<k; i++)
+	sample[i] = CqRemoveFirst(L);
+    for(i=0; i<L->numDays; i++) {	/* keeping each bucket in order, so ties stay in order */
+	*tail = L->bucket[i];
+	while(*tail) tail = &(*tail)->next;
+    }
+    L->n = 0;
+
+    if(k >= 2) {
+	double meanGap = (sample[k-1]->info.time - sample[0]->info.time) / (k-1), sum = 0;
+	int m = 0;
+	for(i=1; i<k; i++) {
+	    double gap = sample[i]->info.time - sample[i-1]->info.time;
+	    if(gap <= 2*meanGap) { sum += gap; ++m; }
+	}
+	if(sum > 0) {
+	    L->width = 3*sum/m;
+	    L->invWidth = 1/L->width;
+	}
+    }
+
+    Free(L->bucket);
+    L->bucket = Calloc(numDays, sizeof(CAL_EVENT*));
+    L->numDays = numDays;
+    L->today = CqDay(L, L->now);
+    for(i=0; i<k; i++)
+	CqAdd(L, sample[i]);
+    while((e = rest)) {
+	rest = e->next;
+	CqAdd(L, e);
+    }
+}
+
+static void CqRecycle(EVENT_LIST *L, CAL_EVENT *e)
+{
+    ++e->gen;	/* ArenaRelease only overwrites the first word, so this survives until the record is reused */
+    ArenaRelease(L->pool, e, sizeof(CAL_EVENT));
+    if(L->numDays > CQ_MIN_DAYS && L->n < L->numDays/2)
+	CqResize(L, L->numDays/2);
+}
+
+EVENT_LIST *EventListAlloc(void)
+{
+    EVENT_LIST *L = Calloc(1, sizeof(EVENT_LIST));
+    L->numDays = CQ_MIN_DAYS;
+    L->bucket = Calloc(L->numDays, sizeof(CAL_EVENT*));
+    L->width = L->invWidth = 1;
+    L->pool = ArenaAlloc(0, ARENA_SIZE_CLASSES);
+    return L;
+}
+
+void EventListFree(EVENT_LIST *L)
+{
+    ArenaFree(L->pool);
+    Free(L->bucket);
+    Free(L);
+}
+
+EVENT_HANDLE EventListInsert(EVENT_LIST *L, Event event, Time delta, Object object)
+{
+    CAL_EVENT *e = ArenaMalloc(L->pool, sizeof(CAL_EVENT));
+    EVENT_HANDLE h;
+    assert(delta >= 0.0 && delta <= 10.0e10);
+    e->info.time = L->now + delta;
+    e->info.event = event;
+    e->info.object = object;
+    CqAdd(L, e);
+    if(L->n > 2*L->numDays)
+	CqResize(L, 2*L->numDays);
+    h.info = &e->info;
+    h.gen = e->gen;	/* whatever it was: only changes matter */
+    return h;
+}
+
+int EventListCancel(EVENT_LIST *L, EVENT_HANDLE handle)
+{
+    CAL_EVENT *e = (CAL_EVENT*)handle.info;
+    if(!e->queued || e->gen != handle.gen) return 0;
+    CqUnlink(L, e);
+    CqRecycle(L, e);
+    return 1;
+}
+
+int EventListNext(EVENT_LIST *L)
+{
+    CAL_EVENT *e = CqRemoveFirst(L);
+    Event event;
+    Object object;
+    if(!e) return 0;
+    L->now = e->info.time;
+    event = e->info.event;
+    object = e->info.object;
+    CqRecycle(L, e);	/* before the event, which will likely want a record */
+    event(object);
+    return 1;
+}
+
+Time EventListNow(EVENT_LIST *L) { return L->now; }
+int EventListSize(EVENT_LIST *L) { return L->n; }
+
 #ifdef __cplusplus
 } // end extern "C"
 #endif
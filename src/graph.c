@@ -6,6 +6,7 @@ extern "C" {
 #include "misc.h"
 #include "sets.h"
 #include "graph.h"
+#include "sorts.h"
 #include "queue.h"
 #include "rand48.h"
 #include "Oalloc.h"
@@ -92,11 +93,13 @@ static void GraphFreeInternals(GRAPH *G)
     if(G->edgeList) Free(G->edgeList);
     if(G->neighbor) Free(G->neighbor);
     if(G->weight) Free(G->weight);
+    if(G->nameDict) TreeFree(G->nameDict);
     if(G->name) {
-	for(i=0;i<G->n;i++) Free(G->name[i]);
+	if(G->nameArena) ArenaFree(G->nameArena);
+	else for(i=0;i<G->n;i++) Free(G->name[i]);
 	Free(G->name);
     }
-    if(G->nameDict) TreeFree(G->nameDict);
+    G->nameArena = NULL;
 }
 
 void GraphFree(GRAPH *G) {
@@ -127,7 +130,7 @@ GRAPH *GraphCopy(GRAPH *G)
 }
 
 #if SORT_NEIGHBORS
-// Used when qsort'ing the neighbors when graph is sparse.
+// Used when bsearch'ing the sorted neighbors when graph is sparse.
 static int IntCmp(const void *a, const void *b)
 {
     const int *i = (const int*)a, *j = (const int*)b;
@@ -140,7 +143,7 @@ static GRAPH *GraphSort(GRAPH *G)
     int v;
     for(v=0; v<G->n; v++) if(!SetIn(G->sorted, v)) 
     {
-	qsort(G->neighbor[v], G->degree[v], sizeof(G->degree[0]), IntCmp);
+	RadixSortU32(G->neighbor[v], G->degree[v]);
 	SetAdd(G->sorted, v);
     }
     return G;
@@ -562,6 +565,7 @@ GRAPH *GraphAddEdgeList(GRAPH *G, FILE *fp, Boolean directed, Boolean supportNod
     TREETYPE *nameDict=NULL;
     char **names=NULL;
     unsigned namesCap=0;
+    ARENA *nameArena=NULL; // names are read once and never freed individually, so they're packed in here
 
     unsigned *degCap=NULL;   // degCap[v]: exact number of times v will be connected in pass 2 (upper bound; duplicate edges in the input are counted here but silently skipped in pass 2, same as GraphConnect always did)
     unsigned degCapAlloc=0;
@@ -607,7 +611,7 @@ GRAPH *GraphAddEdgeList(GRAPH *G, FILE *fp, Boolean directed, Boolean supportNod
 	unsigned i, j;
 	if(supportNodeNames)
 	{
-	    if(!nameDict) nameDict = TreeAlloc((pCmpFcn)strcmp, (pFointCopyFcn)strdup, (pFointFreeFcn)free, NULL, NULL);
+	    if(!nameDict) { nameArena = ArenaAlloc(0, 0); nameDict = TreeAlloc((pCmpFcn)strcmp, NULL, NULL, NULL, NULL); }
 	    if(namesCap==0) { namesCap = MIN_EDGELIST; names = Malloc(namesCap*sizeof(names[0])); }
 	    foint f1, f2;
 	    Boolean new1 = !TreeLookup(nameDict, (foint)v1, &f1);
@@ -616,8 +620,8 @@ GRAPH *GraphAddEdgeList(GRAPH *G, FILE *fp, Boolean directed, Boolean supportNod
 	    if(haveHeaderN && numNodes+newCount > headerN)
 		Fatal("GraphAddEdgeList: header declared only %u nodes but another distinct name appeared on line %d", headerN, lineNum);
 	    while(numNodes+newCount > namesCap) { namesCap *= 2; names = Realloc(names, namesCap*sizeof(names[0])); }
-	    if(new1) { names[numNodes]=Strdup(v1); f1.i=numNodes++; TreeInsert(nameDict,(foint)v1,f1); }
-	    if(new2) { names[numNodes]=Strdup(v2); f2.i=numNodes++; TreeInsert(nameDict,(foint)v2,f2); }
+	    if(new1) { names[numNodes]=ArenaStrdup(nameArena,v1); f1.i=numNodes; TreeInsert(nameDict,(foint)names[numNodes++],f1); }
+	    if(new2) { names[numNodes]=ArenaStrdup(nameArena,v2); f2.i=numNodes; TreeInsert(nameDict,(foint)names[numNodes++],f2); }
 	    i = f1.i; j = f2.i;
 	}
 	else {
@@ -664,6 +668,7 @@ GRAPH *GraphAddEdgeList(GRAPH *G, FILE *fp, Boolean directed, Boolean supportNod
     if(supportNodeNames) {
 	G->name = Realloc(names, MAX(numNodes,1)*sizeof(names[0])); // shrink to exact size, once
 	G->nameDict = nameDict;
+	G->nameArena = nameArena;
     }
     Free(degCap);
 
@@ -759,10 +764,12 @@ GRAPH *GraphReadEdgeList(GRAPH *G, FILE *fp, Boolean directed, Boolean supportNo
     unsigned maxNodes=MIN_EDGELIST;
     char **names = NULL;
     TREETYPE *nameDict = NULL;
+    ARENA *nameArena = NULL;
     if(supportNodeNames)
     {
 	names = Malloc(maxNodes*sizeof(char*));
-	nameDict = TreeAlloc((pCmpFcn)strcmp, (pFointCopyFcn)strdup, (pFointFreeFcn)free, NULL, NULL);
+	nameArena = ArenaAlloc(0, 0); // the names themselves, which are also the keys of nameDict
+	nameDict = TreeAlloc((pCmpFcn)strcmp, NULL, NULL, NULL, NULL);
     }
 
     char line[BUFSIZ];
@@ -816,15 +823,15 @@ GRAPH *GraphReadEdgeList(GRAPH *G, FILE *fp, Boolean directed, Boolean supportNo
 	    }
 	    if(!TreeLookup(nameDict, (foint)v1.name, &f1))
 	    {
-		names[numNodes] = Strdup(v1.name);
-		f1.i = numNodes++;
-		TreeInsert(nameDict, (foint)v1.name, f1);
+		names[numNodes] = ArenaStrdup(nameArena, v1.name);
+		f1.i = numNodes;
+		TreeInsert(nameDict, (foint)names[numNodes++], f1);
 	    }
 	    if(!TreeLookup(nameDict, (foint)v2.name, &f2))
 	    {
-		names[numNodes] = Strdup(v2.name);
-		f2.i = numNodes++;
-		TreeInsert(nameDict, (foint)v2.name, f2);
+		names[numNodes] = ArenaStrdup(nameArena, v2.name);
+		f2.i = numNodes;
+		TreeInsert(nameDict, (foint)names[numNodes++], f2);
 	    }
 	    v1.i = f1.i; v2.i = f2.i;
 	}
@@ -863,6 +870,7 @@ GRAPH *GraphReadEdgeList(GRAPH *G, FILE *fp, Boolean directed, Boolean supportNo
     if(supportNodeNames) {
 	G->nameDict = nameDict;
 	G->name = names;
+	G->nameArena = nameArena;
     }
     Free(pairs);
     if(weighted) Free(fweight);
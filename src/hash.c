@@ -25,11 +25,8 @@ Boolean HashGet(HASH *H, int key, foint *f){
 }
 
 Boolean HashInsert(HASH *H, int key, foint data){
-    // if it's already there, don't bump up the size
-    void *foo;
-    Boolean already_there = (HASH_OK == raw_hashmap_get(H->raw_hashmap, key, &foo));
-    assert(HASH_OK == raw_hashmap_put(H->raw_hashmap, key, data.v));
-    if(!already_there) H->size++;
+    if(HASH_OK != raw_hashmap_put(H->raw_hashmap, key, data.v)) Fatal("HashInsert: out of memory");
+    H->size = raw_hashmap_length(H->raw_hashmap); // unchanged if it was already there
     return true;
 }
 
@@ -40,10 +37,27 @@ Boolean HashDelete(HASH *H, int key) {
 }
 
 Boolean HashGetOne(HASH *H, int *keyp, Boolean del) {
-    return (HASH_OK == raw_hashmap_get_one(H->raw_hashmap, keyp, del));
+    int64_t key;
+    if(HASH_OK != raw_hashmap_get_one(H->raw_hashmap, &key, del)) return false;
+    *keyp = key;
+    if(del) H->size--;
+    return true;
+}
+
+Boolean HashNext(HASH *H, int *iter, int *keyp, foint *f){
+    int64_t key;
+    void *data;
+    if(HASH_OK != raw_hashmap_next(H->raw_hashmap, iter, &key, &data)) return false;
+    if(keyp) *keyp = key;
+    if(f) f->v = data;
+    return true;
 }
 
 int HashIterate(HASH *H, PFhash_t func){
-    return 0;
+    int iter = 0, key, status;
+    foint f;
+    while(HashNext(H, &iter, &key, &f))
+	if((status = func(key, f)) != HASH_OK) return status;
+    return HASH_OK;
 }
 
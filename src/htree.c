@@ -6,6 +6,7 @@
 #ifdef __cplusplus
 extern "C" {
 #endif
+#include <string.h>
 #include "misc.h"
 #include "htree.h" // bintree or avltree is included there (as appropriate)
 
@@ -95,9 +96,16 @@ void HTreeInsert(HTREE *h, foint keys[], foint info)
 	UnsafeHTreeInsert(h, keys, info);
 }
 
+static foint* const FlatInsert(HTREE *h, foint keys[], foint info);
+static foint* const FlatLookDel(HTREE *h, foint keys[], unsigned char targetDepth, Boolean delete);
+static int FlatSizes(HTREE *h, foint keys[], int sizes[]);
+static int FlatTraverse(foint globals, HTREE *h, pHTreeTraverseFcn f);
+static void FlatFree(HTREE *h);
+
 // keys is an array with exactly "depth" elements, data is what you want to put at the lowest level.
 foint* const UnsafeHTreeInsert(HTREE *h, foint keys[], foint data)
 {
+    if(!h->tree) return FlatInsert(h, keys, data);
     foint fkeys[h->depth]; int i; for(i=0; i < h->depth; i++) fkeys[i] = keys[i];
     return HTreeInsertHelper(h, 0, h->tree, fkeys, data);
 }
@@ -145,11 +153,12 @@ static foint* const HTreeLookDelHelper(HTREE *h, unsigned char currentDepth, TRE
 
 Boolean HTreeLookDel(HTREE *h, foint keys[], foint *pInfo)
 {
-	foint* result = UnsafeHTreeLookDel(h, keys, h->depth, (long)pInfo==1);
+	Boolean delete = (long)pInfo==1;
+	foint* result = UnsafeHTreeLookDel(h, keys, h->depth, delete);
 
 	if (result != NULL) 
 	{
-		if (pInfo) *pInfo = *result; // lookup with assign
+		if (pInfo && !delete) *pInfo = *result; // lookup with assign
 		return true;
 	}
 	else
@@ -160,6 +169,7 @@ foint* const UnsafeHTreeLookDel(HTREE *h, foint keys[], unsigned char targetDept
 {
 	assert(targetDepth <= h->depth);
 	targetDepth = targetDepth == 0 ? h->depth : targetDepth;
+    if(!h->tree) return FlatLookDel(h, keys, targetDepth, delete);
     foint fkeys[h->depth]; int i; for(i=0; i < h->depth; i++) fkeys[i] = keys[i];
     return HTreeLookDelHelper(h, 0, h->tree, fkeys, targetDepth, delete);
 }
@@ -184,6 +194,7 @@ static int HTreeSizesHelper(HTREE *h, unsigned short currentDepth, TREETYPE *tre
 
 int HTreeSizes(HTREE *h, foint keys[], int sizes[])
 {
+    if(!h->tree) return FlatSizes(h, keys, sizes);
     foint fkeys[h->depth]; int i; for(i=0; i < h->depth; i++) fkeys[i] = keys[i];
     return HTreeSizesHelper(h, 0, h->tree, fkeys, sizes);
 }
@@ -216,9 +227,334 @@ static void HTreeFreeHelper(foint globals, HTREE *h, unsigned short currentDepth
 
 void HTreeFree(HTREE *h)
 {
+    if(!h->tree) { FlatFree(h); return; }
     HTreeFreeHelper((foint)NULL, h, 0, h->tree);
 	free(h);
 }
+
+// In-order traversal of the tree of trees, keeping the keys on the way down in state->keys.  The state rides
+// along in TreeTraverse's globals, so traversals in different threads, or nested ones, don't share it.
+typedef struct { HTREE *h; pHTreeTraverseFcn f; foint globals, keys[256]; int depth, cont; } TRAVERSE_STATE;
+static int TraverseLevel(foint state, foint key, foint data)
+{
+    TRAVERSE_STATE *t = state.v;
+    int depth = t->depth;
+    t->keys[depth] = key;
+    if(depth == t->h->depth-1) t->cont = t->f(t->globals, t->keys, data);
+    else {
+	t->depth = depth+1;
+	TreeTraverse(state, (TREETYPE*)data.v, TraverseLevel);
+	t->depth = depth;
+    }
+    return t->cont != 0; // never -1: this isn't the place to delete
+}
+
+int HTreeTraverse(foint globals, HTREE *h, pHTreeTraverseFcn f)
+{
+    if(!h->tree) return FlatTraverse(globals, h, f);
+    TRAVERSE_STATE t;
+    t.h = h; t.f = f; t.globals = globals;
+    t.depth = 0; t.cont = 1;
+    TreeTraverse((foint)(void*)&t, h->tree, TraverseLevel);
+    return t.cont;
+}
+
+
+/*
+** The flat HTREE (HTreeAllocFlat).  Each table is an array of entries, kept dense so that they're
+** quick to scan and sort, plus an open-addressing index into it with linear probing.  A slot holds
+** 32 bits of the hash, so most probes that don't match are rejected without looking at the entry,
+** and the entry's index+1 (so that 0 is an empty slot).  Deleting shifts later slots back rather than
+** leaving tombstones, and moves the last entry into the hole.
+**
+** An entry is a header foint (the hash, and the number of keys, which is depth for paths and less for
+** prefixes), the keys, and the info (the count of keys below, for prefixes).
+*/
+typedef struct _hTreeTable {
+    unsigned n, maxN;	// entries in use, and room for them
+    unsigned mask;	// number of slots - 1; there are always at least n/0.75 slots
+    unsigned stride;	// foints per entry
+    uint64_t *slot;
+    foint *entry;
+} HTREE_TABLE;
+
+#define ENTRY(t,i) ((t)->entry + (size_t)(i)*(t)->stride)
+#define HASH(e) ((e)[0].ui_array[0])
+#define LEN(e) ((e)[0].ui_array[1])
+#define KEYS(e) ((e)+1)
+#define INFO(t,e) ((e)[(t)->stride-1])
+#define HOME(t,s) ((unsigned)((t)->slot[s] >> 32) & (t)->mask)
+
+static foint CopyNothing(foint f) { return f; }
+static void FreeNothing(foint f) {}
+
+static HTREE_TABLE *TableAlloc(unsigned char depth)
+{
+    HTREE_TABLE *t = Calloc(1, sizeof(HTREE_TABLE));
+    t->mask = 15;
+    t->stride = depth + 2;
+    t->slot = Calloc(t->mask+1, sizeof(uint64_t));
+    return t;
+}
+
+static void TableFree(HTREE *h, HTREE_TABLE *t, Boolean hasInfo)
+{
+    unsigned i, k;
+    for(i=0; i<t->n; i++) {
+	foint *e = ENTRY(t,i);
+	for(k=0; k<LEN(e); k++) h->freeKey(KEYS(e)[k]);
+	if(hasInfo) h->freeInfo(INFO(t,e));
+    }
+    Free(t->slot);
+    if(t->entry) Free(t->entry);
+    Free(t);
+}
+
+static uint64_t Mix(uint64_t x) // the splitmix64 finalizer
+{
+    x ^= x >> 30; x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27; x *= 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+}
+
+static uint64_t HashKey(HTREE *h, foint key)
+{
+    if(h->hashKey) return h->hashKey(key);
+    if(!h->cmpKey) return (uint64_t)(unsigned)key.i;
+    uint64_t hash = 0xcbf29ce484222325ULL; // strcmp: FNV-1a
+    const unsigned char *s;
+    for(s = (const unsigned char*)key.s; *s; s++) hash = (hash ^ *s) * 0x100000001b3ULL;
+    return hash;
+}
+
+// hash[L] is the hash of keys[0..L), for L from 1 to len
+static void PathHashes(HTREE *h, foint keys[], unsigned len, uint32_t hash[])
+{
+    uint64_t path = 0;
+    unsigned L;
+    for(L=1; L<=len; L++) {
+	path = Mix(path + HashKey(h, keys[L-1]));
+	hash[L] = (uint32_t)(path >> 32);
+    }
+}
+
+static Boolean KeysEqual(HTREE *h, foint a[], foint b[], unsigned len)
+{
+    unsigned k;
+    if(!h->cmpKey) { for(k=0; k<len; k++) if(a[k].i != b[k].i) return false; }
+    else if(h->cmpKey == (pCmpFcn)strcmp) { for(k=0; k<len; k++) if(strcmp(a[k].s, b[k].s)) return false; }
+    else for(k=0; k<len; k++) if(h->cmpKey(a[k], b[k])) return false;
+    return true;
+}
+
+// The entry with these keys, or NULL and the slot it'd go in
+static foint *TableFind(HTREE *h, HTREE_TABLE *t, foint keys[], unsigned len, uint32_t hash, unsigned *pSlot)
+{
+    unsigned s = hash & t->mask;
+    for(; t->slot[s]; s = (s+1) & t->mask) {
+	if((uint32_t)(t->slot[s] >> 32) == hash) {
+	    foint *e = ENTRY(t, (uint32_t)t->slot[s] - 1);
+	    if(LEN(e) == len && KeysEqual(h, KEYS(e), keys, len)) { *pSlot = s; return e; }
+	}
+    }
+    *pSlot = s;
+    return NULL;
+}
+
+static unsigned EmptySlot(HTREE_TABLE *t, uint32_t hash)
+{
+    unsigned s = hash & t->mask;
+    while(t->slot[s]) s = (s+1) & t->mask;
+    return s;
+}
+
+// Add an entry with copies of the keys (but not the info, which is up to the caller), at slot s if there's room
+static foint *TableAdd(HTREE *h, HTREE_TABLE *t, foint keys[], unsigned len, uint32_t hash, unsigned s)
+{
+    unsigned k;
+    foint *e;
+    if(t->n + 1 > (t->mask+1) / 4 * 3) {
+	unsigned i;
+	Free(t->slot);
+	t->mask = 2*t->mask + 1;
+	t->slot = Calloc(t->mask+1, sizeof(uint64_t));
+	for(i=0; i<t->n; i++) {
+	    uint32_t hi = HASH(ENTRY(t,i));
+	    t->slot[EmptySlot(t, hi)] = (uint64_t)hi << 32 | (i+1);
+	}
+	s = EmptySlot(t, hash);
+    }
+    if(t->n == t->maxN) {
+	t->maxN = MAX(2*t->maxN, 16);
+	t->entry = Realloc(t->entry, (size_t)t->maxN * t->stride * sizeof(foint));
+    }
+    t->slot[s] = (uint64_t)hash << 32 | (t->n + 1);
+    e = ENTRY(t, t->n++);
+    HASH(e) = hash;
+    LEN(e) = len;
+    for(k=0; k<len; k++) KEYS(e)[k] = h->copyKey(keys[k]);
+    return e;
+}
+
+static unsigned SlotOf(HTREE_TABLE *t, unsigned i)
+{
+    unsigned s = HASH(ENTRY(t,i)) & t->mask;
+    while((uint32_t)t->slot[s] != i+1) s = (s+1) & t->mask;
+    return s;
+}
+
+// Remove entry i (whose keys and info the caller has dealt with)
+static void TableRemove(HTREE_TABLE *t, unsigned i)
+{
+    unsigned s = SlotOf(t, i), j = s;
+    for(;;) { // shift back anything after s that probed past it
+	j = (j+1) & t->mask;
+	if(!t->slot[j]) break;
+	unsigned home = HOME(t,j);
+	if(j > s ? (home <= s || home > j) : (home <= s && home > j)) {
+	    t->slot[s] = t->slot[j];
+	    s = j;
+	}
+    }
+    t->slot[s] = 0;
+    if(i != --t->n) { // the last entry fills the hole
+	t->slot[SlotOf(t, t->n)] = (uint64_t)HASH(ENTRY(t, t->n)) << 32 | (i+1);
+	memcpy(ENTRY(t,i), ENTRY(t, t->n), t->stride * sizeof(foint));
+    }
+}
+
+HTREE *HTreeAllocFlat(unsigned char depth, pFointHashFcn hashKey, pCmpFcn cmpKey, pFointCopyFcn copyKey,
+    pFointFreeFcn freeKey, pFointCopyFcn copyInfo, pFointFreeFcn freeInfo)
+{
+    assert(depth>0);
+    if(!hashKey && cmpKey && cmpKey != (pCmpFcn)strcmp) Fatal("HTreeAllocFlat: your cmpKey needs a hashKey to go with it");
+    HTREE *h = Calloc(1, sizeof(HTREE));
+    h->depth = depth;
+    h->hashKey = hashKey; h->cmpKey = cmpKey;
+    h->copyKey = copyKey ? copyKey : CopyNothing; h->freeKey = freeKey ? freeKey : FreeNothing;
+    h->copyInfo = copyInfo ? copyInfo : CopyNothing; h->freeInfo = freeInfo ? freeInfo : FreeNothing;
+    h->paths = TableAlloc(depth);
+    h->prefixes = TableAlloc(depth);
+    return h;
+}
+
+static foint* const FlatInsert(HTREE *h, foint keys[], foint info)
+{
+    uint32_t hash[256];
+    unsigned s, L;
+    foint *e, *p;
+    PathHashes(h, keys, h->depth, hash);
+    if((e = TableFind(h, h->paths, keys, h->depth, hash[h->depth], &s))) {
+	h->freeInfo(INFO(h->paths, e));
+	INFO(h->paths, e) = h->copyInfo(info);
+	return &INFO(h->paths, e);
+    }
+    e = TableAdd(h, h->paths, keys, h->depth, hash[h->depth], s);
+    INFO(h->paths, e) = h->copyInfo(info);
+    h->n++;
+    for(L = h->depth-1; L > 0; L--) { // count it in its parent, which may be new and need counting in its own parent...
+	if((p = TableFind(h, h->prefixes, keys, L, hash[L], &s))) { INFO(h->prefixes, p).i++; break; }
+	p = TableAdd(h, h->prefixes, keys, L, hash[L], s);
+	INFO(h->prefixes, p).l = 0;
+	INFO(h->prefixes, p).i = 1;
+    }
+    if(L == 0) h->topN++;
+    return &INFO(h->paths, e);
+}
+
+static void Uncount(HTREE *h, foint keys[], unsigned len, uint32_t hash[])
+{
+    unsigned s;
+    if(len == 0) { h->topN--; return; }
+    foint *p = TableFind(h, h->prefixes, keys, len, hash[len], &s);
+    assert(p && INFO(h->prefixes, p).i > 0);
+    INFO(h->prefixes, p).i--; // like an empty sub-tree, it stays until it's deleted
+}
+
+static foint* const FlatLookDel(HTREE *h, foint keys[], unsigned char targetDepth, Boolean delete)
+{
+    uint32_t hash[256];
+    unsigned s, i, k;
+    foint *e;
+    PathHashes(h, keys, targetDepth, hash);
+    if(targetDepth == h->depth) {
+	if(!(e = TableFind(h, h->paths, keys, targetDepth, hash[targetDepth], &s))) return NULL;
+	if(!delete) return &INFO(h->paths, e);
+	for(k=0; k<h->depth; k++) h->freeKey(KEYS(e)[k]);
+	h->freeInfo(INFO(h->paths, e));
+	TableRemove(h->paths, (e - h->paths->entry) / h->paths->stride);
+	h->n--;
+	Uncount(h, keys, targetDepth-1, hash);
+	return (foint*)1;
+    }
+    if(!(e = TableFind(h, h->prefixes, keys, targetDepth, hash[targetDepth], &s))) return NULL;
+    if(!delete) return &INFO(h->prefixes, e);
+    // Delete everything under the prefix, going backwards so what moves into each hole has already been looked at
+    for(i = h->paths->n; i-- > 0; ) {
+	e = ENTRY(h->paths, i);
+	if(KeysEqual(h, KEYS(e), keys, targetDepth)) {
+	    for(k=0; k<h->depth; k++) h->freeKey(KEYS(e)[k]);
+	    h->freeInfo(INFO(h->paths, e));
+	    TableRemove(h->paths, i);
+	    h->n--;
+	}
+    }
+    for(i = h->prefixes->n; i-- > 0; ) {
+	e = ENTRY(h->prefixes, i);
+	if(LEN(e) >= targetDepth && KeysEqual(h, KEYS(e), keys, targetDepth)) {
+	    for(k=0; k<LEN(e); k++) h->freeKey(KEYS(e)[k]);
+	    TableRemove(h->prefixes, i);
+	}
+    }
+    Uncount(h, keys, targetDepth-1, hash);
+    return (foint*)1;
+}
+
+static int FlatSizes(HTREE *h, foint keys[], int sizes[])
+{
+    uint32_t hash[256];
+    unsigned s, L;
+    sizes[0] = h->topN;
+    PathHashes(h, keys, h->depth-1, hash);
+    for(L=1; L < h->depth; L++) {
+	foint *p = TableFind(h, h->prefixes, keys, L, hash[L], &s);
+	if(!p) return L;
+	sizes[L] = INFO(h->prefixes, p).i;
+    }
+    return h->depth;
+}
+
+static __thread HTREE *_sortH;
+static int CmpPaths(const void *a, const void *b)
+{
+    foint *x = KEYS(*(foint* const*)a), *y = KEYS(*(foint* const*)b);
+    unsigned k;
+    for(k=0; k<_sortH->depth; k++) {
+	int c = !_sortH->cmpKey ? (x[k].i > y[k].i) - (x[k].i < y[k].i) : _sortH->cmpKey(x[k], y[k]);
+	if(c) return c;
+    }
+    return 0;
+}
+
+static int FlatTraverse(foint globals, HTREE *h, pHTreeTraverseFcn f)
+{
+    foint **order = Malloc(MAX(h->paths->n, 1) * sizeof(foint*));
+    unsigned i;
+    int cont = 1;
+    for(i=0; i<h->paths->n; i++) order[i] = ENTRY(h->paths, i);
+    _sortH = h;
+    qsort(order, h->paths->n, sizeof(foint*), CmpPaths);
+    for(i=0; i<h->paths->n && cont; i++) cont = f(globals, KEYS(order[i]), INFO(h->paths, order[i]));
+    Free(order);
+    return cont;
+}
+
+static void FlatFree(HTREE *h)
+{
+    TableFree(h, h->paths, true);
+    TableFree(h, h->prefixes, false);
+    Free(h);
+}
 #ifdef __cplusplus
 } // end extern "C"
 #endif
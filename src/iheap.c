@@ -0,0 +1,181 @@
+// This software is part of github.com/waynebhayes/libwayne, and is Copyright(C) Wayne B. Hayes 2025, under the GNU LGPL 3.0
+// (GNU Lesser General Public License, version 3, 2007), a copy of which is contained at the top of the repo.
+#ifdef __cplusplus
+extern "C" {
+#endif
+#include <string.h>
+#include "iheap.h"
+
+#define D 4 // arity; the children of heap[i] are heap[D*i+1 .. D*i+D]
+#define PARENT(i) (((i)-1)/D)
+#define CACHE_LINE 64
+
+// map doubles to integers with the same order (see RadixSortDouble)
+static inline uint64_t DoubleToKey(double x)
+{
+    uint64_t k;
+    memcpy(&k, &x, sizeof(k));
+    return k ^ ((k >> 63) ? ~(uint64_t)0 : (uint64_t)1 << 63);
+}
+
+static inline double KeyToDouble(uint64_t k)
+{
+    double x;
+    k ^= (k >> 63) ? (uint64_t)1 << 63 : ~(uint64_t)0;
+    memcpy(&x, &k, sizeof(x));
+    return x;
+}
+
+IHEAP *IHeapAlloc(int maxItems)
+{
+    IHEAP *h = Calloc(1, sizeof(IHEAP));
+    int i;
+    assert(maxItems >= 0);
+    h->maxItems = maxItems;
+    // put heap[1], the first group of siblings, at the start of a cache line; then every group of D is in one
+    h->space = Malloc((maxItems + 1) * sizeof(IHEAP_ENTRY) + CACHE_LINE);
+    uintptr_t first = ((uintptr_t)h->space + sizeof(IHEAP_ENTRY) + CACHE_LINE-1) & ~(uintptr_t)(CACHE_LINE-1);
+    h->heap = (IHEAP_ENTRY*)first - 1;
+    h->pos = Malloc(maxItems * sizeof(int));
+    for(i=0; i<maxItems; i++) h->pos[i] = -1;
+    return h;
+}
+
+void IHeapFree(IHEAP *h)
+{
+    Free(h->pos);
+    Free(h->space);
+    Free(h);
+}
+
+void IHeapReset(IHEAP *h)
+{
+    int i;
+    for(i=0; i<h->n; i++) h->pos[h->heap[i].item] = -1;
+    h->n = 0;
+}
+
+int IHeapSize(IHEAP *h) { return h->n; }
+
+Boolean IHeapContains(IHEAP *h, int item)
+{
+    assert(0 <= item && item < h->maxItems);
+    return h->pos[item] >= 0;
+}
+
+// Move e up from position i to where it belongs, shifting parents down into the hole.
+static void SiftUp(IHEAP *h, int i, IHEAP_ENTRY e)
+{
+    while(i > 0) {
+	int p = PARENT(i);
+	if(h->heap[p].key <= e.key) break;
+	h->heap[i] = h->heap[p];
+	h->pos[h->heap[i].item] = i;
+	i = p;
+    }
+    h->heap[i] = e;
+    h->pos[e.item] = i;
+}
+
+// Move e down from position i to where it belongs, shifting the smallest child up into the hole each time.
+static void SiftDown(IHEAP *h, int i, IHEAP_ENTRY e)
+{
+    const int n = h->n;
+    int c;
+    while((c = D*i+1) < n) {
+	int best = c, last = MIN(c+D, n);
+	for(++c; c < last; c++) if(h->heap[c].key < h->heap[best].key) best = c;
+	if(e.key <= h->heap[best].key) break;
+	h->heap[i] = h->heap[best];
+	h->pos[h->heap[i].item] = i;
+	i = best;
+    }
+    h->heap[i] = e;
+    h->pos[e.item] = i;
+}
+
+void IHeapInsertU64(IHEAP *h, int item, uint64_t key)
+{
+    IHEAP_ENTRY e = {key, item};
+    assert(0 <= item && item < h->maxItems);
+    if(h->pos[item] >= 0) Fatal("IHeapInsert: item %d is already in the heap", item);
+    SiftUp(h, h->n++, e);
+}
+
+void IHeapChangeKeyU64(IHEAP *h, int item, uint64_t key)
+{
+    assert(0 <= item && item < h->maxItems);
+    int i = h->pos[item];
+    if(i < 0) Fatal("IHeapChangeKey: item %d is not in the heap", item);
+    IHEAP_ENTRY e = {key, item};
+    if(key < h->heap[i].key) SiftUp(h, i, e);
+    else SiftDown(h, i, e);
+}
+
+uint64_t IHeapKeyU64(IHEAP *h, int item)
+{
+    assert(0 <= item && item < h->maxItems && h->pos[item] >= 0);
+    return h->heap[h->pos[item]].key;
+}
+
+uint64_t IHeapPeekKeyU64(IHEAP *h)
+{
+    assert(h->n > 0);
+    return h->heap[0].key;
+}
+
+void IHeapDelete(IHEAP *h, int item)
+{
+    assert(0 <= item && item < h->maxItems);
+    int i = h->pos[item];
+    if(i < 0) Fatal("IHeapDelete: item %d is not in the heap", item);
+    h->pos[item] = -1;
+    IHEAP_ENTRY last = h->heap[--h->n];
+    if(i == h->n) return;
+    // the last entry fills the hole; it may belong above or below it
+    if(i > 0 && last.key < h->heap[PARENT(i)].key) SiftUp(h, i, last);
+    else SiftDown(h, i, last);
+}
+
+int IHeapPeek(IHEAP *h)
+{
+    assert(h->n > 0);
+    return h->heap[0].item;
+}
+
+int IHeapNext(IHEAP *h)
+{
+    assert(h->n > 0);
+    int item = h->heap[0].item;
+    h->pos[item] = -1;
+    IHEAP_ENTRY last = h->heap[--h->n];
+    if(h->n > 0) SiftDown(h, 0, last);
+    return item;
+}
+
+void IHeapInsert(IHEAP *h, int item, double key) { IHeapInsertU64(h, item, DoubleToKey(key)); }
+void IHeapChangeKey(IHEAP *h, int item, double key) { IHeapChangeKeyU64(h, item, DoubleToKey(key)); }
+double IHeapKey(IHEAP *h, int item) { return KeyToDouble(IHeapKeyU64(h, item)); }
+double IHeapPeekKey(IHEAP *h) { return KeyToDouble(IHeapPeekKeyU64(h)); }
+
+void IHeapInsertOrChange(IHEAP *h, int item, double key)
+{
+    if(IHeapContains(h, item)) IHeapChangeKey(h, item, key);
+    else IHeapInsert(h, item, key);
+}
+
+int IHeapSanityCheck(IHEAP *h)
+{
+    int i, numIn = 0;
+    assert(((uintptr_t)&h->heap[1] & (CACHE_LINE-1)) == 0);
+    for(i=0; i<h->n; i++) {
+	assert(h->pos[h->heap[i].item] == i);
+	if(i > 0) assert(h->heap[PARENT(i)].key <= h->heap[i].key);
+    }
+    for(i=0; i<h->maxItems; i++) numIn += (h->pos[i] >= 0);
+    assert(numIn == h->n);
+    return 1;
+}
+#ifdef __cplusplus
+} // end extern "C"
+#endif
@@ -6,6 +6,7 @@ extern "C" {
 #include <math.h>
 #include <assert.h>
 #include <malloc.h>
+#include <pthread.h>
 #include "misc.h"
 #include "ldbsode.h"
 #include "matvec.h"
@@ -44,17 +45,30 @@ LDBSODE *LDBsodeAlloc(int n, long double t, long double *y, LD_EVAL f, int stiff
     return b;
 }
 
+/*
+** The Numerical Recipes ld_odeint and its stepper keep state in statics, so only one thread at a time
+** may be inside them, and an integration can't be started from inside another one's F.
+*/
+static pthread_mutex_t _odeintLock = PTHREAD_MUTEX_INITIALIZER;
+static __thread int _inOdeint;
+
 /* Do the actual integration.  Return the actual TOUT */
 long double LDBsodeIntegrate(LDBSODE *b, long double TOUT)
 {
     int direction = TOUT - b->T > 0 ? 1 : -1;
     int nok, nbad;
 
+    if(_inOdeint) Fatal("LDBsodeIntegrate: can't be called from inside a derivative function ld_odeint is integrating");
+
     while(direction*(b->T - TOUT) < 0)
     {
 	int status;
+	pthread_mutex_lock(&_odeintLock);
+	_inOdeint = 1;
 	status = ld_odeint(b->Y, b->N, &b->T, TOUT, b->EPS, b->H0, b->HMIN,
 	    &nok, &nbad, b->F, ld_bsstep);
+	_inOdeint = 0;
+	pthread_mutex_unlock(&_odeintLock);
 
 	switch(status)
 	{
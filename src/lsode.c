@@ -10,9 +10,16 @@ extern "C" {
 #include <math.h>
 #include <assert.h>
 #include <malloc.h>
+#include <pthread.h>
 #include "misc.h"
 #include "lsode.h"
 
+#ifndef LSODE_HAVE_SRCOM
+#define LSODE_HAVE_SRCOM 1 // 0 if your LSODE library lacks SRCOM; switching objects then restarts the integration
+#endif
+#define LSODE_LENRLS 240 // SRCOM saves 218 or 219 reals and 37 to 41 ints depending on LSODE version, so be generous
+#define LSODE_LENILS 48
+
 /*
 ** n = number of equations
 ** stiff_flag: 0 = no, 1 = yes.
@@ -43,6 +50,8 @@ LSODE *LsodeAlloc(int n, double time, double *y, F_EVAL f, int stiff_flag, doubl
 
     l->IWORK = Malloc(l->LIW * sizeof(int));
     l->RWORK = Malloc(l->LRW * sizeof(double));
+    l->RSAV = Calloc(LSODE_LENRLS, sizeof(double));
+    l->ISAV = Calloc(LSODE_LENILS, sizeof(int));
 
     l->ITOL = 1;
     l->RTOL = eps;
@@ -63,12 +72,30 @@ LSODE *LsodeAlloc(int n, double time, double *y, F_EVAL f, int stiff_flag, doubl
  */
 
 
-static F_EVAL F;
-static LSODE *L; /* if it changes, need to restart */
+static __thread LSODE *_myL; /* the object this thread is integrating, for FORT_F */
+static LSODE *_commonOwner; /* whose state is in LSODE's COMMON blocks; protected by _commonLock */
+static pthread_mutex_t _commonLock = PTHREAD_MUTEX_INITIALIZER;
 
 static void FORT_F(int *NN, double *TT, double *YY, double *YP)
 {
-  (*F)(*NN, *TT, YY, YP);
+  (*_myL->F)(*NN, *TT, YY, YP);
+}
+
+/* Make LSODE's COMMON blocks hold l's state. Call with _commonLock held. */
+static void TakeCommon(LSODE *l)
+{
+    if(_commonOwner == l) return;
+#if LSODE_HAVE_SRCOM
+    extern void srcom_(double *RSAV, int *ISAV, int *JOB);
+    int save = 1, restore = 2;
+    if(_commonOwner) { srcom_(_commonOwner->RSAV, _commonOwner->ISAV, &save); _commonOwner->saved = 1; }
+    if(l->saved) srcom_(l->RSAV, l->ISAV, &restore);
+    else l->ISTATE = 1;
+#else
+    if(_commonOwner) _commonOwner->ISTATE = 1; /* its state is about to be lost */
+    l->ISTATE = 1;	/* need to re-initialize with current data */
+#endif
+    _commonOwner = l;
 }
 
 
@@ -81,12 +108,10 @@ double LsodeIntegrate(LSODE *l, double TOUT) /* returns actual tout */
     int direction = TOUT - l->T > 0 ? 1 : -1;
     double fRTOL = l->RTOL, fATOL = l->ATOL;
 
-    if(l->F != F || l != L)	/* we're changing systems */
-    {
-	L = l;
-	F = l->F;
-	l->ISTATE = 1;	/* need to re-initialize with current data */
-    }
+    if(_myL) Fatal("LsodeIntegrate: can't be called from inside an LSODE derivative function");
+    pthread_mutex_lock(&_commonLock);
+    TakeCommon(l);
+    _myL = l;
 
     while(direction*(l->T - TOUT) < 0)
     {
@@ -102,7 +127,7 @@ double LsodeIntegrate(LSODE *l, double TOUT) /* returns actual tout */
 	    break;
 	case -1:          /* too many steps */
 	    Warning("Warning: LSODE: too many steps");
-	    return l->T;
+	    goto done;
 	    l->ISTATE = 2; /* Just continue */
 	    break;
 	case -2:          /* EPS too small */
@@ -121,7 +146,7 @@ double LsodeIntegrate(LSODE *l, double TOUT) /* returns actual tout */
 	    if(l->T == TOUT)
 		l->ISTATE = 2;
 	    else
-		return l->T;
+		goto done;
 #else
 	    l->ISTATE = 2; /* Just continue */
 #endif
@@ -133,7 +158,7 @@ double LsodeIntegrate(LSODE *l, double TOUT) /* returns actual tout */
 	    if(l->T == TOUT)
 		l->ISTATE = 2;
 	    else
-		return l->T;
+		goto done;
 #else
 	    l->ISTATE = 2; /* Just continue */
 #endif
@@ -147,12 +172,20 @@ double LsodeIntegrate(LSODE *l, double TOUT) /* returns actual tout */
 	    break;
 	}
     }
+done:
+    _myL = NULL;
+    pthread_mutex_unlock(&_commonLock);
     return l->T;
 }
 
 
 void LsodeFree(LSODE *l)
 {
+    pthread_mutex_lock(&_commonLock);
+    if(_commonOwner == l) _commonOwner = NULL;
+    pthread_mutex_unlock(&_commonLock);
+    free(l->RSAV);
+    free(l->ISAV);
     free(l->IWORK);
     free(l->RWORK);
     free(l);
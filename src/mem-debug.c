@@ -10,9 +10,15 @@ extern "C" {
 #include <stdio.h>
 #include <stdlib.h>
 #include <assert.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <pthread.h>
 
 #include "misc.h"
 #include "mem-debug.h"
+#include "mem-prof.h"
 
 
 void Fatal_fl( const char *message, const char *file, const int line )
@@ -97,6 +103,8 @@ void *Malloc_fl( const size_t size, const char *file, const int line )
     memoryBlock = malloc( totalSize );
     if( memoryBlock == NULL )
 	Fatal_fl( "out of memory", file, line );
+    if( _memProfEnabled )
+	MemProfAlloc( memoryBlock, size, file, line );
 
     if( memoryTrackingEnabled )
     {
@@ -191,8 +199,14 @@ void *Realloc_fl( void *memoryBlock, const size_t newSize, const char *file, con
 	    assert( memoryTotalUsage >= 0 );
 
 	/* call true realloc here and check if it has moved or not */
-	size_t totalSize = sizeof(MEMORY_BLOCK_HEADER) + newSize;
-	memoryBlockHeader = realloc( memoryBlockHeader, totalSize ); // this way we cannot touch old one of it moved
+	    size_t totalSize = sizeof(MEMORY_BLOCK_HEADER) + newSize;
+	    if( _memProfEnabled )
+		MemProfFree( memoryBlockHeader );
+	    memoryBlockHeader = realloc( memoryBlockHeader, totalSize ); // this way we cannot touch old one of it moved
+	    if( memoryBlockHeader == NULL )
+		Fatal_fl( "out of memory", file, line );
+	    if( _memProfEnabled )
+		MemProfAlloc( memoryBlockHeader, newSize, file, line );
 
 	    align = (int*)memoryBlockHeader->align;
 	    align[0] = 0xDEAD;
@@ -214,7 +228,16 @@ void *Realloc_fl( void *memoryBlock, const size_t newSize, const char *file, con
 	return memoryBlock = (void *)( (unsigned char *)memoryBlockHeader + sizeof(MEMORY_BLOCK_HEADER) );
     }
     else
-	return realloc(memoryBlock, newSize);
+    {
+	if( _memProfEnabled && memoryBlock != NULL )
+	    MemProfFree( memoryBlock );
+	memoryBlock = realloc(memoryBlock, newSize);
+	if( memoryBlock == NULL && newSize > 0 )
+	    Fatal_fl( "out of memory", file, line );
+	if( _memProfEnabled )
+	    MemProfAlloc( memoryBlock, newSize, file, line );
+	return memoryBlock;
+    }
 }
 
 #if 0
@@ -313,10 +336,16 @@ void Free_fl( void *memoryBlock, const char *file, const int line )
 	memoryTotalUsage -= memoryBlockHeader->size;
 	assert( memoryTotalUsage >= 0 );
 
+	if( _memProfEnabled )
+	    MemProfFree( memoryBlockHeader );
 	free( memoryBlockHeader );
     }
     else
+    {
+	if( _memProfEnabled )
+	    MemProfFree( memoryBlock );
 	free( memoryBlock );
+    }
 }
 
 void MemoryAllocationReport( const char *file, const int line )
@@ -394,6 +423,276 @@ void EnableMemDebug( const char *file, const int line )
 	Fatal_fl( "could not initialize memory tracking and leak detection",
 	    file, line);
 }
+
+
+/*
+** The sampling allocation profiler: see mem-prof.h.  Nothing here may call Malloc and friends, or it'd
+** profile itself; what little memory the report needs comes straight from malloc.
+*/
+#if defined(__GLIBC__)
+extern size_t malloc_usable_size(void *); /* <malloc.h> would find ours in include/ */
+#define BLOCK_SIZE(p) malloc_usable_size(p)
+#elif defined(__APPLE__)
+#include <malloc/malloc.h>
+#define BLOCK_SIZE(p) malloc_size(p)
+#else
+#define BLOCK_SIZE(p) 0 /* no way to tell, so live bytes aren't tracked */
+#endif
+
+#define PROF_SITES 4096	/* call sites in the hash table; a power of 2 */
+#define PROF_HIST 40	/* histogram bucket b counts sizes in [2^(b-1), 2^b) */
+#define PROF_FLUSH (256*1024)	/* live bytes a thread can change before telling everyone */
+#define PROF_FLUSH_COUNT 4096	/* ... or allocations and frees */
+#define PROF_TIMELINE 1024	/* points; when it's full, every other one goes and the interval doubles */
+#define PROF_TOP_SITES 30	/* in the report */
+#define RELAXED __ATOMIC_RELAXED
+
+typedef struct {
+    uint64_t key;	/* 0 if the slot is free, else (file << 16 | line), or (return address << 16) */
+    uint64_t calls, bytes;	/* estimated from the samples */
+    uint64_t hist[PROF_HIST];	/* of the sampled sizes */
+} PROF_SITE;
+
+typedef struct {
+    int64_t live;	/* the thread's counts since its last flush */
+    uint64_t allocs, frees, bytes;
+    int64_t untilSample;
+    uint64_t rng;
+    Boolean atExit;	/* registered to flush when the thread exits */
+} PROF_THREAD;
+
+static unsigned _profPeriod = 1;
+static char *_profReportFile;
+static PROF_SITE _profSite[PROF_SITES];
+static uint64_t _profLostSamples; /* the table was full */
+static uint64_t _profAllocs, _profFrees, _profBytes;
+static int64_t _profLive, _profPeak;
+static __thread PROF_THREAD _profThread;
+static volatile sig_atomic_t _profReportRequested;
+
+static struct { double t; int64_t live; long rssKB; } _profTimeline[PROF_TIMELINE];
+static int _profTimelineN, _profTimelineBusy;
+static double _profStart, _profInterval = 0.01, _profLastTick;
+
+static double ProfNow(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + 1e-9*ts.tv_nsec;
+}
+
+static long ProfRssKB(void)
+{
+    long pages = 0;
+    FILE *fp = fopen("/proc/self/statm", "r");
+    if(fp) {
+	if(fscanf(fp, "%*s %ld", &pages) != 1) pages = 0;
+	fclose(fp);
+    }
+    return pages * (sysconf(_SC_PAGESIZE) / 1024);
+}
+
+static void ProfFlush(PROF_THREAD *t)
+{
+    __atomic_add_fetch(&_profAllocs, t->allocs, RELAXED);
+    __atomic_add_fetch(&_profFrees, t->frees, RELAXED);
+    __atomic_add_fetch(&_profBytes, t->bytes, RELAXED);
+    int64_t live = __atomic_add_fetch(&_profLive, t->live, RELAXED), peak = __atomic_load_n(&_profPeak, RELAXED);
+    while(live > peak && !__atomic_compare_exchange_n(&_profPeak, &peak, live, true, RELAXED, RELAXED))
+	;
+    t->live = 0;
+    t->allocs = t->frees = t->bytes = 0;
+}
+
+/* Allocations to skip before the next sample: 1 if period is 1, else geometric with mean period. */
+static int64_t ProfNextSample(PROF_THREAD *t)
+{
+    if(_profPeriod == 1) return 1;
+    if(!t->rng) t->rng = (uintptr_t)t ^ (uint64_t)(ProfNow()*1e9) ^ 0x9E3779B97F4A7C15ULL;
+    t->rng ^= t->rng << 13; t->rng ^= t->rng >> 7; t->rng ^= t->rng << 17;
+    double u = ((t->rng >> 11) + 0.5) / 9007199254740992.0; /* in (0,1) */
+    return 1 + (int64_t)(-log(u) * _profPeriod);
+}
+
+static pthread_key_t _profKey;
+static pthread_once_t _profKeyOnce = PTHREAD_ONCE_INIT;
+static void ProfThreadExit(void *t) { ProfFlush((PROF_THREAD*)t); }
+static void ProfMakeKey(void) { pthread_key_create(&_profKey, ProfThreadExit); }
+
+static PROF_SITE *ProfSite(const char *file, uintptr_t line)
+{
+    uint64_t key = file ? ((uint64_t)(uintptr_t)file << 16 | MIN(line, 0xffff)) : (uint64_t)line << 16;
+    unsigned h = (unsigned)((key * 0x9E3779B97F4A7C15ULL) >> 40), i;
+    for(i=0; i<PROF_SITES; i++) {
+	PROF_SITE *s = &_profSite[(h+i) & (PROF_SITES-1)];
+	uint64_t k = __atomic_load_n(&s->key, RELAXED);
+	if(k == 0 && __atomic_compare_exchange_n(&s->key, &k, key, false, RELAXED, RELAXED)) return s;
+	if(k == key) return s; // including when another thread just claimed it for the same site
+    }
+    return NULL;
+}
+
+static void ProfTick(void)
+{
+    double now = ProfNow();
+    if(now - _profLastTick < _profInterval || __atomic_test_and_set(&_profTimelineBusy, __ATOMIC_ACQUIRE)) return;
+    if(_profTimelineN == PROF_TIMELINE) {
+	int i;
+	for(i=0; i<PROF_TIMELINE/2; i++) _profTimeline[i] = _profTimeline[2*i+1];
+	_profTimelineN = PROF_TIMELINE/2;
+	_profInterval *= 2;
+    }
+    _profTimeline[_profTimelineN].t = now - _profStart;
+    _profTimeline[_profTimelineN].live = __atomic_load_n(&_profLive, RELAXED);
+    _profTimeline[_profTimelineN].rssKB = ProfRssKB();
+    ++_profTimelineN;
+    _profLastTick = now;
+    __atomic_clear(&_profTimelineBusy, __ATOMIC_RELEASE);
+}
+
+static void ProfReportToFile(void)
+{
+    FILE *fp = _profReportFile ? fopen(_profReportFile, "w") : stderr;
+    if(!fp) { perror(_profReportFile); return; }
+    MemProfReport(fp);
+    if(fp != stderr) fclose(fp);
+}
+
+static void ProfSample(PROF_THREAD *t, size_t size, const char *file, uintptr_t line)
+{
+    PROF_SITE *s = ProfSite(file, line);
+    int b = 0;
+    ProfFlush(t);
+    if(!t->atExit) { // every thread's first allocation is sampled, so this catches them all
+	t->atExit = true;
+	pthread_once(&_profKeyOnce, ProfMakeKey);
+	pthread_setspecific(_profKey, t);
+    }
+    while(b < PROF_HIST-1 && ((size_t)1 << b) <= size) ++b;
+    if(s) {
+	__atomic_add_fetch(&s->calls, _profPeriod, RELAXED);
+	__atomic_add_fetch(&s->bytes, (uint64_t)size * _profPeriod, RELAXED);
+	__atomic_add_fetch(&s->hist[b], 1, RELAXED);
+    }
+    else __atomic_add_fetch(&_profLostSamples, 1, RELAXED);
+    ProfTick();
+    if(_profReportRequested) {
+	_profReportRequested = 0;
+	ProfReportToFile();
+    }
+    t->untilSample = ProfNextSample(t);
+}
+
+void MemProfAlloc(void *block, size_t size, const char *file, uintptr_t line)
+{
+    PROF_THREAD *t = &_profThread;
+    if(block) t->live += BLOCK_SIZE(block);
+    t->bytes += size;
+    ++t->allocs;
+    if(--t->untilSample <= 0) ProfSample(t, size, file, line);
+    else if(t->allocs + t->frees >= PROF_FLUSH_COUNT || t->live >= PROF_FLUSH || t->live <= -PROF_FLUSH) ProfFlush(t);
+}
+
+void MemProfFree(void *block)
+{
+    PROF_THREAD *t = &_profThread;
+    if(!block) return;
+    t->live -= BLOCK_SIZE(block);
+    ++t->frees;
+    if(t->allocs + t->frees >= PROF_FLUSH_COUNT || t->live >= PROF_FLUSH || t->live <= -PROF_FLUSH) ProfFlush(t);
+}
+
+void MemProfTotals(uint64_t *allocs, uint64_t *frees, uint64_t *bytesAllocated, int64_t *liveBytes, int64_t *peakLiveBytes)
+{
+    ProfFlush(&_profThread);
+    if(allocs) *allocs = __atomic_load_n(&_profAllocs, RELAXED);
+    if(frees) *frees = __atomic_load_n(&_profFrees, RELAXED);
+    if(bytesAllocated) *bytesAllocated = __atomic_load_n(&_profBytes, RELAXED);
+    if(liveBytes) *liveBytes = __atomic_load_n(&_profLive, RELAXED);
+    if(peakLiveBytes) *peakLiveBytes = __atomic_load_n(&_profPeak, RELAXED);
+}
+
+static int CmpSiteBytes(const void *a, const void *b)
+{
+    uint64_t x = (*(PROF_SITE*const*)a)->bytes, y = (*(PROF_SITE*const*)b)->bytes;
+    return (x < y) - (x > y); // biggest first
+}
+
+void MemProfReport(FILE *fp)
+{
+    uint64_t allocs, frees, bytes;
+    int64_t live, peak;
+    PROF_SITE **site = malloc(PROF_SITES * sizeof(PROF_SITE*));
+    struct rusage ru;
+    int i, b, n = 0;
+
+    MemProfTotals(&allocs, &frees, &bytes, &live, &peak);
+    getrusage(RUSAGE_SELF, &ru);
+    fprintf(fp, "Memory profile after %.3f s, sampling 1 in %u allocations:\n", ProfNow() - _profStart, _profPeriod);
+    fprintf(fp, "  %llu allocations, %llu frees, %llu bytes allocated; %lld bytes live, peak %lld; peak RSS %ld kB\n",
+	(unsigned long long)allocs, (unsigned long long)frees, (unsigned long long)bytes,
+	(long long)live, (long long)peak, (long)ru.ru_maxrss);
+
+    for(i=0; i<PROF_SITES; i++) if(_profSite[i].key) site[n++] = &_profSite[i];
+    qsort(site, n, sizeof(site[0]), CmpSiteBytes);
+    fprintf(fp, "  %d call sites%s; the top %d by bytes (estimated), with sizes sampled (log2 bucket: count):\n",
+	n, _profLostSamples ? " (the table overflowed)" : "", MIN(n, PROF_TOP_SITES));
+    for(i=0; i<n && i<PROF_TOP_SITES; i++) {
+	uint64_t key = site[i]->key;
+	char where[BUFSIZ];
+	if(key & 0xffff) snprintf(where, sizeof(where), "%s:%d", (const char*)(uintptr_t)(key >> 16), (int)(key & 0xffff));
+	else snprintf(where, sizeof(where), "%p", (void*)(uintptr_t)(key >> 16));
+	fprintf(fp, "  %14llu bytes %10llu calls  %-28s", (unsigned long long)site[i]->bytes,
+	    (unsigned long long)site[i]->calls, where);
+	for(b=0; b<PROF_HIST; b++) if(site[i]->hist[b]) fprintf(fp, " %d:%llu", b, (unsigned long long)site[i]->hist[b]);
+	fputc('\n', fp);
+    }
+    free(site);
+
+    if(_profTimelineN) {
+	int step = MAX(1, _profTimelineN / 20);
+	fprintf(fp, "  timeline (seconds, live bytes, RSS kB):\n");
+	for(i=0; i<_profTimelineN; i += step)
+	    fprintf(fp, "  %10.3f %14lld %10ld\n", _profTimeline[i].t, (long long)_profTimeline[i].live, _profTimeline[i].rssKB);
+    }
+    fflush(fp);
+}
+
+static void ProfSignal(int sig) { _profReportRequested = 1; }
+
+static void ProfAtExit(void)
+{
+    if(_memProfEnabled) ProfReportToFile();
+}
+
+void MemProfEnable(unsigned period, const char *reportFile)
+{
+    static int registered;
+    _profPeriod = MAX(period, 1);
+    if(_profReportFile) free(_profReportFile);
+    _profReportFile = reportFile ? strdup(reportFile) : NULL;
+    if(!registered) {
+	registered = 1;
+	_profStart = ProfNow();
+	atexit(ProfAtExit);
+	signal(SIGUSR1, ProfSignal);
+    }
+    _profThread.untilSample = 0; /* so the new period takes effect now, at least in this thread */
+    _memProfAlloc = MemProfAlloc; /* before the switch, and never unset, so misc.c can't call NULL */
+    _memProfFree = MemProfFree;
+    __atomic_store_n(&_memProfEnabled, 1, __ATOMIC_RELEASE);
+}
+
+void MemProfDisable(void) { _memProfEnabled = 0; }
+
+__attribute__((constructor)) static void MemProfFromEnvironment(void)
+{
+    const char *env = getenv("LIBWAYNE_MEMPROF");
+    if(env && *env) {
+	const char *colon = strchr(env, ':');
+	MemProfEnable((unsigned)atoi(env), colon ? colon+1 : NULL);
+    }
+}
 #ifdef __cplusplus
 } // end extern "C"
 #endif
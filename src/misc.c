@@ -26,9 +26,17 @@ extern "C" {
 /*#include <../ucbinclude/sys/rusage.h>*/
 
 #include "misc.h"
+#include "mem-prof.h"
 
 const foint ABSTRACT_ERROR = {0xDEADBEEF};
 
+/* The sampling profiler's switch and hooks (see mem-prof.h).  They live here, and MemProfEnable fills in the
+** hooks, so that programs that never profile don't drag in mem-debug.o, its constructor and pthreads.
+*/
+int _memProfEnabled;
+void (*_memProfAlloc)(void *block, size_t size, const char *file, uintptr_t line);
+void (*_memProfFree)(void *block);
+
 static FILE *tty;
 
 // The following must be a macro since we use va_args.
@@ -90,6 +98,7 @@ void *Malloc(size_t n)
     p = (void*)malloc(n);
     if(!p && n)
 	Fatal("malloc failed");
+    if(_memProfEnabled) _memProfAlloc(p, n, NULL, (uintptr_t)__builtin_return_address(0));
     return p;
 }
 void *Calloc(size_t n, size_t m)
@@ -99,6 +108,7 @@ void *Calloc(size_t n, size_t m)
     p = (void*)calloc(n, m);
     if(!p && n && m)
 	Fatal("calloc failed");
+    if(_memProfEnabled) _memProfAlloc(p, n*m, NULL, (uintptr_t)__builtin_return_address(0));
     return p;
 }
 
@@ -106,13 +116,21 @@ void *Realloc(void *ptr, size_t newSize)
 {
     void *p;
     assert(newSize>=0);
+    if(_memProfEnabled && ptr) _memProfFree(ptr);
     p = (void*) realloc(ptr, newSize);
     if(!p)
 	Fatal("realloc failed");
+    if(_memProfEnabled) _memProfAlloc(p, newSize, NULL, (uintptr_t)__builtin_return_address(0));
     return p;
 }
 
-void Free(void *ptr) { if(ptr) free(ptr);}
+void Free(void *ptr)
+{
+    if(ptr) {
+	if(_memProfEnabled) _memProfFree(ptr);
+	free(ptr);
+    }
+}
 
 void *Memdup(void *v, size_t n)
 {
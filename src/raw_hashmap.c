@@ -14,322 +14,241 @@ extern "C" {
 
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 
-#define INITIAL_SIZE 1024
+#define INITIAL_SIZE 16 /* always a power of 2 */
+#define MAX_DIST 255    /* probe distances are kept in a byte; a table that needs more grows */
 
-// We need to keep keys and values
-typedef struct _raw_hashmap_element{
-    any_t data;
-    int key;
-    char in_use;
-} raw_hashmap_element;
-
-// A hashmap has some maximum size and current size,
-// as well as the data to hold.
+/*
+ * Robin Hood hashing: linear probing, but an element being inserted takes the slot
+ * of any element that's closer to its own home slot, so probe lengths stay short
+ * and even.  Each slot has a byte saying how far it is from its home (0 means
+ * empty); these are stored apart from the keys and data, so a probe mostly reads
+ * one or two cache lines of them, and a lookup can stop as soon as it sees an
+ * element closer to home than the key would be.  Deleting shifts the following
+ * elements back one slot rather than leaving a tombstone.
+ */
 typedef struct _raw_hashmap_map{
-    int table_size;
+    unsigned mask;      /* table_size - 1 */
     int size;
-    raw_hashmap_element *data;
-    //semaphore_t lock;
+    int max_size;       /* grow when size would pass this */
+    unsigned scan;      /* where get_one last found something */
+    unsigned char *dist;
+    int64_t *keys;
+    any_t *data;
 } raw_hashmap_map;
 
+static int raw_hashmap_alloc(raw_hashmap_map *m, unsigned table_size) {
+    /* One block: the keys and data, then the distance bytes */
+    char *block = (char*) calloc(table_size, sizeof(int64_t) + sizeof(any_t) + 1);
+    if(!block) return RAW_HASHMAP_OMEM;
+    m->keys = (int64_t*) block;
+    m->data = (any_t*) (block + table_size * sizeof(int64_t));
+    m->dist = (unsigned char*) (block + table_size * (sizeof(int64_t) + sizeof(any_t)));
+    m->mask = table_size - 1;
+    m->max_size = table_size / 8 * 7;
+    m->size = 0;
+    m->scan = 0;
+    return RAW_HASHMAP_OK;
+}
+
 /*
  * Return an empty hashmap, or NULL on failure.
  */
 raw_hashmap_t raw_hashmap_new(void) {
     raw_hashmap_map* m = (raw_hashmap_map*) malloc(sizeof(raw_hashmap_map));
-    if(!m) goto err;
-
-    m->data = (raw_hashmap_element*) calloc(INITIAL_SIZE, sizeof(raw_hashmap_element));
-    if(!m->data) goto err;
-
-    //m->lock = (semaphore_t) semaphore_create();
-    //if(!m->lock) goto err;
-    //semaphore_initialize(m->lock, 1);
-
-    m->table_size = INITIAL_SIZE;
-    m->size = 0;
-
-    return m;
-    err:
-        if (m)
-            raw_hashmap_free(m);
+    if(!m) return NULL;
+    if(raw_hashmap_alloc(m, INITIAL_SIZE) != RAW_HASHMAP_OK) {
+        free(m);
         return NULL;
+    }
+    return m;
 }
 
 /*
- * Hashing function for an integer
+ * Home slot of a key
  */
-unsigned int raw_hashmap_hash_int(raw_hashmap_map * m, unsigned int key){
-    /* Robert Jenkins' 32 bit Mix Function */
-    key += (key << 12);
-    key ^= (key >> 22);
-    key += (key << 4);
-    key ^= (key >> 9);
-    key += (key << 10);
-    key ^= (key >> 2);
-    key += (key << 7);
-    key ^= (key >> 12);
-
-    /* Knuth's Multiplicative Method */
-    key = (key >> 3) * 2654435761;
-
-    return key % m->table_size;
+static unsigned raw_hashmap_home(raw_hashmap_map *m, int64_t key){
+    /* splitmix64's finalizer; every bit of the key affects the low bits we use */
+    uint64_t x = (uint64_t)key;
+    x ^= x >> 30; x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27; x *= 0x94d049bb133111ebULL;
+    x ^= x >> 31;
+    return (unsigned)x & m->mask;
 }
 
+static int raw_hashmap_grow(raw_hashmap_map *m);
+
 /*
- * Return the integer of the location in data
- * to store the point to the item, or RAW_HASHMAP_FULL.
+ * Put a key known not to be in the map, growing the map if need be.
  */
-int raw_hashmap_hash(raw_hashmap_t in, int key){
-    int curr;
-    int i;
-
-    /* Cast the raw_hashmap */
-    raw_hashmap_map* m = (raw_hashmap_map *) in;
-
-    /* If full, return immediately */
-    if(m->size == m->table_size) return RAW_HASHMAP_FULL;
-
-    /* Find the best index */
-    curr = raw_hashmap_hash_int(m, key);
-
-    /* Linear probling */
-    for(i = 0; i< m->table_size; i++){
-        if(m->data[curr].in_use == 0)
-            return curr;
-
-        if(m->data[curr].key == key && m->data[curr].in_use == 1)
-            return curr;
-
-        curr = (curr + 1) % m->table_size;
+static int raw_hashmap_insert_new(raw_hashmap_map *m, int64_t key, any_t value){
+    unsigned i, d = 1;
+    if(m->size >= m->max_size && raw_hashmap_grow(m) != RAW_HASHMAP_OK) return RAW_HASHMAP_OMEM;
+    for(i = raw_hashmap_home(m, key); m->dist[i]; i = (i+1) & m->mask, d++) {
+        if(d == MAX_DIST) {
+            /* so badly clustered that it's worth the memory; what we're carrying isn't in the map yet */
+            if(raw_hashmap_grow(m) != RAW_HASHMAP_OK) return RAW_HASHMAP_OMEM;
+            return raw_hashmap_insert_new(m, key, value);
+        }
+        if(m->dist[i] < d) { /* take from the rich: swap, and carry on inserting the one we displaced */
+            int64_t k = m->keys[i]; any_t v = m->data[i]; unsigned char e = m->dist[i];
+            m->keys[i] = key; m->data[i] = value; m->dist[i] = d;
+            key = k; value = v; d = e;
+        }
     }
-
-    return RAW_HASHMAP_FULL;
+    m->keys[i] = key; m->data[i] = value; m->dist[i] = d;
+    m->size++;
+    return RAW_HASHMAP_OK;
 }
 
 /*
  * Doubles the size of the raw_hashmap, and rehashes all the elements
  */
-int raw_hashmap_rehash(raw_hashmap_t in){
-    int i;
-    int old_size;
-    raw_hashmap_element* curr;
-
-    /* Setup the new elements */
-    raw_hashmap_map *m = (raw_hashmap_map *) in;
-    raw_hashmap_element* temp = (raw_hashmap_element *)
-        calloc(2 * m->table_size, sizeof(raw_hashmap_element));
-    if(!temp) return RAW_HASHMAP_OMEM;
-
-    /* Update the array */
-    curr = m->data;
-    m->data = temp;
-
-    /* Update the size */
-    old_size = m->table_size;
-    m->table_size = 2 * m->table_size;
-    m->size = 0;
-
-    /* Rehash the elements */
-    for(i = 0; i < old_size; i++){
-        int status = raw_hashmap_put(m, curr[i].key, curr[i].data);
-        if (status != RAW_HASHMAP_OK)
-            return status;
+static int raw_hashmap_grow(raw_hashmap_map *m){
+    raw_hashmap_map old = *m;
+    unsigned i;
+    if(raw_hashmap_alloc(m, 2 * (old.mask + 1)) != RAW_HASHMAP_OK) {
+        *m = old;
+        return RAW_HASHMAP_OMEM;
     }
-
-    free(curr);
-
+    /* This can grow again, if a probe gets MAX_DIST long; then a failure leaves m whole but without old's remaining elements */
+    for(i = 0; i <= old.mask; i++)
+        if(old.dist[i]) {
+            int status = raw_hashmap_insert_new(m, old.keys[i], old.data[i]);
+            if(status != RAW_HASHMAP_OK) {
+                free(old.keys);
+                return status;
+            }
+        }
+    free(old.keys);
     return RAW_HASHMAP_OK;
 }
 
 /*
- * Add a pointer to the raw_hashmap with some key
+ * The slot holding key, or -1
  */
-int raw_hashmap_put(raw_hashmap_t in, int key, any_t value){
-    int index;
-    raw_hashmap_map* m;
-
-    /* Cast the raw_hashmap */
-    m = (raw_hashmap_map *) in;
-
-    /* Lock for concurrency */
-    //semaphore_P(m->lock);
+static int raw_hashmap_find(raw_hashmap_map *m, int64_t key){
+    unsigned i, d;
+    for(i = raw_hashmap_home(m, key), d = 1; m->dist[i] >= d; i = (i+1) & m->mask, d++)
+        if(m->dist[i] == d && m->keys[i] == key)
+            return i;
+    return -1;
+}
 
-    /* Find a place to put our value */
-    index = raw_hashmap_hash(in, key);
-    while(index == RAW_HASHMAP_FULL){
-        if (raw_hashmap_rehash(in) == RAW_HASHMAP_OMEM) {
-            //semaphore_V(m->lock);
-            return RAW_HASHMAP_OMEM;
-        }
-        index = raw_hashmap_hash(in, key);
+/*
+ * Add a pointer to the raw_hashmap with some key, or replace the one that's there
+ */
+int raw_hashmap_put(raw_hashmap_t in, int64_t key, any_t value){
+    raw_hashmap_map* m = (raw_hashmap_map *) in;
+    int i = raw_hashmap_find(m, key);
+    if(i >= 0) {
+        m->data[i] = value;
+        return RAW_HASHMAP_OK;
     }
-
-    /* Set the data */
-    m->data[index].data = value;
-    m->data[index].key = key;
-    m->data[index].in_use = 1;
-    m->size++;
-
-    /* Unlock */
-    //semaphore_V(m->lock);
-
-    return RAW_HASHMAP_OK;
+    return raw_hashmap_insert_new(m, key, value);
 }
 
 /*
  * Get your pointer out of the raw_hashmap with a key
  */
-int raw_hashmap_get(raw_hashmap_t in, int key, any_t *arg){
-    int curr;
-    int i;
-    raw_hashmap_map* m;
-
-    /* Cast the raw_hashmap */
-    m = (raw_hashmap_map *) in;
-
-    /* Lock for concurrency */
-    //semaphore_P(m->lock);
-
-    /* Find data location */
-    curr = raw_hashmap_hash_int(m, key);
-
-    /* Linear probing, if necessary */
-    for(i = 0; i< m->table_size; i++){
-
-        if(m->data[curr].key == key && m->data[curr].in_use == 1){
-            *arg = (int *) (m->data[curr].data);
-            //semaphore_V(m->lock);
-            return RAW_HASHMAP_OK;
-        }
-
-        curr = (curr + 1) % m->table_size;
+int raw_hashmap_get(raw_hashmap_t in, int64_t key, any_t *arg){
+    raw_hashmap_map* m = (raw_hashmap_map *) in;
+    int i = raw_hashmap_find(m, key);
+    if(i < 0) {
+        *arg = NULL;
+        return RAW_HASHMAP_MISSING;
     }
+    *arg = m->data[i];
+    return RAW_HASHMAP_OK;
+}
 
-    *arg = NULL;
-
-    /* Unlock */
-    //semaphore_V(m->lock);
-
-    /* Not found */
-    return RAW_HASHMAP_MISSING;
+/*
+ * Empty slot i, shifting back the elements after it that aren't in their home slot
+ */
+static void raw_hashmap_delete_slot(raw_hashmap_map *m, unsigned i){
+    unsigned j;
+    for(j = (i+1) & m->mask; m->dist[j] > 1; i = j, j = (j+1) & m->mask) {
+        m->keys[i] = m->keys[j];
+        m->data[i] = m->data[j];
+        m->dist[i] = m->dist[j] - 1;
+    }
+    m->dist[i] = 0;
+    m->data[i] = NULL;
+    m->size--;
 }
 
 /*
  * Get the KEY of an arbitrary element from the raw_hashmap--NOT RANDOM, may return the same item each time.
+ * The search starts where the last one left off, so emptying a map this way takes linear time.
  */
-int raw_hashmap_get_one(raw_hashmap_t in, int *keyp, int remove){
-    int i;
-    raw_hashmap_map* m;
-
-    /* Cast the raw_hashmap */
-    m = (raw_hashmap_map *) in;
-
-    /* On empty raw_hashmap return immediately */
-    if (raw_hashmap_length(m) <= 0)
+int raw_hashmap_get_one(raw_hashmap_t in, int64_t *keyp, int remove){
+    raw_hashmap_map* m = (raw_hashmap_map *) in;
+    unsigned i;
+    if(m->size <= 0)
         return RAW_HASHMAP_MISSING;
+    for(i = m->scan & m->mask; !m->dist[i]; i = (i+1) & m->mask)
+        ;
+    m->scan = i;
+    *keyp = m->keys[i];
+    if(remove)
+        raw_hashmap_delete_slot(m, i);
+    return RAW_HASHMAP_OK;
+}
 
-    /* Lock for concurrency */
-    //semaphore_P(m->lock);
-
-    /* Linear probing */
-    for(i = 0; i< m->table_size; i++)
-        if(m->data[i].in_use != 0){
-            *keyp = (m->data[i].key);
-            if (remove) {
-                m->data[i].in_use = 0;
-                m->size--;
-            }
-            //semaphore_V(m->lock);
+/*
+ * Step through the elements: start with *iter = 0.
+ */
+int raw_hashmap_next(raw_hashmap_t in, int *iter, int64_t *keyp, any_t *arg){
+    raw_hashmap_map* m = (raw_hashmap_map *) in;
+    unsigned i;
+    for(i = *iter; i <= m->mask; i++)
+        if(m->dist[i]) {
+            if(keyp) *keyp = m->keys[i];
+            if(arg) *arg = m->data[i];
+            *iter = i + 1;
             return RAW_HASHMAP_OK;
         }
-
-    /* Unlock */
-    //semaphore_V(m->lock);
-
-    return RAW_HASHMAP_OK;
+    *iter = i;
+    return RAW_HASHMAP_MISSING;
 }
 
 /*
  * Iterate the function parameter over each element in the raw_hashmap.
  */
 int raw_hashmap_iterate(raw_hashmap_t in, PFany f) {
-    int i;
-
-    /* Cast the raw_hashmap */
-    raw_hashmap_map* m = (raw_hashmap_map*) in;
+    int64_t key;
+    any_t data;
+    int iter = 0;
 
     /* On empty raw_hashmap, return immediately */
-    if (raw_hashmap_length(m) <= 0)
+    if (raw_hashmap_length(in) <= 0)
         return RAW_HASHMAP_MISSING;
 
-    /* Lock for concurrency */
-    //semaphore_P(m->lock);
-
-    /* Linear probing */
-    for(i = 0; i< m->table_size; i++)
-        if(m->data[i].in_use != 0) {
-            int key    = (int) (m->data[i].key);
-            any_t data = (any_t) (m->data[i].data);
-            int status = f(key, data);
-            if (status != RAW_HASHMAP_OK) {
-                //semaphore_V(m->lock);
-                return status;
-            }
-        }
-
-    /* Unlock */
-    //semaphore_V(m->lock);
-
-        return RAW_HASHMAP_OK;
+    while(raw_hashmap_next(in, &iter, &key, &data) == RAW_HASHMAP_OK) {
+        int status = f(key, data);
+        if (status != RAW_HASHMAP_OK)
+            return status;
+    }
+    return RAW_HASHMAP_OK;
 }
 
 /*
  * Remove an element with that key from the map
  */
-int raw_hashmap_remove(raw_hashmap_t in, int key){
-    int i;
-    int curr;
-    raw_hashmap_map* m;
-
-    /* Cast the raw_hashmap */
-    m = (raw_hashmap_map *) in;
-
-    /* Lock for concurrency */
-    //semaphore_P(m->lock);
-
-    /* Find key */
-    curr = raw_hashmap_hash_int(m, key);
-
-    /* Linear probing, if necessary */
-    for(i = 0; i< m->table_size; i++){
-        if(m->data[curr].key == key && m->data[curr].in_use == 1){
-            /* Blank out the fields */
-            m->data[curr].in_use = 0;
-            m->data[curr].data = NULL;
-            m->data[curr].key = 0;
-
-            /* Reduce the size */
-            m->size--;
-            //semaphore_V(m->lock);
-            return RAW_HASHMAP_OK;
-        }
-        curr = (curr + 1) % m->table_size;
-    }
-
-    /* Unlock */
-    //semaphore_V(m->lock);
-
-    /* Data not found */
-    return RAW_HASHMAP_MISSING;
+int raw_hashmap_remove(raw_hashmap_t in, int64_t key){
+    raw_hashmap_map* m = (raw_hashmap_map *) in;
+    int i = raw_hashmap_find(m, key);
+    if(i < 0)
+        return RAW_HASHMAP_MISSING;
+    raw_hashmap_delete_slot(m, i);
+    return RAW_HASHMAP_OK;
 }
 
 /* Deallocate the raw_hashmap */
 void raw_hashmap_free(raw_hashmap_t in){
     raw_hashmap_map* m = (raw_hashmap_map*) in;
-    free(m->data);
-    //semaphore_destroy(m->lock);
+    free(m->keys);
     free(m);
 }
 
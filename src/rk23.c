@@ -17,16 +17,18 @@ extern "C" {
 *             USED OR A MESSAGE THAT MINIMUM STEPSIZE WAS EXCEEDED.
 */
 
+#include <float.h>
 #include "rk23.h"
 
-static double minNorm(int n, double v[n])
+// the error estimate is the largest error in any component (this used to be the smallest signed one)
+static double maxNorm(int n, double v[n])
 {
 	int i;
-	double norm = v[0];
+	double norm = fabs(v[0]);
 	for( i=0; i<n; i++)
 	{
-		if (norm > v[i])
-			norm = v[i];
+		if (norm < fabs(v[i]))
+			norm = fabs(v[i]);
 	}
 	return norm;
 }
@@ -45,81 +47,204 @@ RK23 *Rk23Alloc(int n, double t, double *y, F_EVAL f, int stiff_flag,
     r->w = y;
     r->F = f;
     r->T = t;
+    r->whichRoot = -1;
 
     return r;
 }
 
-/* Do the actual integration.  Return the actual TOUT */
-double Rk23Integrate(RK23 *r, double B)
+/*
+** One attempt at a step from T toward B. Returns whether it was accepted; if so, the step taken is in *h,
+** the state before it in w0, and H*F at its start and end in K0 and K3 (the latter is the F at the new T,
+** since the last stage is evaluated at the new solution).
+*/
+static Boolean Rk23Step(RK23 *r, double B, double K0[], double K3[], double w0[], double *h)
 {
-    double K0[r->n],K1[r->n], K2[r->n], K3[r->n], R;
+    double K1[r->n], K2[r->n], R;
     double t1[r->n], t2[r->n], t3[r->n], t4[r->n]; // temp vectors
+    Boolean accepted = false;
 
-    while(r->T < B)
-    {
-	/* STEP 3 */
-	// stage K0 = F(T,W);
-	r->F(r->n, r->T, r->w, K0); VecScalMul(r->n, K0, r->H, K0);
-	// stage K1 = H*F(T+H/2,W+K0/2);
-	VecCopy(r->n, t1, K0); VecScalMul(r->n, t1, 0.5, t1); VecAdd(r->n, t1, t1, r->w);
-	r->F(r->n, r->T+(r->H)/2, t1, K1); VecScalMul(r->n, K1, r->H, K1);
-	// stage K2 = H*F(T+3*H/4,W+3*K1/4);
-	VecCopy(r->n, t1, K1); VecScalMul(r->n, t1, 0.75, t1); VecAdd(r->n, t1, t1, r->w);
-	r->F(r->n, r->T+(3/4.0)*r->H, t1, K2); VecScalMul(r->n, K2, r->H, K2);
-	// stage K3 = H*F(T+H,W+(2*K0+3*K1+4*K2)/9);
+    /* STEP 3 */
+    // stage K0 = F(T,W);
+    r->F(r->n, r->T, r->w, K0); VecScalMul(r->n, K0, r->H, K0);
+    // stage K1 = H*F(T+H/2,W+K0/2);
+    VecCopy(r->n, t1, K0); VecScalMul(r->n, t1, 0.5, t1); VecAdd(r->n, t1, t1, r->w);
+    r->F(r->n, r->T+(r->H)/2, t1, K1); VecScalMul(r->n, K1, r->H, K1);
+    // stage K2 = H*F(T+3*H/4,W+3*K1/4);
+    VecCopy(r->n, t1, K1); VecScalMul(r->n, t1, 0.75, t1); VecAdd(r->n, t1, t1, r->w);
+    r->F(r->n, r->T+(3/4.0)*r->H, t1, K2); VecScalMul(r->n, K2, r->H, K2);
+    // stage K3 = H*F(T+H,W+(2*K0+3*K1+4*K2)/9);
+    VecCopy(r->n, t1, K0); VecCopy(r->n, t2, K1); VecCopy(r->n, t3, K2);
+    VecScalMul(r->n, t1, 2/9.0, t1); VecScalMul(r->n, t2, 3/9.0, t2); VecScalMul(r->n, t3, 4/9.0, t3);
+    VecAdd(r->n, t1, t1, r->w); VecAdd(r->n, t2, t2, t1); VecAdd(r->n, t3, t3, t2);
+    r->F(r->n, r->T+r->H, t3, K3); VecScalMul(r->n, K3, r->H, K3);
+
+    /* STEP 4 */
+    //stage R = absval(-K0/2+K1/2)/H;
+    //stage R = absval(5*K0/72-K1/12-K2/9+K3/8)/H
+    VecCopy(r->n, t1, K0); VecCopy(r->n, t2, K1); VecCopy(r->n, t3, K2); VecCopy(r->n, t4, K3);
+    VecScalMul(r->n, t1, 5/72.0, t1); VecScalMul(r->n, t2, -1/12.0, t2); VecScalMul(r->n, t3, -1/9.0, t3);
+    VecScalMul(r->n, t4, 1/8.0, t4);
+    VecAdd(r->n, t2, t2, t1); VecAdd(r->n, t3, t3, t2); VecAdd(r->n, t4, t4, t3);
+
+    R=maxNorm(r->n, t4)/r->H;
+    /* STEP 5 */
+    if (r->TOL < 0 || R <= r->TOL) {
+	/* STEP 6 */
+	/* APPROXIMATION ACCEPTED */
+	accepted = true;
+	*h = r->H;
+	VecCopy(r->n, w0, r->w);
+	r->T = r->T + r->H;
+	//Stage W = W +K0
+	//Stage W = W+2*K0/9+K1/3+4*K2/9;
 	VecCopy(r->n, t1, K0); VecCopy(r->n, t2, K1); VecCopy(r->n, t3, K2);
-	VecScalMul(r->n, t1, 2/9.0, t1); VecScalMul(r->n, t2, 3/9.0, t2); VecScalMul(r->n, t3, 4/9.0, t3);
+	VecScalMul(r->n, t1, 2/9.0, t1); VecScalMul(r->n, t2, 1/3.0, t2); VecScalMul(r->n, t3, 4/9.0, t3);
 	VecAdd(r->n, t1, t1, r->w); VecAdd(r->n, t2, t2, t1); VecAdd(r->n, t3, t3, t2);
-	r->F(r->n, r->T+r->H, t3, K3); VecScalMul(r->n, K3, r->H, K3);
-
-	/* STEP 4 */
-	//stage R = absval(-K0/2+K1/2)/H;
-	//stage R = absval(5*K0/72-K1/12-K2/9+K3/8)/H
-	VecCopy(r->n, t1, K0); VecCopy(r->n, t2, K1); VecCopy(r->n, t3, K2); VecCopy(r->n, t4, K3);
-	VecScalMul(r->n, t1, 5/72.0, t1); VecScalMul(r->n, t2, -1/12.0, t2); VecScalMul(r->n, t3, -1/9.0, t3);
-	VecScalMul(r->n, t4, 3/8.0, t4);
-	VecAdd(r->n, t2, t2, t1); VecAdd(r->n, t3, t3, t2); VecAdd(r->n, t4, t4, t3);
-
-	R=minNorm(r->n, t4)/r->H;
-	/* STEP 5 */
-	if (r->TOL < 0 || R <= r->TOL) {
-	    /* STEP 6 */
-	    /* APPROXIMATION ACCEPTED */
-	    r->T = r->T + r->H;
-	    //Stage W = W +K0
-	    //Stage W = W+2*K0/9+K1/3+4*K2/9;
-	    VecCopy(r->n, t1, K0); VecCopy(r->n, t2, K1); VecCopy(r->n, t3, K2);
-	    VecScalMul(r->n, t1, 2/9.0, t1); VecScalMul(r->n, t2, 1/3.0, t2); VecScalMul(r->n, t3, 4/9.0, t3);
-	    VecAdd(r->n, t1, t1, r->w); VecAdd(r->n, t2, t2, t1); VecAdd(r->n, t3, t3, t2);
-	    VecCopy(r->n, r->w, t3);
+	VecCopy(r->n, r->w, t3);
+    }
+    if(r->TOL >= 0)
+    {
+	/* STEP 8 */
+	/* TO AVOID UNDERFLOW */
+	double DELTA;
+	if (R > 1.0E-20) DELTA = 0.84 * exp(0.25 * log(r->TOL / R));
+	else DELTA = 10.0;
+
+	/* STEP 9 */
+	/* CALCULATE NEW H */
+	if (DELTA <= 0.1) r->H = 0.1 * r->H;
+	else {
+	    if (DELTA >= 4.0) r->H = 4.0 * r->H;
+	    else r->H = DELTA * r->H;
 	}
-	if(r->TOL >= 0)
+	/* STEP 10 */
+	if (r->H > r->HMAX) r->H = r->HMAX;
+	/* STEP 11 */
+	if (r->H < r->HMIN) r->H = r->HMIN;
+	if (r->T+r->H > B)
 	{
-	    /* STEP 8 */
-	    /* TO AVOID UNDERFLOW */
-	    double DELTA;
-	    if (R > 1.0E-20) DELTA = 0.84 * exp(0.25 * log(r->TOL / R));
-	    else DELTA = 10.0;
-
-	    /* STEP 9 */
-	    /* CALCULATE NEW H */
-	    if (DELTA <= 0.1) r->H = 0.1 * r->H;
-	    else {
-		if (DELTA >= 4.0) r->H = 4.0 * r->H;
-		else r->H = DELTA * r->H;
+	   if (fabs(B-r->T) < r->TOL) r->T = B;
+	   else r->H = B - r->T;
+	}
+    }
+    return accepted;
+}
+
+/* Do the actual integration.  Return the actual TOUT */
+double Rk23Integrate(RK23 *r, double B)
+{
+    double K0[r->n], K3[r->n], w0[r->n], h;
+
+    while(r->T < B)
+	Rk23Step(r, B, K0, K3, w0, &h);
+    return B;
+}
+
+// The cubic Hermite interpolant on a step of size h from (t0,w0) to (t0+h,w1), with H*F = K0 and K3 at its ends.
+static void Hermite(int n, double t0, double h, double w0[], double w1[], double K0[], double K3[], double t, double y[])
+{
+    double s = (t - t0)/h, s1 = s - 1;
+    double h00 = (1+2*s)*s1*s1, h10 = s*s1*s1, h01 = s*s*(3-2*s), h11 = s*s*s1;
+    int i;
+    for(i=0; i<n; i++) y[i] = h00*w0[i] + h10*K0[i] + h01*w1[i] + h11*K3[i];
+}
+
+/*
+** Find the root of root function i in (a,b], where its values are ga and gb of opposite signs, by the
+** Illinois variant of regula falsi on the interpolant. Returns a time at or just past the root, so that g has
+** already changed sign there and the same root isn't found again on the next call.
+*/
+static double LocateRoot(RK23 *r, int i, double t0, double h, double w0[], double K0[], double K3[],
+    double a, double ga, double b, double gb)
+{
+    double y[r->n];
+    int side = 0, iter;
+    for(iter=0; iter<100 && b - a > 4*DBL_EPSILON*MAX(fabs(a), fabs(b)); iter++)
+    {
+	double c = (a*gb - b*ga)/(gb - ga), gc;
+	if(!(a < c && c < b)) c = (a+b)/2;
+	Hermite(r->n, t0, h, w0, r->w, K0, K3, c, y);
+	gc = r->G(r->n, c, y, i);
+	if(gc == 0) return c;
+	if((gc > 0) == (gb > 0)) {
+	    b = c; gb = gc;
+	    if(side == -1) ga /= 2;
+	    side = -1;
+	} else {
+	    a = c; ga = gc;
+	    if(side == 1) gb /= 2;
+	    side = 1;
+	}
+    }
+    return b;
+}
+
+int Rk23IntegrateDense(RK23 *r, int nOut, const double *tout, double *yout)
+{
+    const int n = r->n;
+    double K0[n], K3[n], w0[n], g1[MAX(r->nroot,1)], h;
+    int i, k = 0;
+
+    if(nOut <= 0) return 0;
+    assert(tout[0] >= r->T);
+    for(k=1; k<nOut; k++) assert(tout[k] >= tout[k-1]);
+    k = 0;
+    for(i=0; i<r->nroot; i++) r->g0[i] = r->G(n, r->T, r->w, i);
+    while(k < nOut && tout[k] <= r->T) VecCopy(n, yout + n*k++, r->w);
+
+    while(k < nOut)
+    {
+	double t0 = r->T;
+	if(!Rk23Step(r, tout[nOut-1], K0, K3, w0, &h)) {
+	    if(r->T >= tout[nOut-1]) // Rk23Step rounded T up to the end
+		while(k < nOut) VecCopy(n, yout + n*k++, r->w);
+	    continue;
+	}
+
+	// if any root function changed sign during the step, stop at the earliest such root
+	double tRoot = r->T;
+	r->whichRoot = -1;
+	for(i=0; i<r->nroot; i++) {
+	    g1[i] = r->G(n, r->T, r->w, i);
+	    if(r->g0[i] != 0 && (g1[i] == 0 || (g1[i] > 0) != (r->g0[i] > 0))) {
+		double t = g1[i] == 0 ? r->T : LocateRoot(r, i, t0, h, w0, K0, K3, t0, r->g0[i], r->T, g1[i]);
+		if(r->whichRoot < 0 || t < tRoot) { tRoot = t; r->whichRoot = i; }
 	    }
-	    /* STEP 10 */
-	    if (r->H > r->HMAX) r->H = r->HMAX;
-	    /* STEP 11 */
-	    if (r->H < r->HMIN) r->H = r->HMIN;
-	    if (r->T+r->H > B)
-	    {
-	       if (fabs(B-r->T) < r->TOL) r->T = B;
-	       else r->H = B - r->T;
+	}
+	while(k < nOut && tout[k] <= tRoot) {
+	    Hermite(n, t0, h, w0, r->w, K0, K3, tout[k], yout + n*k);
+	    k++;
+	}
+	if(r->whichRoot >= 0) {
+	    if(tRoot < r->T) {
+		double y[n];
+		Hermite(n, t0, h, w0, r->w, K0, K3, tRoot, y);
+		VecCopy(n, r->w, y);
+		r->T = tRoot;
 	    }
+	    return k;
 	}
+	for(i=0; i<r->nroot; i++) r->g0[i] = g1[i];
     }
-    return B;
+    return nOut;
+}
+
+void Rk23PrepRoot(RK23 *r, int nroot, G_EVAL g)
+{
+    assert(nroot >= 0 && (nroot == 0 || g));
+    Free(r->g0);
+    r->g0 = nroot ? Calloc(nroot, sizeof(double)) : NULL;
+    r->nroot = nroot;
+    r->G = g;
+    r->whichRoot = -1;
+}
+
+int Rk23WhichRoot(RK23 *r) { return r->whichRoot; }
+
+void Rk23Free(RK23 *r)
+{
+    Free(r->g0);
+    Free(r);
 }
 #ifdef __cplusplus
 } // end extern "C"
@@ -75,11 +75,11 @@ RK4S *Rk4sAlloc(int n, double Time, double *y, F_EVAL f, int stiff_flag,
  */
 static void Rk4sStep(double *y, RK4S *l, double dt)
 {
-    static double _b[5] = { 0.0617588581356263250,
+    static const double _b[5] = { 0.0617588581356263250,
 	0.3389780265536433551, 0.6147913071755775662,
 	-0.1405480146593733802, 0.1250198227945261338};
 
-    static double _B[5] = { 0.0000000000000000000,
+    static const double _B[5] = { 0.0000000000000000000,
 	0.2051776615422863900, 0.4030212816042146300,
 	-0.1209208763389140700, 0.5127219331924131000};
 
@@ -59,7 +59,7 @@ void Rkd78Free(RKD78 *r)
  */
 
 
-static RKD78 *_gr;
+static __thread RKD78 *_gr; /* the object this thread is integrating; all RDMETH78's own state is in the object */
 
 static void FORT_F(int *NN, double *TT, double *YY, double *YP)
 {
@@ -72,7 +72,8 @@ double Rkd78Integrate(RKD78 *r, double TOUT) /* returns actual tout */
     int direction = TOUT - r->T > 0 ? 1 : -1;
     extern void rdmeth78_(int*,...);
 
-     _gr = r;
+    RKD78 *outer = _gr; /* in case we're being called from inside another RKD78's F */
+    _gr = r;
 
     while(direction*(r->T - TOUT) < 0)
     {
@@ -108,6 +109,7 @@ double Rkd78Integrate(RKD78 *r, double TOUT) /* returns actual tout */
 	    break;
 	}
     }
+    _gr = outer;
     return r->T;
 }
 #ifdef __cplusplus
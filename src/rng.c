@@ -0,0 +1,279 @@
+// This software is part of github.com/waynebhayes/libwayne, and is Copyright(C) Wayne B. Hayes 2025, under the GNU LGPL 3.0
+// (GNU Lesser General Public License, version 3, 2007), a copy of which is contained at the top of the repo.
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+#include "rng.h"
+
+// splitmix64: turns any 64-bit seed (even 0 or a small integer) into well-mixed state words
+static uint64_t SplitMix64(uint64_t *x) {
+    uint64_t z = (*x += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+static inline uint64_t Rotl(const uint64_t x, int k) { return (x << k) | (x >> (64 - k)); }
+
+static inline uint64_t XoshiroNext(uint64_t s[4]) {
+    const uint64_t result = Rotl(s[1] * 5, 7) * 9;
+    const uint64_t t = s[1] << 17;
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = Rotl(s[3], 45);
+    return result;
+}
+
+static void XoshiroJump(uint64_t s[4]) {
+    static const uint64_t JUMP[] = { 0x180ec6d33cfd0aba, 0xd5a61266f0c9392c, 0xa9582618e03fc9aa, 0x39abdc4529b1661c };
+    uint64_t t[4] = {0,0,0,0};
+    int i, b, j;
+    for(i = 0; i < 4; i++)
+	for(b = 0; b < 64; b++) {
+	    if (JUMP[i] & (1ULL << b))
+		for(j=0;j<4;j++) t[j] ^= s[j];
+	    XoshiroNext(s);
+	}
+    for(j=0;j<4;j++) s[j] = t[j];
+}
+
+#define PHILOX_M0 0xD2511F53U
+#define PHILOX_M1 0xCD9E8D57U
+#define PHILOX_W0 0x9E3779B9U
+#define PHILOX_W1 0xBB67AE85U
+
+// The Philox4x32-10 bijection: out = f_key(ctr). Written on plain arrays so the bulk loop below vectorizes.
+static inline void PhiloxBlock(const uint32_t key[2], const uint32_t ctr[4], uint32_t out[4]) {
+    uint32_t c0=ctr[0], c1=ctr[1], c2=ctr[2], c3=ctr[3], k0=key[0], k1=key[1];
+    int round;
+    for(round=0; round<10; round++) {
+	uint64_t p0 = (uint64_t)PHILOX_M0 * c0, p1 = (uint64_t)PHILOX_M1 * c2;
+	uint32_t n0 = (uint32_t)(p1 >> 32) ^ c1 ^ k0, n2 = (uint32_t)(p0 >> 32) ^ c3 ^ k1;
+	c1 = (uint32_t)p1; c3 = (uint32_t)p0; c0 = n0; c2 = n2;
+	k0 += PHILOX_W0; k1 += PHILOX_W1;
+    }
+    out[0]=c0; out[1]=c1; out[2]=c2; out[3]=c3;
+}
+
+// add n to the 128-bit counter
+static void PhiloxAdvance(uint32_t ctr[4], uint64_t n) {
+    uint64_t lo = ((uint64_t)ctr[1] << 32 | ctr[0]) + n;
+    Boolean carry = (lo < n);
+    ctr[0] = (uint32_t)lo; ctr[1] = (uint32_t)(lo >> 32);
+    if(carry && ++ctr[2] == 0) ++ctr[3];
+}
+
+static inline uint32_t PhiloxNext32(RNG *r) {
+    if(r->u.philox.used == 4) {
+	PhiloxBlock(r->u.philox.key, r->u.philox.ctr, r->u.philox.out);
+	PhiloxAdvance(r->u.philox.ctr, 1);
+	r->u.philox.used = 0;
+    }
+    return r->u.philox.out[r->u.philox.used++];
+}
+
+void RngInit(RNG *r, RNG_TYPE type, uint64_t seed) {
+    int i;
+    r->type = type;
+    r->haveNormal = false;
+    switch(type) {
+    case RNG_XOSHIRO:
+	for(i=0;i<4;i++) r->u.s[i] = SplitMix64(&seed); // splitmix never yields the all-zero state xoshiro forbids
+	break;
+    case RNG_PHILOX: {
+	uint64_t k = SplitMix64(&seed);
+	r->u.philox.key[0] = (uint32_t)k; r->u.philox.key[1] = (uint32_t)(k >> 32);
+	for(i=0;i<4;i++) r->u.philox.ctr[i] = 0;
+	r->u.philox.used = 4; // buffer empty
+	break;
+	}
+    default: Fatal("RngInit: unknown RNG type %d", type);
+    }
+}
+
+RNG *RngAlloc(RNG_TYPE type, uint64_t seed) {
+    RNG *r = Malloc(sizeof(RNG));
+    RngInit(r, type, seed);
+    return r;
+}
+
+RNG *RngStreams(RNG_TYPE type, uint64_t seed, int n) {
+    RNG *r = Malloc(n * sizeof(RNG));
+    int i;
+    assert(n > 0);
+    RngInit(&r[0], type, seed);
+    for(i=1; i<n; i++) { r[i] = r[i-1]; RngJump(&r[i]); }
+    return r;
+}
+
+void RngFree(RNG *r) { Free(r); }
+
+uint64_t RngNext64(RNG *r) {
+    if(r->type == RNG_XOSHIRO) return XoshiroNext(r->u.s);
+    uint64_t lo = PhiloxNext32(r);
+    return (uint64_t)PhiloxNext32(r) << 32 | lo;
+}
+
+uint32_t RngNext32(RNG *r) {
+    if(r->type == RNG_XOSHIRO) return (uint32_t)(XoshiroNext(r->u.s) >> 32); // the upper bits are the best ones
+    return PhiloxNext32(r);
+}
+
+double RngUniform(RNG *r) { return (RngNext64(r) >> 11) * 0x1.0p-53; }
+
+// Lemire's nearly-divisionless method: multiply into the 128-bit product and reject the few biased low parts.
+long RngInt(RNG *r, long minimum, long maximum) {
+    assert(minimum <= maximum);
+    uint64_t range = (uint64_t)maximum - (uint64_t)minimum + 1;
+    if(range == 0) return (long)RngNext64(r); // the full 64-bit range
+    unsigned __int128 m = (unsigned __int128)RngNext64(r) * range;
+    uint64_t low = (uint64_t)m;
+    if(low < range) {
+	uint64_t threshold = -range % range;
+	while(low < threshold) {
+	    m = (unsigned __int128)RngNext64(r) * range;
+	    low = (uint64_t)m;
+	}
+    }
+    return minimum + (long)(m >> 64);
+}
+
+// Same polar method as StatRV_Normal, but with the spare kept in the RNG.
+double RngNormal(RNG *r) {
+    double fac, rsq, v1, v2;
+    if(r->haveNormal) {
+	r->haveNormal = false;
+	return r->nextNormal;
+    }
+    do {
+	v1 = 2*RngUniform(r)-1;
+	v2 = 2*RngUniform(r)-1;
+	rsq = v1*v1 + v2*v2;
+    } while(rsq >= 1 || rsq == 0);
+    fac = sqrt(-2*log(rsq)/rsq);
+    r->nextNormal = v1*fac;
+    r->haveNormal = true;
+    return v2*fac;
+}
+
+void RngJump(RNG *r) {
+    r->haveNormal = false;
+    if(r->type == RNG_XOSHIRO) XoshiroJump(r->u.s);
+    else { // next substream: bump the top word of the counter and start at the beginning of its block
+	r->u.philox.ctr[3]++;
+	r->u.philox.used = 4;
+    }
+}
+
+void RngSkip(RNG *r, uint64_t n) {
+    if(r->type == RNG_XOSHIRO) {
+	uint64_t i;
+	for(i=0; i<n; i++) RngNext32(r);
+	return;
+    }
+    // use up what's left of the current block, then skip whole blocks and land part way into one
+    while(n > 0 && r->u.philox.used < 4) { r->u.philox.used++; n--; }
+    if(n == 0) return;
+    PhiloxAdvance(r->u.philox.ctr, n/4);
+    if(n % 4) {
+	PhiloxNext32(r); // generates the block and takes its first output
+	r->u.philox.used += n % 4 - 1;
+    }
+}
+
+#define PHILOX_BULK 8 // blocks computed side by side in RngUniformBulk
+
+void RngUniformBulk(RNG *r, double *out, size_t n) {
+    size_t i = 0;
+    if(r->type == RNG_XOSHIRO) {
+	uint64_t s[4] = {r->u.s[0], r->u.s[1], r->u.s[2], r->u.s[3]}; // a local copy stays in registers
+	for(i=0; i<n; i++) out[i] = (XoshiroNext(s) >> 11) * 0x1.0p-53;
+	for(i=0; i<4; i++) r->u.s[i] = s[i];
+	return;
+    }
+    // Philox: PHILOX_BULK independent counters at a time, two doubles per block
+    if(r->u.philox.used == 4) {
+	uint32_t ctr[PHILOX_BULK][4], blk[PHILOX_BULK][4];
+	int b, j;
+	while(n - i >= 2*PHILOX_BULK) {
+	    for(b=0; b<PHILOX_BULK; b++) {
+		for(j=0; j<4; j++) ctr[b][j] = r->u.philox.ctr[j];
+		PhiloxAdvance(ctr[b], b);
+	    }
+	    for(b=0; b<PHILOX_BULK; b++) PhiloxBlock(r->u.philox.key, ctr[b], blk[b]);
+	    for(b=0; b<PHILOX_BULK; b++) {
+		out[i++] = (((uint64_t)blk[b][1] << 32 | blk[b][0]) >> 11) * 0x1.0p-53;
+		out[i++] = (((uint64_t)blk[b][3] << 32 | blk[b][2]) >> 11) * 0x1.0p-53;
+	    }
+	    PhiloxAdvance(r->u.philox.ctr, PHILOX_BULK);
+	}
+    }
+    for(; i<n; i++) out[i] = RngUniform(r);
+}
+
+// The polar method two at a time, straight into out[]: the same numbers as RngNormal(), without the spare's
+// bookkeeping on every call. (Box-Muller avoids the rejection loop but its sin and cos cost more than that.)
+void RngNormalBulk(RNG *r, double *out, size_t n) {
+    size_t i = 0;
+    double fac, rsq, v1, v2;
+    if(n > 0 && r->haveNormal) out[i++] = RngNormal(r);
+    for(; i+1<n; i+=2) {
+	do {
+	    v1 = 2*RngUniform(r)-1;
+	    v2 = 2*RngUniform(r)-1;
+	    rsq = v1*v1 + v2*v2;
+	} while(rsq >= 1 || rsq == 0);
+	fac = sqrt(-2*log(rsq)/rsq);
+	out[i] = v2*fac;
+	out[i+1] = v1*fac;
+    }
+    if(i < n) out[i] = RngNormal(r);
+}
+
+
+// Stream48 replacements
+
+static RNG *_streams;
+static int _numStreams;
+static __thread int _whichStream;
+
+void RngStreamInit(RNG_TYPE type, int n, uint64_t seed) {
+    if(n <= 0) Fatal("RngStreamInit: need at least one stream, not %d", n);
+    if(_streams) RngFree(_streams);
+    _streams = RngStreams(type, seed, n);
+    _numStreams = n;
+}
+
+static RNG *CurrentStream(void) {
+    if(!_streams) RngStreamInit(RNG_XOSHIRO, 1, 0);
+    return &_streams[_whichStream];
+}
+
+int RngStream(int n) {
+    int old = _whichStream;
+    if(!_streams) RngStreamInit(RNG_XOSHIRO, 1, 0);
+    if(n < 0 || n >= _numStreams) Fatal("RngStream: no such stream %d", n);
+    _whichStream = n;
+    return old;
+}
+
+int RngStreamWhich(void) { return _whichStream; }
+
+RNG *RngStreamState(void) { return CurrentStream(); }
+
+long RngStreamRandomize(void) {
+    long seed = time(NULL) + getpid() + _whichStream;
+    RNG *r = CurrentStream();
+    RngInit(r, r->type, seed);
+    return seed;
+}
+
+long RngStreamRandInt(long minimum, long maximum) { return RngInt(CurrentStream(), minimum, maximum); }
+
+double RngStreamRand(void) {
+    double r = RngUniform(CurrentStream());
+    return (r == 0.0) ? 1e-10 : r;
+}
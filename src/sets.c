@@ -19,7 +19,9 @@ extern "C" {
 
 #include <stdio.h>
 #include <stdarg.h>
+#include <pthread.h>
 #include "sets.h"
+#include "sorts.h"
 
 /*
 ** BitvecStartup needs to set some stuff, and since we use it bitvecs...
@@ -102,7 +104,7 @@ SET *SetAlloc(SET_ELEMENT_TYPE n)
 }
 #endif
 
-// Used when qsort'ing the neighbors when graph is sparse.
+// Used when bsearch'ing the sorted list of a sparse set.
 static int ElementCmp(const void *a, const void *b)
 {
     const SET_ELEMENT_TYPE *i = (const SET_ELEMENT_TYPE*)a, *j = (const SET_ELEMENT_TYPE*)b;
@@ -115,7 +117,7 @@ static void SetListSort(SET *s)
 {
     if(!s->list) {assert(s->listSize==0); return;}
     if(s->numSorted == s->cardinality) return;
-    qsort(s->list, s->cardinality, sizeof(SET_ELEMENT_TYPE), ElementCmp);
+    RadixSortU32(s->list, s->cardinality);
 #if PARANOID_ASSERTS
     int i; for(i=1; i < s->cardinality; i++) assert(s->list[i-1] < s->list[i]); // ensure it's sorted
 #endif
@@ -679,139 +681,221 @@ void SetPrint(SET *A)
 ** SSETDICT: a set of sets.  Idea is to be able to store sets and quickly
 ** query if a set is in the dictionary yet.  Used mostly by the circulant
 ** graph generation routines which need to quickly see if a circulant has
-** already been generated yet.  Each set is stored only once -- adding
-** an already existing set does nothing.  At allocation time, you need to
-** know about how many items will eventually be stored.
-** Implementation is an array of hash tables all of the same size.
-** Collisions are resolved by putting it in the next hash table "down",
-** and if you run out of hash tables then you move to the first hash
-** table's next position, etc.
+** already been generated yet, and to dedup graphlets.  Each set is stored
+** only once -- adding an already existing set does nothing.  The size given
+** at allocation time is only a hint.
+** Implementation is open addressing with linear probing in a power-of-two
+** table that's never more than 3/4 full.  Sets often differ only in a few
+** low bits, so they're thoroughly mixed before being used as an index.
+** The empty set is never stored, so it marks empty slots.
+** Growing doesn't stop the world: a table twice the size is allocated, and
+** each Add then moves a few slots of the old one into it, while lookups
+** check both until it's done.  Moved sets are left in the old table so as
+** not to break its probe sequences.
 */
 
-/*
-** Number of "stacked" hash tables.  Experiments show that as long as
-** the initial allocation is a good estimate of the actual number of
-** things eventually to be inserted, then there's no gain to have more
-** than two.
-*/
-#define NUM_HASHES 2
+#define SSETDICT_MIN 16
+#define SSETDICT_MOVES 8	/* old slots moved per Add while growing; finishes before the new table is 3/4 full */
 
 struct _ssetDict {
-    SSET *array[NUM_HASHES];
-    int nCols;	/* number of columns - always prime */
-    int nElem;	/* numbef of elements currently stored, not including NULLSET */
+    SSET *table;
+    unsigned long mask;	/* the table has mask+1 slots */
+    unsigned long nElem;	/* number of elements currently stored, not including NULLSET; in concurrent mode, plus adds in progress */
     Boolean containsNull; /* never explicitly store the empty Set */
+    SSET *old;	/* while growing, the table being moved out of; else NULL */
+    unsigned long oldMask, moved;	/* old has oldMask+1 slots, of which the first "moved" have been moved */
+    Boolean concurrent;	/* see SSetDictConcurrent */
+    pthread_rwlock_t lock;	/* concurrent adds share it; growing takes it alone */
 };
 
+static unsigned long SSetHash(SSET ss)
+{
+#if SMALL_SET_SIZE == 128
+    uint64_t x = (uint64_t)ss ^ (uint64_t)(ss >> 64) * 0x9e3779b97f4a7c15ULL;
+#else
+    uint64_t x = ss;
+#endif
+    x ^= x >> 30; x *= 0xbf58476d1ce4e5b9ULL;	/* splitmix64's finalizer */
+    x ^= x >> 27; x *= 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+}
 
 SSETDICT *SSetDictAlloc(int n)
 {
-    int i;
     SSETDICT *ssd = Calloc(sizeof(SSETDICT), 1);
+    unsigned long size = SSETDICT_MIN;
     assert(n>=1);
-    ssd->nCols = n;
-    ssd->nElem = 0;
-    for(i=0; i< NUM_HASHES; i++)
-	ssd->array[i] = Calloc(sizeof(SSET), ssd->nCols);
+    while(size/4*3 < (unsigned long)n) size *= 2;
+    ssd->mask = size - 1;
+    ssd->table = Calloc(sizeof(SSET), size);
+#ifdef __GLIBC__
+    pthread_rwlockattr_t attr;	/* a steady stream of adds mustn't keep out the one that needs to grow the table */
+    pthread_rwlockattr_init(&attr);
+    pthread_rwlockattr_setkind_np(&attr, PTHREAD_RWLOCK_PREFER_WRITER_NONRECURSIVE_NP);
+    pthread_rwlock_init(&ssd->lock, &attr);
+    pthread_rwlockattr_destroy(&attr);
+#else
+    pthread_rwlock_init(&ssd->lock, NULL);
+#endif
     return ssd;
 }
 
 /*
-** Finds a place for ss; if ss is in the dictionary, it returns a pointer
-** to ss's position; otherwise it returns a pointer to a blank position
+** Finds a place for ss in table; if ss is there, it returns a pointer to
+** ss's position; otherwise it returns a pointer to the blank position
 ** where ss can be put.
-** Returns NULL if the dictionary is full.
 */
-static SSET *SSetDict_find_place(SSETDICT *ssd, SSET ss)
+static SSET *SSetDict_find_place(SSET *table, unsigned long mask, SSET ss)
 {
-    int position = ss % ssd->nCols, col;
+    unsigned long col;
     assert(ss != SSET_NULLSET);
+    for(col = SSetHash(ss) & mask; table[col] != ss && table[col] != SSET_NULLSET; col = (col+1) & mask)
+	;
+    return table + col;
+}
 
-    for(col=position; col != (position+ssd->nCols-1) % ssd->nCols; col = (col+1) % ssd->nCols)
+/* Move a few more slots of the old table, or all of them; free it when done */
+static void SSetDictMove(SSETDICT *ssd, unsigned long slots)
+{
+    unsigned long end = MIN(ssd->moved + slots, ssd->oldMask + 1);
+    for(; ssd->moved < end; ssd->moved++)
     {
-	int itable;
-	for(itable=0; itable<NUM_HASHES; itable++)
-	{
-	    SSET *place = &(ssd->array[itable][col]);
-	    if(*place == ss || *place == SSET_NULLSET)
-		return place;
-	}
+	SSET ss = ssd->old[ssd->moved];
+	if(ss != SSET_NULLSET)
+	    *SSetDict_find_place(ssd->table, ssd->mask, ss) = ss; /* it's not there yet: Add checks both tables */
+    }
+    if(ssd->moved > ssd->oldMask)
+    {
+	Free(ssd->old);
+	ssd->old = NULL;
     }
-
-    return NULL;
 }
 
-
 /* Double the size of the dictionary */
-static SSETDICT *SSetDictDouble(SSETDICT *ssd)
+static void SSetDictGrow(SSETDICT *ssd)
 {
-    int col, itable, nAdded = 0;
-    SSETDICT *newDict = SSetDictAlloc(2*ssd->nCols);
+    if(ssd->old) SSetDictMove(ssd, ssd->oldMask + 1);
+    ssd->old = ssd->table;
+    ssd->oldMask = ssd->mask;
+    ssd->moved = 0;
+    ssd->mask = 2*ssd->mask + 1;
+    ssd->table = Calloc(sizeof(SSET), ssd->mask + 1);
+    if(ssd->concurrent) SSetDictMove(ssd, ssd->oldMask + 1);
+}
 
-    for(itable=0; itable<NUM_HASHES; itable++)
+/*
+** Each add first reserves room by counting itself in nElem (and gives it
+** back if ss turns out to be there already), so the table can never be
+** more than 3/4 full however many threads are adding, and a probe always
+** ends within mask+1 slots.  An add that can't reserve room grows the
+** table first, under the write lock.
+*/
+static Boolean SSetDictAddConcurrent(SSETDICT *ssd, SSET ss)
+{
+    unsigned long col, probes;
+    Boolean added = false;
+    pthread_rwlock_rdlock(&ssd->lock);
+    while(__atomic_add_fetch(&ssd->nElem, 1, __ATOMIC_RELAXED) > ssd->mask/4*3)
     {
-	for(col=0; col < ssd->nCols; col++)
-	    if(ssd->array[itable][col])
-	    {
-		SSetDictAdd(newDict, ssd->array[itable][col]);
-		++nAdded;
-	    }
-	Free(ssd->array[itable]);
-	ssd->array[itable] = newDict->array[itable];
+	__atomic_sub_fetch(&ssd->nElem, 1, __ATOMIC_RELAXED);
+	pthread_rwlock_unlock(&ssd->lock);
+	pthread_rwlock_wrlock(&ssd->lock);
+	if(ssd->nElem + 1 > ssd->mask/4*3) SSetDictGrow(ssd); /* unless another thread got here first */
+	pthread_rwlock_unlock(&ssd->lock);
+	pthread_rwlock_rdlock(&ssd->lock);
     }
-    assert(nAdded == ssd->nElem);
-
-    ssd->nCols = newDict->nCols;
-    Free(newDict);
-
-    return ssd;
+    for(col = SSetHash(ss) & ssd->mask, probes = 0; probes <= ssd->mask; col = (col+1) & ssd->mask, probes++)
+    {
+	SSET cur = __atomic_load_n(&ssd->table[col], __ATOMIC_ACQUIRE);
+	if(cur == SSET_NULLSET &&
+	    __atomic_compare_exchange_n(&ssd->table[col], &cur, ss, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+	{
+	    added = true;
+	    break;
+	}
+	if(cur == ss) break; /* it was already there, or another thread just beat us to it */
+    }
+    assert(probes <= ssd->mask);
+    if(!added) __atomic_sub_fetch(&ssd->nElem, 1, __ATOMIC_RELAXED);
+    pthread_rwlock_unlock(&ssd->lock);
+    return added;
 }
 
-
 SSETDICT *SSetDictAdd(SSETDICT *ssd, SSET ss)
 {
     SSET *place;
 
     if(ss == SSET_NULLSET)
     {
-	ssd->containsNull = true;
+	__atomic_store_n(&ssd->containsNull, true, __ATOMIC_RELAXED); /* concurrent adds may do this at once */
 	return ssd;
     }
 
-    if(ssd->nElem == ssd->nCols)
-	SSetDictDouble(ssd);
-
-    place = SSetDict_find_place(ssd, ss);
-
-    assert(place);
+    if(ssd->concurrent)
+    {
+	SSetDictAddConcurrent(ssd, ss);
+	return ssd;
+    }
 
-    if(*place != ss)
+    place = SSetDict_find_place(ssd->table, ssd->mask, ss);
+    if(*place == ss)
+	return ssd;
+    if(ssd->old)
     {
-	assert(*place == SSET_NULLSET);
-	ssd->nElem++;
-	*place = ss;	/* it's either already ss or NULLSET; assign it either way */
+	if(*SSetDict_find_place(ssd->old, ssd->oldMask, ss) == ss)
+	    return ssd;
+	SSetDictMove(ssd, SSETDICT_MOVES);
+	place = SSetDict_find_place(ssd->table, ssd->mask, ss); /* something may have moved into it */
     }
 
+    *place = ss;
+    if(++ssd->nElem > ssd->mask/4*3)
+	SSetDictGrow(ssd);
+
     return ssd;
 }
 
 Boolean SSetDictIn(SSETDICT *ssd, SSET ss)
 {
-    SSET *place;
+    unsigned long col, probes;
+    Boolean in = false;
     if(ss == SSET_NULLSET)
-	return ssd->containsNull;
-    place = SSetDict_find_place(ssd, ss);
-    if(place && *place == ss)
+	return __atomic_load_n(&ssd->containsNull, __ATOMIC_RELAXED);
+    if(ssd->concurrent)
+    {
+	pthread_rwlock_rdlock(&ssd->lock);
+	for(col = SSetHash(ss) & ssd->mask, probes = 0; probes <= ssd->mask; col = (col+1) & ssd->mask, probes++)
+	{
+	    SSET cur = __atomic_load_n(&ssd->table[col], __ATOMIC_ACQUIRE);
+	    if(cur == ss || cur == SSET_NULLSET) { in = (cur == ss); break; }
+	}
+	pthread_rwlock_unlock(&ssd->lock);
+	return in;
+    }
+    if(*SSetDict_find_place(ssd->table, ssd->mask, ss) == ss)
 	return true;
-    else
-	return false;
+    return ssd->old && *SSetDict_find_place(ssd->old, ssd->oldMask, ss) == ss;
+}
+
+unsigned long SSetDictSize(SSETDICT *ssd)
+{
+    return ssd->nElem + ssd->containsNull;
+}
+
+void SSetDictConcurrent(SSETDICT *ssd, Boolean on)
+{
+#if SMALL_SET_SIZE == 128
+    if(on) Fatal("SSetDictConcurrent: needs a 64-bit SSET");
+#endif
+    if(on && ssd->old) SSetDictMove(ssd, ssd->oldMask + 1); /* concurrent mode grows all at once */
+    ssd->concurrent = on;
 }
 
 void SSetDictFree(SSETDICT *ssd)
 {
-    int i;
-    for(i=0; i<NUM_HASHES; i++)
-	Free(ssd->array[i]);
+    pthread_rwlock_destroy(&ssd->lock);
+    if(ssd->old) Free(ssd->old);
+    Free(ssd->table);
     Free(ssd);
 }
 
@@ -1,6 +1,8 @@
 // This software is part of github.com/waynebhayes/libwayne, and is Copyright(C) Wayne B. Hayes 2025, under the GNU LGPL 3.0
 // (GNU Lesser General Public License, version 3, 2007), a copy of which is contained at the top of the repo.
+#include <pthread.h>
 #include "sim_anneal.h"
+#include "rand48.h"
 
 SIM_ANNEAL *SimAnnealAlloc(double direction, foint initSol, pMoveFunc Move, pScoreFunc Score, pAcceptFunc Accept,
     unsigned long maxIters, double pBadStart, double pBadEnd, pReportFunc Report) {
@@ -22,6 +24,10 @@ SIM_ANNEAL *SimAnnealAlloc(double direction, foint initSol, pMoveFunc Move, pSco
     sa->currentScore = Score(true, initSol);
     sa->pBadStart = pBadStart ? pBadStart : 0.99;
     sa->pBadEnd = pBadEnd ? pBadEnd : 1e-8;
+    sa->tScale = 1;
+    // seeded from the global stream, so srand48() still makes runs reproducible
+    int i;
+    for(i=0;i<3;i++) sa->rng[i] = lrand48();
     return sa;
 }
 
@@ -65,7 +71,7 @@ static void Iteration(SIM_ANNEAL *sa) {
     else {
 	pBad = exp(-fabs(delta) / sa->temperature);
 	PbadRecord(sa, pBad);
-	accept = (drand48() < pBad);
+	accept = (erand48(sa->rng) < pBad);
     }
     //Note("Iter: score %g (%g) T %g pB %g\n", sa->currentScore, delta, sa->temperature, pBad);
     accept = sa->Accept(accept, sa->currentSolution);
@@ -96,7 +102,9 @@ Boolean SimAnnealSetSchedule(SIM_ANNEAL *sa, double tInitial, double tDecay) {
     return true;
 }
 
-void SimAnnealAutoSchedule(SIM_ANNEAL *sa) {
+// The original schedule finder: bisect on temperature, running (and accepting) real moves at each probe until
+// the mean pBad settles. Slow, and it changes the solution, but it needs nothing from the score landscape.
+static void ProbeSchedule(SIM_ANNEAL *sa) {
     double tEnd = 1;
     while (findPbad(sa, tEnd) > sa->pBadEnd) tEnd /= 2;
     while (findPbad(sa, tEnd) < sa->pBadEnd) tEnd *= 1.2;
@@ -109,6 +117,82 @@ void SimAnnealAutoSchedule(SIM_ANNEAL *sa) {
     Note("tInitial %g tDecay %g", tInitial, sa->tDecay);
 }
 
+// Mean pBad at temperature T over the sampled bad-move magnitudes; monotone increasing in T.
+static double SampledPbad(const double *bad, int n, double T) {
+    double sum=0;
+    int i;
+    for(i=0;i<n;i++) sum += exp(-bad[i]/T);
+    return sum/n;
+}
+
+// Solve SampledPbad(T) == pBad by bisection on log(T); no moves are made, so this is cheap.
+static double SampledTemperature(const double *bad, int n, double pBad) {
+    double lo = log(bad[0]), hi = lo, mid;
+    int i;
+    for(i=1;i<n;i++) { if(log(bad[i]) < lo) lo = log(bad[i]); if(log(bad[i]) > hi) hi = log(bad[i]); }
+    // exp(-d/T) >= pBad for every d iff T >= dMax/-log(pBad), and <= pBad for every d iff T <= dMin/-log(pBad)
+    lo -= log(-log(pBad)) + 1; hi -= log(-log(pBad)) - 1;
+    for(i=0;i<100 && hi-lo > 1e-12;i++) {
+	mid = (lo+hi)/2;
+	if(SampledPbad(bad, n, exp(mid)) < pBad) lo = mid; else hi = mid;
+    }
+    return exp((lo+hi)/2);
+}
+
+// Propose numSamples moves, rejecting every one, and keep the magnitudes of the bad ones. Since the mean pBad at
+// temperature T is just the mean of exp(-|delta|/T) over bad moves, tInitial and tEnd then follow directly from
+// pBadStart and pBadEnd without running the annealer. Returns false (leaving the schedule alone) if no bad
+// moves were seen.
+Boolean SimAnnealSampleSchedule(SIM_ANNEAL *sa, int numSamples) {
+    double *bad = Malloc(numSamples * sizeof(double));
+    int i, n=0;
+    for(i=0;i<numSamples;i++) {
+	double delta = sa->Move(sa->currentSolution);
+	if(sa->direction*delta < 0) bad[n++] = fabs(delta);
+	sa->Accept(false, sa->currentSolution);
+    }
+    if(n == 0) { Free(bad); return false; }
+    double tInitial = SampledTemperature(bad, n, sa->pBadStart);
+    double tEnd = SampledTemperature(bad, n, sa->pBadEnd);
+    Free(bad);
+    sa->tInitial = tInitial;
+    sa->tDecay = -log(tEnd / tInitial);
+    Note("tInitial %g tDecay %g (from %d bad moves in %d samples)", tInitial, sa->tDecay, n, numSamples);
+    return true;
+}
+
+#define SCHEDULE_SAMPLES 10000
+
+void SimAnnealAutoSchedule(SIM_ANNEAL *sa) {
+    if(!SimAnnealSampleSchedule(sa, SCHEDULE_SAMPLES)) {
+	Warning("SimAnnealAutoSchedule: no bad moves in %d samples; falling back to probing", SCHEDULE_SAMPLES);
+	ProbeSchedule(sa);
+    }
+}
+
+void SimAnnealSetAdaptive(SIM_ANNEAL *sa, Boolean adaptive) {
+    sa->adaptive = adaptive;
+    sa->tScale = 1;
+}
+
+// pBad we'd like at this point of the run: log-linear from pBadStart to pBadEnd, as an exponential schedule
+// gives on a landscape whose bad moves all have the same size.
+static double PbadTarget(SIM_ANNEAL *sa) {
+    double fraction = 1.0*sa->iter / sa->maxIters;
+    return sa->pBadStart * pow(sa->pBadEnd / sa->pBadStart, fraction);
+}
+
+// Nudge tScale so the observed pBad tracks PbadTarget(). Since log(pBad) ~ -|delta|/T, a relative change in T
+// moves log(pBad) by about -log(pBad) times as much; we take half that Newton step, clamped, to damp the
+// buffer's lag.
+static void AdaptTemperature(SIM_ANNEAL *sa) {
+    double mean = PbadMean(sa), target = PbadTarget(sa);
+    if(sa->pBadBufLen < PBAD_CIRC_BUF/10 || mean <= 0 || mean >= 1) return;
+    double step = 0.5 * (log(target) - log(mean)) / -log(mean);
+    if(step > 0.5) step = 0.5;
+    if(step < -0.5) step = -0.5;
+    sa->tScale *= exp(step);
+}
 
 // returns >0 if success, 0 if not done and can continue, <0 if error
 int SimAnnealRun(SIM_ANNEAL *sa) {
@@ -117,10 +201,13 @@ int SimAnnealRun(SIM_ANNEAL *sa) {
     sa->currentScore = sa->Score(true, sa->currentSolution);
     for(sa->iter = 0; sa->iter < sa->maxIters; sa->iter++) {
 	SetIterTemperature(sa);
+	if(sa->adaptive) {
+	    if(sa->iter % (PBAD_CIRC_BUF/4) == 0) AdaptTemperature(sa);
+	    sa->temperature *= sa->tScale;
+	}
 	Iteration(sa);
-	static int prevPctDone;
 	int pctDone = 100.0*sa->iter/sa->maxIters;
-	if(pctDone > prevPctDone) {
+	if(pctDone > sa->prevPctDone) {
 	    printf("%d%% T %g pBad %g ", pctDone, sa->temperature, PbadMean(sa));
 	    if(sa->Report) sa->Report(sa->iter, sa->currentSolution);
 	    puts("");
@@ -134,7 +221,7 @@ int SimAnnealRun(SIM_ANNEAL *sa) {
 		}
 	    }
 	    sa->currentScore=realScore;
-	    prevPctDone=pctDone;
+	    sa->prevPctDone=pctDone;
 
 	}
     }
@@ -148,6 +235,169 @@ void SimAnnealFree(SIM_ANNEAL *sa) {
     Free(sa);
 }
 
+
+// Parallel tempering
+
+// pthread_barrier_t isn't available everywhere (eg. MacOS), so here's a minimal one.
+typedef struct _pt_barrier {
+    pthread_mutex_t lock;
+    pthread_cond_t cv;
+    int parties, waiting;
+    unsigned long generation;
+} PT_BARRIER;
+
+static void BarrierWait(PT_BARRIER *b) {
+    pthread_mutex_lock(&b->lock);
+    unsigned long gen = b->generation;
+    if(++b->waiting == b->parties) {
+	b->waiting = 0;
+	b->generation++;
+	pthread_cond_broadcast(&b->cv);
+    }
+    else while(gen == b->generation) pthread_cond_wait(&b->cv, &b->lock);
+    pthread_mutex_unlock(&b->lock);
+}
+
+SIM_ANNEAL_PT *SimAnnealPTAlloc(double direction, int numReplicas, foint solutions[], foint best, pCopyFunc Copy,
+    pMoveFunc Move, pScoreFunc Score, pAcceptFunc Accept, unsigned long itersPerReplica, unsigned long swapInterval,
+    pReportFunc Report) {
+    int i, r;
+    if(numReplicas < 1) Fatal("SimAnnealPTAlloc: need at least one replica");
+    if(!Copy) Fatal("SimAnnealPTAlloc: need a Copy function to record the best solution");
+    SIM_ANNEAL_PT *pt = Calloc(sizeof(SIM_ANNEAL_PT),1);
+    pt->numReplicas = numReplicas;
+    pt->itersPerReplica = itersPerReplica;
+    pt->swapInterval = swapInterval ? swapInterval : 1000;
+    pt->Copy = Copy;
+    pt->Report = Report;
+    pt->replica = Calloc(numReplicas, sizeof(SIM_ANNEAL*));
+    for(r=0; r<numReplicas; r++)
+	pt->replica[r] = SimAnnealAlloc(direction, solutions[r], Move, Score, Accept, itersPerReplica, 0,0, NULL);
+    pt->direction = pt->replica[0]->direction;
+    for(i=0;i<3;i++) pt->rng[i] = lrand48();
+    pt->best = best;
+    pt->bestScore = pt->replica[0]->currentScore;
+    Copy(best, solutions[0]);
+    return pt;
+}
+
+Boolean SimAnnealPTSetLadder(SIM_ANNEAL_PT *pt, double tMin, double tMax) {
+    int r, R = pt->numReplicas;
+    if(tMin <= 0 || tMax < tMin) return false;
+    for(r=0; r<R; r++) {
+	SIM_ANNEAL *sa = pt->replica[r];
+	sa->temperature = sa->tInitial = (R == 1 ? tMin : tMin * pow(tMax/tMin, (double)r/(R-1)));
+	sa->tDecay = 0;
+    }
+    return true;
+}
+
+void SimAnnealPTAutoLadder(SIM_ANNEAL_PT *pt) {
+    SIM_ANNEAL *sa = pt->replica[0];
+    SimAnnealAutoSchedule(sa); // only proposes moves on replica 0's solution, unless it has to fall back to probing
+    sa->currentScore = sa->Score(true, sa->currentSolution);
+    SimAnnealPTSetLadder(pt, sa->tInitial * exp(-sa->tDecay), sa->tInitial);
+}
+
+static void PTRecordBest(SIM_ANNEAL_PT *pt) {
+    int r;
+    for(r=0; r<pt->numReplicas; r++) {
+	SIM_ANNEAL *sa = pt->replica[r];
+	if(pt->direction * (sa->currentScore - pt->bestScore) > 0) {
+	    pt->bestScore = sa->currentScore;
+	    pt->Copy(pt->best, sa->currentSolution);
+	}
+    }
+}
+
+// Called by one thread while all the others wait: record the best solution, then offer each neighboring pair
+// (alternating even and odd pairs between rounds) a swap with probability min(1, exp((1/T_i-1/T_j)(E_i-E_j))),
+// where energy E = -direction*score.
+static void PTExchange(SIM_ANNEAL_PT *pt, unsigned long round) {
+    int r;
+    PTRecordBest(pt);
+    for(r = round % 2; r+1 < pt->numReplicas; r += 2) {
+	SIM_ANNEAL *a = pt->replica[r], *b = pt->replica[r+1];
+	double Ea = -pt->direction * a->currentScore, Eb = -pt->direction * b->currentScore;
+	double x = (1/a->temperature - 1/b->temperature) * (Ea - Eb);
+	pt->swapsTried++;
+	if(x >= 0 || erand48(pt->rng) < exp(x)) {
+	    foint sol = a->currentSolution; a->currentSolution = b->currentSolution; b->currentSolution = sol;
+	    double score = a->currentScore; a->currentScore = b->currentScore; b->currentScore = score;
+	    pt->swapsAccepted++;
+	}
+    }
+}
+
+typedef struct _pt_worker {
+    SIM_ANNEAL_PT *pt;
+    PT_BARRIER *barrier;
+    int r;
+} PT_WORKER;
+
+static void *PTWorker(void *arg) {
+    PT_WORKER *w = arg;
+    SIM_ANNEAL_PT *pt = w->pt;
+    SIM_ANNEAL *sa = pt->replica[w->r];
+    unsigned long round, done = 0;
+    for(round = 0; done < pt->itersPerReplica; round++) {
+	unsigned long i, n = MIN(pt->swapInterval, pt->itersPerReplica - done);
+	for(i=0; i<n; i++) Iteration(sa);
+	done += n;
+	BarrierWait(w->barrier);
+	if(w->r == 0) {
+	    PTExchange(pt, round);
+	    int pctDone = 100.0*done/pt->itersPerReplica;
+	    if(pctDone > pt->prevPctDone) {
+		int r;
+		for(r=0; r<pt->numReplicas; r++) // resynchronize incremental scores, as SimAnnealRun does
+		    pt->replica[r]->currentScore = pt->replica[r]->Score(true, pt->replica[r]->currentSolution);
+		printf("%d%% best %g swaps %g%% ", pctDone, pt->bestScore, 100.0*pt->swapsAccepted/MAX(1,pt->swapsTried));
+		if(pt->Report) pt->Report(done, pt->best);
+		puts("");
+		pt->prevPctDone = pctDone;
+	    }
+	}
+	BarrierWait(w->barrier);
+    }
+    return NULL;
+}
+
+int SimAnnealPTRun(SIM_ANNEAL_PT *pt) {
+    int r, R = pt->numReplicas;
+    if(pt->replica[0]->temperature <= 0) SimAnnealPTAutoLadder(pt);
+    PT_BARRIER barrier;
+    pthread_mutex_init(&barrier.lock, NULL);
+    pthread_cond_init(&barrier.cv, NULL);
+    barrier.parties = R;
+    barrier.waiting = 0;
+    barrier.generation = 0;
+    PT_WORKER w[R];
+    pthread_t tid[R];
+    for(r=0; r<R; r++) {
+	w[r].pt = pt; w[r].barrier = &barrier; w[r].r = r;
+	if(r > 0 && pthread_create(&tid[r], NULL, PTWorker, &w[r]) != 0) Fatal("SimAnnealPTRun: can't create thread %d", r);
+    }
+    PTWorker(&w[0]);
+    for(r=1; r<R; r++) pthread_join(tid[r], NULL);
+    PTRecordBest(pt);
+    pthread_cond_destroy(&barrier.cv);
+    pthread_mutex_destroy(&barrier.lock);
+    return 1;
+}
+
+foint SimAnnealPTBest(SIM_ANNEAL_PT *pt, double *score) {
+    if(score) *score = pt->bestScore;
+    return pt->best;
+}
+
+void SimAnnealPTFree(SIM_ANNEAL_PT *pt) {
+    int r;
+    for(r=0; r<pt->numReplicas; r++) SimAnnealFree(pt->replica[r]);
+    Free(pt->replica);
+    Free(pt);
+}
+
 #ifdef __cplusplus
 } // end extern "C"
 #endif
@@ -21,6 +21,7 @@ extern "C" {
 #include <string.h>
 #include <time.h>
 #include <unistd.h>
+#include <pthread.h>
 
 #define TEST_SORTS 0
 int _compareCount;
@@ -110,7 +111,7 @@ int TempMergeCmp(const foint X, const foint Y)
 // Returns the number of things merged.
 int PileMergeTemps(int *dest, int nMerge, int mergeSeparator[nMerge+1], int *tempMerge)
 {
-    int mergePosition[nMerge];
+    int *mergePosition = Malloc(nMerge * sizeof(int));
     int i, n=0;
 
     _tempMerge = tempMerge;
@@ -130,6 +131,7 @@ int PileMergeTemps(int *dest, int nMerge, int mergeSeparator[nMerge+1], int *tem
 	if(mergePosition[which] < mergeSeparator[which+1]) HeapInsert(heap, (foint)which);
     }
     HeapFree(heap);
+    Free(mergePosition);
     return n;
 }
 
@@ -142,14 +144,16 @@ int PileSortInts(int *a, size_t n)	// for now only sort ints, because you need a
     int p, i;
     int numPiles = (log(n))+1, pileSize=(n/numPiles), nextFreePile=0;
     //int numPiles = log(n)/log(2)+1, pileSize=numPiles, nextFreePile=0;
-    int tempMerge[n], mergeSeparator[n], nMerge=0; // probably way too many merge separators
+    // these used to be on the stack, which overflowed beyond a few million ints
+    int *tempMerge = Malloc(n*sizeof(int)), *mergeSeparator = Malloc((n+1)*sizeof(int)), nMerge=0; // probably way too many merge separators
     PILE pile[numPiles];
+    int *pileSpace = Malloc(numPiles * pileSize * sizeof(int));
     mergeSeparator[0]=0;
 
     // initialize the piles
     for(p=0; p<numPiles; p++)
     {
-	pile[p].a = alloca(pileSize * sizeof(pile[0].a[0])); // it's OK not to initialize bottom and top.
+	pile[p].a = pileSpace + p*pileSize; // it's OK not to initialize bottom and top.
     }
 #define UINT_INFINITY ((unsigned int)(-1))
 #define INT_INFINITY (UINT_INFINITY/2)
@@ -231,6 +235,7 @@ int PileSortInts(int *a, size_t n)	// for now only sort ints, because you need a
     // At this point, all the piles should be sorted, now it's time to merge them all together.
     nItems = PileMergeTemps(a, nMerge, mergeSeparator, tempMerge);
     assert(nItems == n);
+    Free(pileSpace); Free(mergeSeparator); Free(tempMerge);
     return 0;
 }
 
@@ -668,6 +673,235 @@ int FredSort(void *a, size_t n, size_t w, pfnCmpFcn compare)
 }
 #endif	/* FREDERICKS */
 
+/*
+** Radix sorts. The keys are accessed through these may_alias types so that RadixSortFloat and RadixSortDouble
+** can sort the bits of a float or double array in place without breaking C's aliasing rules.
+*/
+typedef uint32_t __attribute__((__may_alias__)) RADIX32;
+typedef uint64_t __attribute__((__may_alias__)) RADIX64;
+
+#define RADIX_SMALL 256 // below this, a comparison sort beats setting up the histograms
+
+#define RADIX_LESS(x,y) ((x)<(y))
+SORT_INLINE_DEFINE(SmallSort32, RADIX32, RADIX_LESS)
+SORT_INLINE_DEFINE(SmallSort64, RADIX64, RADIX_LESS)
+
+/*
+** LSD radix sort of key[0..n-1], moving payload[] (if not NULL) along with it. Counts every byte's histogram
+** in one pass, then does one stable scatter per byte, skipping bytes on which all the keys agree.
+*/
+#define RADIX_LSD_DEFINE(name, KEY) \
+static void name(KEY *key, KEY *payload, size_t n) \
+{ \
+    enum { BYTES = sizeof(KEY) }; \
+    size_t count[BYTES][256], i; \
+    int d; \
+    if(n < 2) return; /* (and the skip below reads key[0]) */ \
+    if(!payload && n < RADIX_SMALL) { name##Small(key, n); return; } \
+    memset(count, 0, sizeof(count)); \
+    for(i=0; i<n; i++) for(d=0; d<BYTES; d++) count[d][(key[i] >> 8*d) & 255]++; \
+    KEY *src = key, *dst = Malloc(n*sizeof(KEY)), *vsrc = payload, *vdst = payload ? Malloc(n*sizeof(KEY)) : NULL; \
+    KEY *kbuf = dst, *vbuf = vdst; \
+    for(d=0; d<BYTES; d++) { \
+	size_t pos[256], sum = 0; \
+	int b; \
+	if(count[d][(key[0] >> 8*d) & 255] == n) continue; /* every key has the same byte d */ \
+	for(b=0; b<256; b++) { pos[b] = sum; sum += count[d][b]; } \
+	if(payload) for(i=0; i<n; i++) { size_t p = pos[(src[i] >> 8*d) & 255]++; dst[p] = src[i]; vdst[p] = vsrc[i]; } \
+	else for(i=0; i<n; i++) dst[pos[(src[i] >> 8*d) & 255]++] = src[i]; \
+	KEY *t = src; src = dst; dst = t; \
+	t = vsrc; vsrc = vdst; vdst = t; \
+    } \
+    if(src != key) { \
+	memcpy(key, src, n*sizeof(KEY)); \
+	if(payload) memcpy(payload, vsrc, n*sizeof(KEY)); \
+    } \
+    Free(kbuf); \
+    if(vbuf) Free(vbuf); \
+}
+
+#define RadixLsd32Small SmallSort32
+#define RadixLsd64Small SmallSort64
+RADIX_LSD_DEFINE(RadixLsd32, RADIX32)
+RADIX_LSD_DEFINE(RadixLsd64, RADIX64)
+
+/*
+** MSD radix sort in place (American flag sort): count the buckets of the top byte, cycle each key directly
+** into its bucket, then recurse into each bucket on the next byte.
+*/
+#define RADIX_MSD_DEFINE(name, KEY) \
+static void name(KEY *a, size_t n, int shift) \
+{ \
+    for(;;) { \
+	size_t count[256] = {0}, start[256], end[256], i, sum = 0; \
+	int b; \
+	if(n < RADIX_SMALL) { name##Small(a, n); return; } \
+	for(i=0; i<n; i++) count[(a[i] >> shift) & 255]++; \
+	if(count[(a[0] >> shift) & 255] == n) { /* all in one bucket: go straight to the next byte */ \
+	    if(shift == 0) return; \
+	    shift -= 8; \
+	    continue; \
+	} \
+	for(b=0; b<256; b++) { start[b] = sum; sum += count[b]; end[b] = sum; } \
+	for(b=0; b<256; b++) \
+	    while(start[b] < end[b]) { \
+		KEY x = a[start[b]]; \
+		int dig; \
+		while((dig = (x >> shift) & 255) != b) { KEY t = a[start[dig]]; a[start[dig]++] = x; x = t; } \
+		a[start[b]++] = x; \
+	    } \
+	if(shift > 0) for(b=0, sum=0; b<256; sum += count[b++]) \
+	    if(count[b] > 1) name(a + sum, count[b], shift-8); \
+	return; \
+    } \
+}
+
+#define RadixMsd32Small SmallSort32
+#define RadixMsd64Small SmallSort64
+RADIX_MSD_DEFINE(RadixMsd32, RADIX32)
+RADIX_MSD_DEFINE(RadixMsd64, RADIX64)
+
+void RadixSortU32(uint32_t *a, size_t n) { RadixLsd32(a, NULL, n); }
+void RadixSortU64(uint64_t *a, size_t n) { RadixLsd64(a, NULL, n); }
+void RadixSortU32Pairs(uint32_t *key, uint32_t *payload, size_t n) { RadixLsd32(key, payload, n); }
+void RadixSortU64Pairs(uint64_t *key, uint64_t *payload, size_t n) { RadixLsd64(key, payload, n); }
+void RadixSortInPlaceU32(uint32_t *a, size_t n) { if(n > 1) RadixMsd32(a, n, 24); }
+void RadixSortInPlaceU64(uint64_t *a, size_t n) { if(n > 1) RadixMsd64(a, n, 56); }
+
+/*
+** IEEE floats order like sign-magnitude integers: flipping the sign bit of positive numbers, and every bit of
+** negative ones, makes them order like unsigned integers.
+*/
+void RadixSortFloat(float *a, size_t n)
+{
+    RADIX32 *k = (RADIX32*)a;
+    size_t i;
+    for(i=0; i<n; i++) k[i] ^= (k[i] >> 31) ? 0xFFFFFFFFu : 0x80000000u;
+    RadixLsd32(k, NULL, n);
+    for(i=0; i<n; i++) k[i] ^= (k[i] >> 31) ? 0x80000000u : 0xFFFFFFFFu;
+}
+
+void RadixSortDouble(double *a, size_t n)
+{
+    RADIX64 *k = (RADIX64*)a;
+    size_t i;
+    for(i=0; i<n; i++) k[i] ^= (k[i] >> 63) ? ~(uint64_t)0 : (uint64_t)1 << 63;
+    RadixLsd64(k, NULL, n);
+    for(i=0; i<n; i++) k[i] ^= (k[i] >> 63) ? (uint64_t)1 << 63 : ~(uint64_t)0;
+}
+
+
+/*
+** Parallel sample sort for anything with a comparator. Sort an oversampled set of elements to pick
+** SAMPLE_BUCKETS-1 splitters, then each thread finds the bucket of every element in its chunk (by binary
+** search among the splitters), the chunks are scattered into their buckets in a scratch array, and the
+** buckets are qsorted in parallel and copied back. Only uses threads if there are several CPUs and n is big.
+*/
+#define PARALLEL_SORT_MIN 65536	// below this it's not worth starting threads
+#define SAMPLES_PER_BUCKET 32
+#define MAX_SORT_THREADS 64
+
+typedef struct {
+    char *a, *tmp, *splitters;
+    size_t n, w;
+    pfnCmpFcn compare;
+    int numThreads, numBuckets, nextBucket, phase;
+    unsigned char *bucketOf;	// numBuckets <= 256
+    size_t count[MAX_SORT_THREADS][256];	// per thread and bucket: first the counts, then where to scatter to
+    size_t bucketStart[257];
+} SAMPLE_SORT;
+
+typedef struct { SAMPLE_SORT *s; int t; } SAMPLE_SORT_THREAD;
+
+static void *SampleSortThread(void *arg)
+{
+    SAMPLE_SORT *s = ((SAMPLE_SORT_THREAD*)arg)->s;
+    const int t = ((SAMPLE_SORT_THREAD*)arg)->t;
+    const size_t w = s->w, lo = s->n * t / s->numThreads, hi = s->n * (t+1) / s->numThreads;
+    size_t i;
+    int b;
+
+    switch(s->phase) {
+    case 0: // which bucket does each element of my chunk go in? The first splitter not less than it.
+	for(i=lo; i<hi; i++) {
+	    int l = 0, h = s->numBuckets-1;
+	    while(l < h) {
+		int mid = (l+h)/2;
+		if(s->compare(s->a + i*w, s->splitters + mid*w) <= 0) h = mid;
+		else l = mid+1;
+	    }
+	    s->bucketOf[i] = l;
+	    s->count[t][l]++;
+	}
+	break;
+    case 1: // scatter my chunk into the buckets
+	for(i=lo; i<hi; i++) memcpy(s->tmp + (s->count[t][s->bucketOf[i]]++)*w, s->a + i*w, w);
+	break;
+    case 2: // take buckets until there are none left; sort each and put it back
+	while((b = __sync_fetch_and_add(&s->nextBucket, 1)) < s->numBuckets) {
+	    size_t start = s->bucketStart[b], size = s->bucketStart[b+1] - start;
+	    qsort(s->tmp + start*w, size, w, s->compare);
+	    memcpy(s->a + start*w, s->tmp + start*w, size*w);
+	}
+	break;
+    }
+    return NULL;
+}
+
+static void SampleSortPhase(SAMPLE_SORT *s, int phase)
+{
+    pthread_t thread[MAX_SORT_THREADS];
+    SAMPLE_SORT_THREAD arg[MAX_SORT_THREADS];
+    int t;
+    s->phase = phase;
+    for(t=0; t<s->numThreads; t++) {
+	arg[t].s = s; arg[t].t = t;
+	if(pthread_create(&thread[t], NULL, SampleSortThread, &arg[t]) != 0) Fatal("ParallelSort: can't create thread");
+    }
+    for(t=0; t<s->numThreads; t++) pthread_join(thread[t], NULL);
+}
+
+int ParallelSortThreads; // 0 means one per CPU
+
+int ParallelSort(void *a, size_t n, size_t w, pfnCmpFcn compare)
+{
+    long numCPUs = ParallelSortThreads > 0 ? ParallelSortThreads : sysconf(_SC_NPROCESSORS_ONLN);
+    int numThreads = MIN(numCPUs, MAX_SORT_THREADS), t, b;
+    size_t i;
+    if(n < PARALLEL_SORT_MIN || numThreads < 2) return QuickSort(a, n, w, compare);
+
+    SAMPLE_SORT *s = Calloc(1, sizeof(SAMPLE_SORT));
+    s->a = a; s->n = n; s->w = w; s->compare = compare;
+    s->numThreads = numThreads;
+    s->numBuckets = MIN(4*numThreads, 256); // a few per thread so one big bucket doesn't hold everyone up
+
+    // splitters: every SAMPLES_PER_BUCKET'th of a sorted sample spread evenly through the array
+    size_t numSamples = s->numBuckets * SAMPLES_PER_BUCKET;
+    char *sample = Malloc(numSamples * w);
+    for(i=0; i<numSamples; i++) memcpy(sample + i*w, s->a + (i*n/numSamples + i%7)%n * w, w);
+    qsort(sample, numSamples, w, compare);
+    s->splitters = Malloc(s->numBuckets * w);
+    for(b=0; b<s->numBuckets-1; b++) memcpy(s->splitters + b*w, sample + (b+1)*SAMPLES_PER_BUCKET*w, w);
+    Free(sample);
+
+    s->bucketOf = Malloc(n);
+    s->tmp = Malloc(n*w);
+    SampleSortPhase(s, 0);
+    // bucket b, thread t scatters to the bucket's start plus what threads before t put there
+    size_t sum = 0;
+    for(b=0; b<s->numBuckets; b++) {
+	s->bucketStart[b] = sum;
+	for(t=0; t<numThreads; t++) { size_t c = s->count[t][b]; s->count[t][b] = sum; sum += c; }
+    }
+    s->bucketStart[s->numBuckets] = sum;
+    assert(sum == n);
+    SampleSortPhase(s, 1);
+    SampleSortPhase(s, 2);
+
+    Free(s->tmp); Free(s->bucketOf); Free(s->splitters); Free(s);
+    return 0;
+}
+
 /***************************   END OF LIBRARY SOURCE *******************/
 
 #if TEST_SORTS
@@ -719,9 +953,40 @@ void ElementDmp(const ELEMENT *x)
     printf("]");
 }
 
+static int CmpU32(const void *x, const void *y) { uint32_t a = *(uint32_t*)x, b = *(uint32_t*)y; return (a>b)-(a<b); }
+static int CmpU64(const void *x, const void *y) { uint64_t a = *(uint64_t*)x, b = *(uint64_t*)y; return (a>b)-(a<b); }
+static int CmpDbl(const void *x, const void *y) { double a = *(double*)x, b = *(double*)y; return (a>b)-(a<b); }
+#define U32_LESS(x,y) ((x)<(y))
+SORT_INLINE_DEFINE(InlineSortU32, uint32_t, U32_LESS)
+
+// qsort vs. the radix, inlined and parallel sorts on n random keys
+static void RadixBenchmark(size_t n)
+{
+    uint32_t *u = Malloc(n*sizeof(uint32_t)), *u2 = Malloc(n*sizeof(uint32_t)), *pay = Malloc(n*sizeof(uint32_t));
+    uint64_t *l = Malloc(n*sizeof(uint64_t)), *l2 = Malloc(n*sizeof(uint64_t));
+    double *d = Malloc(n*sizeof(double)), *d2 = Malloc(n*sizeof(double)), t;
+    size_t i;
+    for(i=0; i<n; i++) { u[i] = mrand48(); l[i] = (uint64_t)mrand48() << 32 ^ mrand48(); d[i] = drand48()-0.5; pay[i] = i; }
+#define BENCH(name, copy, sort) do { copy; t = uTime(); sort; printf("%-24s %8.3fs\n", name, uTime()-t); } while(0)
+    printf("%lu keys:\n", (unsigned long)n);
+    BENCH("qsort uint32", memcpy(u2, u, n*4), qsort(u2, n, 4, CmpU32));
+    BENCH("InlineSort uint32", memcpy(u2, u, n*4), InlineSortU32(u2, n));
+    BENCH("RadixSortU32", memcpy(u2, u, n*4), RadixSortU32(u2, n));
+    BENCH("RadixSortInPlaceU32", memcpy(u2, u, n*4), RadixSortInPlaceU32(u2, n));
+    BENCH("RadixSortU32Pairs", memcpy(u2, u, n*4), RadixSortU32Pairs(u2, pay, n));
+    BENCH("qsort uint64", memcpy(l2, l, n*8), qsort(l2, n, 8, CmpU64));
+    BENCH("ParallelSort uint64", memcpy(l2, l, n*8), ParallelSort(l2, n, 8, CmpU64));
+    BENCH("RadixSortU64", memcpy(l2, l, n*8), RadixSortU64(l2, n));
+    BENCH("qsort double", memcpy(d2, d, n*8), qsort(d2, n, 8, CmpDbl));
+    BENCH("RadixSortDouble", memcpy(d2, d, n*8), RadixSortDouble(d2, n));
+#undef BENCH
+    Free(u); Free(u2); Free(pay); Free(l); Free(l2); Free(d); Free(d2);
+}
+
 int main(void)
 {
     /*assert(NUM*ElementSize <= 16384*1024);*/
+    RadixBenchmark(10*1000*1000);
     srand48(time(0) + getpid());
     printf("NUM %d, ElementSize %lud\n", NUM, sizeof(ELEMENT));
 do
@@ -91,7 +91,7 @@ static STAT *DataSort(STAT *s)
 	for(i=1; i < s->n; i++) assert(s->allData[i-1] <= s->allData[i]);
 	return s;
     }
-    qsort(s->allData, s->n, sizeof(s->allData[0]), CmpDouble);
+    RadixSortDouble(s->allData, s->n);
     for(i=1;i < s->n; i++) assert(s->allData[i-1] <= s->allData[i]);
     s->dataSorted = true;
     return s;
@@ -0,0 +1,134 @@
+// This software is part of github.com/waynebhayes/libwayne, and is Copyright(C) Wayne B. Hayes 2025, under the GNU LGPL 3.0
+// (GNU Lesser General Public License, version 3, 2007), a copy of which is contained at the top of the repo.
+/*
+** Check ARENA: alignment, objects that don't overlap, mark and rewind, size classes, one arena per thread,
+** and Omalloc shared by all threads.  "arena-test -b" instead times small allocations from malloc and from arenas.
+*/
+#include <time.h>
+#include <pthread.h>
+#include "misc.h"
+#include "Oalloc.h"
+#include "rng.h"
+
+#define NUM 100000
+#define NUM_THREADS 4
+
+static ARENA *_mainArena;
+
+static double Now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + 1e-9*ts.tv_nsec;
+}
+
+// Fill NUM objects of random sizes, some big, with bytes that say which object they are, then check them all.
+static void FillAndCheck(ARENA *a, RNG *r, unsigned char **p, size_t *size)
+{
+    int i;
+    for(i=0; i<NUM; i++) {
+	size[i] = RngInt(r, 0, 99) ? RngInt(r, 1, 100) : RngInt(r, 1000, 100000);
+	p[i] = ArenaMalloc(a, size[i]);
+	assert(((uintptr_t)p[i] & (ARENA_ALIGN-1)) == 0);
+	memset(p[i], i & 0xff, size[i]);
+    }
+    for(i=0; i<NUM; i++) {
+	size_t j;
+	for(j=0; j<size[i]; j++) assert(p[i][j] == (i & 0xff));
+    }
+}
+
+static void *Thread(void *arg)
+{
+    RNG r;
+    int i, id = (int)(intptr_t)arg;
+    RngInit(&r, RNG_XOSHIRO, id);
+    ARENA *mine = ArenaThread();
+    assert(mine == ArenaThread() && mine != _mainArena);
+    for(i=0; i<10*NUM; i++) { // churn the size classes
+	int *q = ArenaMalloc(mine, sizeof(int));
+	*q = id;
+	assert(*q == id);
+	ArenaRelease(mine, q, sizeof(int));
+    }
+    int **obj = Malloc(NUM*sizeof(int*));
+    for(i=0; i<NUM; i++) { obj[i] = Omalloc(sizeof(int)); assert(*obj[i] == 0); *obj[i] = id*NUM + i; }
+    for(i=0; i<NUM; i++) assert(*obj[i] == id*NUM + i);
+    Free(obj);
+    if(id % 2) ArenaThreadFree(); // the others are freed when the thread exits
+    return NULL;
+}
+
+static void Benchmark(void)
+{
+    static void *p[NUM];
+    const int rounds = 100;
+    ARENA *a = ArenaAlloc(0, 0), *c = ArenaAlloc(0, ARENA_SIZE_CLASSES);
+    double t;
+    int round, i;
+    printf("%d rounds of %d 24-byte objects, freed all at once:\n", rounds, NUM);
+    t = Now();
+    for(round=0; round<rounds; round++) { for(i=0; i<NUM; i++) p[i] = malloc(24); for(i=0; i<NUM; i++) free(p[i]); }
+    printf("  malloc/free        %.3f s\n", Now()-t);
+    t = Now();
+    for(round=0; round<rounds; round++) { for(i=0; i<NUM; i++) p[i] = ArenaMalloc(a, 24); ArenaReset(a); }
+    printf("  arena/reset        %.3f s\n", Now()-t);
+    t = Now();
+    for(round=0; round<rounds; round++) { for(i=0; i<NUM; i++) p[i] = ArenaMalloc(c, 24); for(i=0; i<NUM; i++) ArenaRelease(c, p[i], 24); }
+    printf("  size-class/release %.3f s\n", Now()-t);
+    ArenaFree(a); ArenaFree(c);
+}
+
+int main(int argc, char *argv[])
+{
+    static unsigned char *p[NUM];
+    static size_t size[NUM];
+    RNG r;
+    int i;
+
+    if(argc > 1 && strcmp(argv[1], "-b") == 0) {
+	Benchmark();
+	return 0;
+    }
+
+    RngInit(&r, RNG_XOSHIRO, 1);
+    ARENA *a = ArenaAlloc(0, 0);
+    unsigned char *first = ArenaMalloc(a, 1);
+    ARENA_MARK mark = ArenaMark(a);
+    FillAndCheck(a, &r, p, size);
+    ArenaRewind(a, mark);
+    unsigned char *again = ArenaMalloc(a, 1);
+    assert(again == first + ARENA_ALIGN); // the next object after first, as if nothing had happened since the mark
+    FillAndCheck(a, &r, p, size); // on the kept chunks this time
+    char *s = ArenaStrdup(a, "hello"), *t = ArenaStrdup(a, "world");
+    assert(strcmp(s, "hello") == 0 && t == s + 6); // strings are packed
+    ArenaReset(a);
+    FillAndCheck(a, &r, p, size);
+    ArenaFree(a);
+    puts("objects are aligned, disjoint, and survive rewinding and resetting");
+
+    a = ArenaAlloc(0, 0); // fresh, so it has no chunk yet
+    void *z = ArenaMalloc(a, 0), *zc = ArenaCalloc(a, 0, sizeof(int)), *o = Omalloc(0), *oc = Ocalloc(0, sizeof(int));
+    assert(z && zc && z != zc && o && oc && o != oc);
+    ArenaFree(a);
+    puts("zero-byte objects are real, distinct pointers");
+
+    a = ArenaAlloc(0, ARENA_SIZE_CLASSES);
+    for(i=0; i<100; i++) p[i] = ArenaMalloc(a, 40);
+    for(i=0; i<100; i++) ArenaRelease(a, p[i], 40);
+    for(i=99; i>=0; i--) { void *q = ArenaMalloc(a, 33 + i%16); assert(q == p[i]); } // any size in the same class reuses them
+    unsigned char *big = ArenaMalloc(a, 1000);
+    ArenaRelease(a, big, 1000); // too big for a class: it stays put until the arena is reset
+    void *q = ArenaMalloc(a, 1000);
+    assert(q != big);
+    ArenaFree(a);
+    puts("released objects are reused within their size class");
+
+    pthread_t thread[NUM_THREADS];
+    _mainArena = ArenaThread();
+    for(i=0; i<NUM_THREADS; i++) pthread_create(&thread[i], NULL, Thread, (void*)(intptr_t)i);
+    for(i=0; i<NUM_THREADS; i++) pthread_join(thread[i], NULL);
+    Ofree(); // everyone's
+    printf("%d threads each had their own arenas\n", NUM_THREADS);
+    return 0;
+}
@@ -0,0 +1,152 @@
+// This software is part of github.com/waynebhayes/libwayne, and is Copyright(C) Wayne B. Hayes 2025, under the GNU LGPL 3.0
+// (GNU Lesser General Public License, version 3, 2007), a copy of which is contained at the top of the repo.
+/*
+** Check AVLTREE's unlocked lookups while a writer inserts and deletes: keys that are always there must
+** always be found, with the right info, and no lookup may ever compare against a key that's been freed
+** (FreeString poisons them first).  "avltree-threads -b" instead times a mix of lookups and updates
+** from 1 thread up to one per core, with and without locking lookups.
+*/
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sched.h>
+#include "misc.h"
+#include "avltree.h"
+#include "rng.h"
+
+#define NUM 10000	/* keys 0, 2, 4, ... are always there; the writer adds and removes the odd ones */
+#define WRITES 200000
+#define READERS 3
+#define POISON '\x7f'
+
+static AVLTREE *_tree;
+static volatile int _writing;
+static Boolean _present[2*NUM];
+
+static foint CopyString(foint s) { foint copy; copy.s = Malloc(strlen(s.s)+1); strcpy(copy.s, s.s); return copy; }
+// Keep them, poisoned, till the end, since Free would overwrite the poison.  Only writers call this.
+static char *_freed[WRITES + NUM];
+static int _numFreed;
+static void FreeString(foint s) { s.s[0] = POISON; _freed[_numFreed++] = s.s; }
+static int CmpString(foint a, foint b)
+{
+    static __thread unsigned calls;
+    if(++calls % 64 == 0) sched_yield(); // let the writer in mid-lookup, even with only one core
+    assert(a.s[0] != POISON && b.s[0] != POISON);
+    return strcmp(a.s, b.s);
+}
+
+static foint Key(char *buf, int i) { sprintf(buf, "k%06d", i); return (foint)buf; }
+
+static void *Writer(void *arg)
+{
+    RNG r;
+    char buf[20];
+    int i;
+    RngInit(&r, RNG_XOSHIRO, 2);
+    for(i=0; i<WRITES; i++) {
+	int k = 2*RngInt(&r, 0, NUM-1) + 1;
+	if(RngInt(&r, 0, 1)) { AvlTreeInsert(_tree, Key(buf, k), (foint)k); _present[k] = true; }
+	else { Boolean deleted = AvlTreeDelete(_tree, Key(buf, k)); assert(deleted == _present[k]); _present[k] = false; }
+    }
+    _writing = 0;
+    return NULL;
+}
+
+static void *Reader(void *arg)
+{
+    RNG r;
+    char buf[20];
+    foint info;
+    long lookups = 0;
+    RngInit(&r, RNG_XOSHIRO, 10 + (intptr_t)arg);
+    while(_writing || lookups < 1000) {
+	int k = RngInt(&r, 0, 2*NUM-1);
+	Boolean found = AvlTreeLookup(_tree, Key(buf, k), &info);
+	if(k % 2 == 0) assert(found);
+	if(found) assert(info.i == k);
+	++lookups;
+    }
+    return (void*)lookups;
+}
+
+static double Now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + 1e-9*ts.tv_nsec;
+}
+
+#define OPS 1000000
+static int _writePercent;
+
+static void *Mix(void *arg)
+{
+    RNG r;
+    foint info;
+    int i;
+    RngInit(&r, RNG_XOSHIRO, 100 + (intptr_t)arg);
+    for(i=0; i<OPS; i++) {
+	foint key;
+	key.l = 0; key.i = RngInt(&r, 0, 2*NUM-1);
+	if(RngInt(&r, 0, 99) >= _writePercent) AvlTreeLookup(_tree, key, &info);
+	else if(key.i % 2) { if(RngInt(&r, 0, 1)) AvlTreeInsert(_tree, key, key); else AvlTreeDelete(_tree, key); }
+    }
+    return NULL;
+}
+
+static void Benchmark(void)
+{
+    const int percent[] = {0, 1, 10};
+    int cores = sysconf(_SC_NPROCESSORS_ONLN), threads, p, i, optimistic;
+    pthread_t thread[1024];
+    printf("million operations per second, %d per thread, on %d cores:\n", OPS, cores);
+    for(p=0; p<3; p++) for(optimistic=1; optimistic>=0; optimistic--) {
+	printf("  %2d%% updates, %s:", percent[p], optimistic ? "optimistic" : "locked    ");
+	for(threads=1; ; threads = MIN(2*threads, cores)) {
+	    _tree = AvlTreeAlloc(NULL, NULL, NULL, NULL, NULL);
+	    _tree->optimistic = optimistic;
+	    for(i=0; i<2*NUM; i++) AvlTreeInsert(_tree, (foint)i, (foint)i);
+	    _writePercent = percent[p];
+	    double t = Now();
+	    for(i=0; i<threads; i++) pthread_create(&thread[i], NULL, Mix, (void*)(intptr_t)i);
+	    for(i=0; i<threads; i++) pthread_join(thread[i], NULL);
+	    printf(" %d threads %.1f;", threads, (double)threads*OPS/(Now()-t)/1e6);
+	    AvlTreeFree(_tree);
+	    if(threads >= cores || threads >= 1024) break;
+	}
+	putchar('\n');
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    pthread_t writer, reader[READERS];
+    char buf[20];
+    long lookups = 0;
+    int i;
+
+    if(argc > 1 && strcmp(argv[1], "-b") == 0) {
+	Benchmark();
+	return 0;
+    }
+
+    _tree = AvlTreeAlloc(CmpString, CopyString, FreeString, NULL, NULL);
+    for(i=0; i<2*NUM; i += 2) AvlTreeInsert(_tree, Key(buf, i), (foint)i);
+    _writing = 1;
+    for(i=0; i<READERS; i++) pthread_create(&reader[i], NULL, Reader, (void*)(intptr_t)i);
+    pthread_create(&writer, NULL, Writer, NULL);
+    pthread_join(writer, NULL);
+    for(i=0; i<READERS; i++) {
+	void *n;
+	pthread_join(reader[i], &n);
+	lookups += (long)n;
+    }
+    assert(lookups >= READERS*1000);
+    AvlTreeSanityCheck(_tree);
+    for(i=0; i<2*NUM; i++) assert(AvlTreeLookup(_tree, Key(buf, i), NULL) == (i%2 == 0 || _present[i]));
+    AvlTreeFree(_tree);
+    while(_numFreed) Free(_freed[--_numFreed]);
+    printf("%d readers never missed a key, or saw a freed one, while a writer made %d changes\n", READERS, WRITES);
+    return 0;
+}
@@ -0,0 +1,205 @@
+// This software is part of github.com/waynebhayes/libwayne, and is Copyright(C) Wayne B. Hayes 2025, under the GNU LGPL 3.0
+// (GNU Lesser General Public License, version 3, 2007), a copy of which is contained at the top of the repo.
+/*
+** Check BPTREE against brute force with random inserts, lookups and deletes, then with owned string keys
+** (nothing may leak), bulk loading and range traversals.  "bptree-test -b" instead compares the speed and
+** memory of BPTREE, AVLTREE and BINTREE.
+*/
+#include <time.h>
+#include "misc.h"
+#include "bptree.h"
+#include "avltree.h"
+#include "bintree.h"
+#include "mem-prof.h"
+#include "rng.h"
+
+#define RANGE 20000
+#define OPS 200000
+
+static double Now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + 1e-9*ts.tv_nsec;
+}
+
+static int _next; // the key we expect next in a traversal of the brute-force tree
+static Boolean _present[RANGE];
+static int _value[RANGE];
+
+static int CheckNext(foint globals, foint key, foint info)
+{
+    while(!_present[_next]) ++_next;
+    assert(key.i == _next && info.i == _value[_next]);
+    ++_next;
+    return 1;
+}
+
+static int DeleteOdd(foint globals, foint key, foint info)
+{
+    ++*(int*)globals.v;
+    return (key.s[strlen(key.s)-1] & 1) ? -1 : 1;
+}
+
+static int First(foint globals, foint key, foint info)
+{
+    *(foint*)globals.v = key;
+    return 0;
+}
+
+static int Sum(foint globals, foint key, foint info)
+{
+    *(long*)globals.v += key.i;
+    return 1;
+}
+
+static int StopAt(foint globals, foint key, foint info)
+{
+    return key.i != globals.i;
+}
+
+// with Malloc, so that the profiler sees them
+static foint CopyString(foint s) { foint copy; copy.s = Malloc(strlen(s.s)+1); strcpy(copy.s, s.s); return copy; }
+static void FreeString(foint s) { Free(s.s); }
+
+static int CmpReverse(foint a, foint b) { return b.i - a.i; }
+
+static void Benchmark(void)
+{
+    const int n = 1000000;
+    foint *key = Malloc(n * sizeof(foint)), info;
+    RNG r;
+    int i, t;
+    RngInit(&r, RNG_XOSHIRO, 1);
+    for(i=0; i<n; i++) key[i].l = 0, key[i].i = RngInt(&r, 0, 1<<30);
+    printf("%d random int keys:      insert   lookup   memory\n", n);
+    for(t=0; t<3; t++) {
+	const char *name[] = {"BPTREE ", "AVLTREE", "BINTREE"};
+	int64_t live0, live;
+	void *tree;
+	double t0, t1, t2;
+	MemProfEnable(1000, "/dev/null");
+	MemProfTotals(NULL, NULL, NULL, &live0, NULL);
+	t0 = Now();
+	switch(t) {
+	case 0: tree = BpTreeAlloc(NULL, NULL, NULL, NULL, NULL); for(i=0; i<n; i++) BpTreeInsert(tree, key[i], key[i]); break;
+	case 1: tree = AvlTreeAlloc(NULL, NULL, NULL, NULL, NULL); for(i=0; i<n; i++) AvlTreeInsert(tree, key[i], key[i]); break;
+	default: tree = BinTreeAlloc(NULL, NULL, NULL, NULL, NULL); for(i=0; i<n; i++) BinTreeInsert(tree, key[i], key[i]); break;
+	}
+	t1 = Now();
+	MemProfTotals(NULL, NULL, NULL, &live, NULL);
+	MemProfDisable();
+	switch(t) {
+	case 0: for(i=0; i<n; i++) BpTreeLookup(tree, key[i], &info); break;
+	case 1: for(i=0; i<n; i++) AvlTreeLookup(tree, key[i], &info); break;
+	default: for(i=0; i<n; i++) BinTreeLookup(tree, key[i], &info); break;
+	}
+	t2 = Now();
+	printf("  %s  %8.0f %8.0f %8.1f  (operations/ms, memory in bytes/key)\n", name[t],
+	    n/(t1-t0)/1000, n/(t2-t1)/1000, (double)(live-live0)/n);
+	switch(t) {
+	case 0: BpTreeFree(tree); break;
+	case 1: AvlTreeFree(tree); break;
+	default: BinTreeFree(tree); break;
+	}
+    }
+    Free(key);
+}
+
+int main(int argc, char *argv[])
+{
+    static foint keys[10*RANGE], info[10*RANGE];
+    BPTREE *tree;
+    RNG r;
+    foint key, data;
+    long sum;
+    int i, count;
+
+    if(argc > 1 && strcmp(argv[1], "-b") == 0) {
+	Benchmark();
+	return 0;
+    }
+
+    RngInit(&r, RNG_XOSHIRO, 1);
+    tree = BpTreeAlloc(NULL, NULL, NULL, NULL, NULL);
+    for(i=0; i<OPS; i++) {
+	int k = RngInt(&r, 0, RANGE-1), what = RngInt(&r, 0, 9);
+	key.l = 0; key.i = k;
+	if(what < 5 - 4*(i > OPS/2)) { // insert; after halfway, mostly delete so that the tree shrinks
+	    data.i = i;
+	    BpTreeInsert(tree, key, data);
+	    _present[k] = true; _value[k] = i;
+	}
+	else if(what < 8) {
+	    Boolean deleted = BpTreeDelete(tree, key);
+	    assert(deleted == _present[k]);
+	    _present[k] = false;
+	}
+	else {
+	    Boolean found = BpTreeLookup(tree, key, &data);
+	    assert(found == _present[k]);
+	    if(found) assert(data.i == _value[k]);
+	}
+	if(i % 1000 == 0) BpTreeSanityCheck(tree);
+    }
+    BpTreeSanityCheck(tree);
+    BpTreeTraverse((foint)NULL, tree, CheckNext);
+    BpTreeFree(tree);
+    puts("random inserts, lookups and deletes agree with brute force");
+
+    int64_t live0, live;
+    MemProfEnable(1, "/dev/null");
+    MemProfTotals(NULL, NULL, NULL, &live0, NULL);
+    tree = BpTreeAlloc((pCmpFcn)strcmp, CopyString, FreeString, NULL, NULL);
+    for(i=0; i<RANGE; i++) {
+	char buf[20];
+	sprintf(buf, "%ld", RngInt(&r, 0, 10*RANGE));
+	BpTreeInsert(tree, (foint)buf, (foint)i);
+    }
+    unsigned n = tree->n;
+    count = 0;
+    BpTreeTraverse((foint)(void*)&count, tree, DeleteOdd);
+    assert((unsigned)count == n && tree->n < n);
+    BpTreeSanityCheck(tree);
+    while(tree->n > 100) { // delete from the front, so it shrinks
+	BpTreeTraverse((foint)(void*)&key, tree, First);
+	Boolean deleted = BpTreeDelete(tree, key);
+	assert(deleted);
+	BpTreeSanityCheck(tree);
+    }
+    BpTreeFree(tree);
+    MemProfTotals(NULL, NULL, NULL, &live, NULL);
+    MemProfDisable();
+    assert(live == live0);
+    puts("owned string keys: traversing with deletions, shrinking and freeing leak nothing");
+
+    for(i=0; i<10*RANGE; i++) { keys[i].l = info[i].l = 0; keys[i].i = 3*i; info[i].i = -i; }
+    tree = BpTreeAlloc(NULL, NULL, NULL, NULL, NULL);
+    BpTreeBulkLoad(tree, 10*RANGE, keys, info);
+    BpTreeSanityCheck(tree);
+    assert(tree->n == 10*RANGE && tree->leaves == (10*RANGE + BPTREE_ORDER-2)/(BPTREE_ORDER-1));
+    for(i=0; i<30*RANGE; i++) {
+	key.l = 0; key.i = i;
+	assert(BpTreeLookup(tree, key, &data) == (i%3 == 0));
+	if(i%3 == 0) assert(data.i == -i/3);
+    }
+    sum = 0;
+    BpTreeTraverseRange((foint)(void*)&sum, tree, (foint)1000, (foint)2000, Sum); // 1002, 1005, ..., 1998
+    assert(sum == (1002 + 1998) * 333 / 2);
+    assert(BpTreeTraverseRange((foint)300, tree, (foint)0, (foint)1000, StopAt) == 0);
+    for(i=0; i<RANGE; i++) { key.l = 0; key.i = 3*i+1; BpTreeInsert(tree, key, key); }
+    BpTreeSanityCheck(tree);
+    assert(tree->n == 11*RANGE);
+    BpTreeFree(tree);
+    puts("bulk loading and range traversals work");
+
+    tree = BpTreeAlloc(CmpReverse, NULL, NULL, NULL, NULL);
+    for(i=0; i<RANGE; i++) BpTreeInsert(tree, (foint)i, (foint)i);
+    BpTreeSanityCheck(tree);
+    sum = 0;
+    BpTreeTraverseRange((foint)(void*)&sum, tree, (foint)(RANGE-1), (foint)(RANGE-11), Sum);
+    assert(sum == (RANGE-1 + RANGE-10) * 10 / 2);
+    BpTreeFree(tree);
+    puts("and so does your own comparison function");
+    return 0;
+}
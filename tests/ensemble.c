@@ -0,0 +1,189 @@
+// This software is part of github.com/waynebhayes/libwayne, and is Copyright(C) Wayne B. Hayes 2025, under the GNU LGPL 3.0
+// (GNU Lesser General Public License, version 3, 2007), a copy of which is contained at the top of the repo.
+/*
+** Check the batched integrators against the scalar ones on an ensemble of damped, driven oscillators that differ
+** in their initial conditions and parameters. "ensemble -b [M]" instead times M members both ways.
+*/
+#include <time.h>
+#include "misc.h"
+#include "ensemble.h"
+#include "rk4.h"
+#include "rk23.h"
+
+#define TOUT 10.0
+#define DT 1e-2
+
+typedef struct { double damping, omega; } PARAMS;
+
+static void InitialState(int m, int M, double y[2], PARAMS *p)
+{
+    y[0] = 1 + m/(double)M; y[1] = 0;
+    p->damping = 0.1 + 0.5*(m%7)/7.0; p->omega = 1 + (m%13)/13.0;
+}
+
+// The batch form: one call does every member, with each member's parameters in arg.
+static void OscillatorBatch(int N, int M, const double *T, const double *Y, double *Ydot, void *arg)
+{
+    const PARAMS *p = arg;
+    const double *x = Y, *v = Y + M;
+    int m;
+    assert(N == 2);
+    for(m=0; m<M; m++) {
+	Ydot[m] = v[m];
+	Ydot[M+m] = -p[m].damping*v[m] - p[m].omega*p[m].omega*x[m] + sin(T[m]);
+    }
+}
+
+// The scalar form, with the parameters carried along as constant components of y.
+static void Oscillator(int n, double t, double *y, double *ydot)
+{
+    assert(n == 4);
+    ydot[0] = y[1];
+    ydot[1] = -y[2]*y[1] - y[3]*y[3]*y[0] + sin(t);
+    ydot[2] = ydot[3] = 0;
+}
+
+static F_EVAL _scalarF = Oscillator;
+
+static double Now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + 1e-9*ts.tv_nsec;
+}
+
+// Set up M members in SoA form; the scalar tests also want Y4, the same members as 4-component AoS.
+static void Setup(int M, double *Y, PARAMS *p, double *Y4)
+{
+    int m;
+    for(m=0; m<M; m++) {
+	double y[2];
+	InitialState(m, M, y, &p[m]);
+	Y[m] = y[0]; Y[M+m] = y[1];
+	if(Y4) { Y4[4*m] = y[0]; Y4[4*m+1] = y[1]; Y4[4*m+2] = p[m].damping; Y4[4*m+3] = p[m].omega; }
+    }
+}
+
+static double MaxDiff(int M, const double *Y, const double *Y4)
+{
+    double diff = 0;
+    int m;
+    for(m=0; m<M; m++) diff = MAX(diff, MAX(fabs(Y[m] - Y4[4*m]), fabs(Y[M+m] - Y4[4*m+1])));
+    return diff;
+}
+
+static double MaxDiff2(int M, const double *Y, const double *y1)
+{
+    double diff = 0;
+    int m;
+    for(m=0; m<M; m++) diff = MAX(diff, MAX(fabs(Y[m] - y1[2*m]), fabs(Y[M+m] - y1[2*m+1])));
+    return diff;
+}
+
+static void Benchmark(int M)
+{
+    double *Y = Malloc(2*M*sizeof(double)), *Y4 = Malloc(4*M*sizeof(double)), t;
+    PARAMS *p = Malloc(M*sizeof(PARAMS));
+    ENSEMBLE *e;
+    int m;
+
+    printf("%d members integrated to T=%g\n", M, TOUT);
+    Setup(M, Y, p, Y4);
+    t = Now();
+    for(m=0; m<M; m++) { RK4 *r = Rk4Alloc(4, 0, Y4+4*m, Oscillator, 0, DT, 0); Rk4Integrate(r, TOUT); Rk4Free(r); }
+    printf("  RK4  scalar loop   %8.3f s\n", Now()-t);
+    t = Now();
+    e = EnsembleAlloc(ENSEMBLE_RK4, 2, M, 0, Y, OscillatorBatch, p, DT, 0);
+    EnsembleIntegrate(e, TOUT);
+    printf("  RK4  ensemble      %8.3f s (max difference %g)\n", Now()-t, MaxDiff(M, Y, Y4));
+    EnsembleFree(e);
+
+    // Rk23 controls its error differently, so the RK23 baseline is the ensemble code run one member at a time
+    Setup(M, Y, p, NULL);
+    double *y1 = Malloc(2*M*sizeof(double));
+    long steps = 0;
+    t = Now();
+    for(m=0; m<M; m++) {
+	y1[2*m] = Y[m]; y1[2*m+1] = Y[M+m];
+	e = EnsembleAlloc(ENSEMBLE_RK23, 2, 1, 0, y1+2*m, OscillatorBatch, p+m, DT, 1e-8);
+	EnsembleIntegrate(e, TOUT);
+	steps += e->nAccept + e->nReject;
+	EnsembleFree(e);
+    }
+    printf("  RK23 one at a time %8.3f s (%ld steps)\n", Now()-t, steps);
+    t = Now();
+    e = EnsembleAlloc(ENSEMBLE_RK23, 2, M, 0, Y, OscillatorBatch, p, DT, 1e-8);
+    EnsembleIntegrate(e, TOUT);
+    printf("  RK23 ensemble      %8.3f s (%ld steps in %ld rounds; max difference %g)\n",
+	Now()-t, e->nAccept + e->nReject, e->nEval/3, MaxDiff2(M, Y, y1));
+    EnsembleFree(e);
+    Free(Y); Free(Y4); Free(y1); Free(p);
+}
+
+#define M 1000
+
+int main(int argc, char *argv[])
+{
+    static double Y[2*M], Y4[4*M], ref[2*M];
+    static PARAMS p[M];
+    ENSEMBLE *e;
+    int m;
+
+    if(argc > 1 && strcmp(argv[1], "-b") == 0) {
+	Benchmark(argc > 2 ? atoi(argv[2]) : 10000);
+	return 0;
+    }
+
+    // RK4: every member should get what the scalar RK4 gives it
+    Setup(M, Y, p, Y4);
+    e = EnsembleAlloc(ENSEMBLE_RK4, 2, M, 0, Y, OscillatorBatch, p, DT, 0);
+    for(m=0; m<M; m++) { RK4 *r = Rk4Alloc(4, 0, Y4+4*m, Oscillator, 0, DT, 0); Rk4Integrate(r, TOUT); Rk4Free(r); }
+    double t = EnsembleIntegrate(e, TOUT/2);
+    assert(t == TOUT/2);
+    EnsembleIntegrate(e, TOUT); // in two pieces, to check it resumes
+    assert(MaxDiff(M, Y, Y4) < 1e-12);
+    for(m=0; m<M; m++) assert(e->T[m] == TOUT);
+    EnsembleFree(e);
+    puts("rk4 ensemble matches scalar rk4");
+    memcpy(ref, Y, sizeof(Y));
+
+    // RK23: each member within tolerance of the RK4 answer, with the members taking different steps
+    Setup(M, Y, p, NULL);
+    e = EnsembleAlloc(ENSEMBLE_RK23, 2, M, 0, Y, OscillatorBatch, p, DT, 1e-9);
+    EnsembleIntegrate(e, TOUT);
+    double maxErr = 0, minH = HUGE_VAL, maxH = 0;
+    for(m=0; m<2*M; m++) maxErr = MAX(maxErr, fabs(Y[m] - ref[m]));
+    for(m=0; m<M; m++) { assert(e->T[m] == TOUT); minH = MIN(minH, e->H[m]); maxH = MAX(maxH, e->H[m]); }
+    assert(maxErr < 1e-6);
+    assert(minH < maxH);
+    EnsembleFree(e);
+    for(m=0; m<M; m+=97) { // and each member gets exactly what it would have on its own
+	double y1[2];
+	InitialState(m, M, y1, &p[m]);
+	e = EnsembleAlloc(ENSEMBLE_RK23, 2, 1, 0, y1, OscillatorBatch, p+m, DT, 1e-9);
+	EnsembleIntegrate(e, TOUT);
+	assert(y1[0] == Y[m] && y1[1] == Y[M+m]);
+	EnsembleFree(e);
+    }
+    puts("rk23 ensemble agrees with rk4, with per-member steps");
+
+    // an ordinary F_EVAL through EnsembleScalarF, and getting and setting members
+    double *Y4soa = Malloc(4*M*sizeof(double)), y[4];
+    e = EnsembleAlloc(ENSEMBLE_RK4, 4, M, 0, Y4soa, EnsembleScalarF, &_scalarF, DT, 0);
+    for(m=0; m<M; m++) {
+	InitialState(m, M, y, &p[m]);
+	y[2] = p[m].damping; y[3] = p[m].omega;
+	EnsembleSetMember(e, m, y);
+    }
+    EnsembleGetMember(e, 7, y);
+    assert(y[2] == p[7].damping && Y4soa[2*M+7] == p[7].damping);
+    EnsembleIntegrate(e, TOUT);
+    for(m=0; m<M; m++) {
+	EnsembleGetMember(e, m, y);
+	assert(fabs(y[0] - ref[m]) < 1e-12 && fabs(y[1] - ref[M+m]) < 1e-12);
+    }
+    EnsembleFree(e);
+    Free(Y4soa);
+    puts("scalar F_EVAL through EnsembleScalarF matches");
+    return 0;
+}
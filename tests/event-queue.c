@@ -0,0 +1,187 @@
+// This software is part of github.com/waynebhayes/libwayne, and is Copyright(C) Wayne B. Hayes 2025, under the GNU LGPL 3.0
+// (GNU Lesser General Public License, version 3, 2007), a copy of which is contained at the top of the repo.
+/*
+** Check the calendar-queue EVENT_LIST: events run in time order, ties in insertion order, cancelled events
+** never run, and independent lists keep independent clocks.  Then run the ALOHA model of aloha.c on both it
+** and the heap-based global event list, which must agree exactly.
+** "event-queue -b" instead times the two on ALOHA (which is unstable at this LAMBDA: its backlog, and so the
+** number of pending events, keeps growing) and on the classic "hold" model with a fixed number pending.
+*/
+#include <time.h>
+#include "misc.h"
+#include "event.h"
+#include "rng.h"
+
+static RNG _rng;
+static double Exponential(double mean) { return -mean * log(1 - RngUniform(&_rng)); }
+
+static double Now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + 1e-9*ts.tv_nsec;
+}
+
+/*
+** The models are written once, against whichever event list is selected here.
+*/
+static EVENT_LIST *_L; // NULL means the global heap-based list
+static void Schedule(Event event, Time delta, Object object)
+{
+    if(_L) EventListInsert(_L, event, delta, object);
+    else EventInsert(event, delta, object);
+}
+static void RunUntil(Time end) // or until there are no more events
+{
+    if(_L) while(EventListSize(_L) && EventListNow(_L) < end) EventListNext(_L);
+    else while(EventNow() < end) free(EventNext());
+}
+
+// ALOHA, as in aloha.c: new packets arrive at rate LAMBDA, and collided ones are retried at rate RETRY.
+#define LAMBDA 0.183
+#define RETRY (LAMBDA/600)
+static int _busy, _numBackLogged, _yes = 1, _no = 0;
+static long _successes, _numEvents;
+static void Transmit(void *p);
+static void Check(void *p)
+{
+    ++_numEvents;
+    --_busy;
+    if(!_busy) { ++_successes; if(*(int*)p) --_numBackLogged; }
+    else { if(!*(int*)p) ++_numBackLogged; Schedule(Transmit, Exponential(1/RETRY), &_yes); }
+}
+static void Lost(void *p)
+{
+    ++_numEvents;
+    --_busy;
+    if(!*(int*)p) ++_numBackLogged;
+    Schedule(Transmit, Exponential(1/RETRY), &_yes);
+}
+static void Transmit(void *p)
+{
+    ++_numEvents;
+    if(!*(int*)p) Schedule(Transmit, Exponential(1/LAMBDA), &_no);
+    Schedule(_busy ? Lost : Check, 1.0, p);
+    ++_busy;
+}
+static void Aloha(Time end)
+{
+    _busy = _numBackLogged = _successes = _numEvents = 0;
+    RngInit(&_rng, RNG_XOSHIRO, 1);
+    Schedule(Transmit, 0.0, &_no);
+    RunUntil(end);
+}
+
+// The hold model: each event schedules one more, so the number pending stays at whatever it started at.
+static void Hold(void *p) { ++_numEvents; Schedule(Hold, Exponential(1), p); }
+static void HoldModel(int n, long steps)
+{
+    int i;
+    RngInit(&_rng, RNG_XOSHIRO, 2);
+    for(i=0; i<n; i++) Schedule(Hold, Exponential(1), NULL);
+    _numEvents = 0;
+    if(_L) while(_numEvents < steps) EventListNext(_L);
+    else while(_numEvents < steps) free(EventNext());
+}
+
+static void Benchmark(void)
+{
+    static const int holdSizes[] = {100, 10000, 1000000};
+    double t;
+    int i;
+    EventListInit(1000); _L = NULL;
+    t = Now(); Aloha(1e6); printf("ALOHA %ld events: heap %.3f s", _numEvents, Now()-t);
+    _L = EventListAlloc();
+    t = Now(); Aloha(1e6); printf(", calendar %.3f s\n", Now()-t);
+    EventListFree(_L);
+    for(i=0; i<3; i++) {
+	int n = holdSizes[i];
+	EventListInit(n); _L = NULL;
+	t = Now(); HoldModel(n, 2000000); printf("hold with %7d pending: heap %.3f s", n, Now()-t);
+	_L = EventListAlloc();
+	t = Now(); HoldModel(n, 2000000); printf(", calendar %.3f s\n", Now()-t);
+	EventListFree(_L);
+    }
+}
+
+/*
+** The ordering test: records that know when they should run and what's happened to them.
+*/
+#define N 20000
+typedef struct { int seq; Time when; EVENT_HANDLE handle; Boolean ran, cancelled; } RECORD;
+static RECORD _rec[2*N];
+static int _numRec, _lastSeq = -1;
+static Time _lastTime;
+static void CheckOrder(void *p)
+{
+    RECORD *r = p;
+    assert(!r->ran && !r->cancelled);
+    assert(r->when == EventListNow(_L) && r->when >= _lastTime);
+    if(r->when == _lastTime) assert(r->seq > _lastSeq);
+    _lastTime = r->when; _lastSeq = r->seq;
+    r->ran = true;
+    // sometimes schedule another (possibly for right now), and sometimes cancel a random one
+    if(_numRec < 2*N && RngInt(&_rng, 0, 1)) {
+	RECORD *s = &_rec[_numRec];
+	s->seq = _numRec++;
+	s->when = EventListNow(_L) + RngInt(&_rng, 0, 8) / 4.0;
+	s->handle = EventListInsert(_L, CheckOrder, s->when - EventListNow(_L), s);
+    }
+    if(RngInt(&_rng, 0, 3) == 0) {
+	RECORD *s = &_rec[RngInt(&_rng, 0, _numRec-1)];
+	int first = EventListCancel(_L, s->handle), again = EventListCancel(_L, s->handle);
+	if(!s->ran && !s->cancelled) {
+	    assert(first && !again);
+	    s->cancelled = true;
+	}
+	else assert(!first && !again); // even though its record probably holds a newer event
+    }
+}
+
+static int _countA, _countB;
+static void TickA(void *p) { ++_countA; if(_countA < 1000) EventListInsert(p, TickA, 1.0, p); }
+static void TickB(void *p) { ++_countB; if(_countB < 1000) EventListInsert(p, TickB, 0.001, p); }
+
+int main(int argc, char *argv[])
+{
+    int i, ran = 0, cancelled = 0;
+
+    if(argc > 1 && strcmp(argv[1], "-b") == 0) {
+	Benchmark();
+	return 0;
+    }
+
+    RngInit(&_rng, RNG_XOSHIRO, 3);
+    _L = EventListAlloc();
+    for(_numRec=0; _numRec<N; _numRec++) { // spread over a wide range of times, with many ties
+	RECORD *r = &_rec[_numRec];
+	r->seq = _numRec;
+	r->when = RngInt(&_rng, 0, 1000) * (RngInt(&_rng, 0, 9) ? 1.0 : 1000.0);
+	r->handle = EventListInsert(_L, CheckOrder, r->when, r);
+    }
+    while(EventListNext(_L))
+	;
+    for(i=0; i<_numRec; i++) { assert(_rec[i].ran != _rec[i].cancelled); ran += _rec[i].ran; cancelled += _rec[i].cancelled; }
+    printf("%d events: %d ran in order, %d cancelled\n", _numRec, ran, cancelled);
+    EventListFree(_L);
+
+    // two lists with very different time scales, stepped alternately
+    EVENT_LIST *A = EventListAlloc(), *B = EventListAlloc();
+    EventListInsert(A, TickA, 0, A); EventListInsert(B, TickB, 0, B);
+    while(EventListNext(A) | EventListNext(B))
+	;
+    assert(_countA == 1000 && _countB == 1000 && EventListNow(A) == 999 && fabs(EventListNow(B) - 0.999) < 1e-12);
+    EventListFree(A); EventListFree(B);
+    puts("independent lists keep independent clocks");
+
+    // ALOHA both ways
+    EventListInit(1000); _L = NULL;
+    Aloha(100000);
+    long heapSuccesses = _successes, heapEvents = _numEvents;
+    _L = EventListAlloc();
+    Aloha(100000);
+    EventListFree(_L);
+    assert(_successes == heapSuccesses && _numEvents == heapEvents);
+    printf("ALOHA: %ld events, %ld successes on both the heap and the calendar\n", _numEvents, _successes);
+    return 0;
+}
@@ -0,0 +1,139 @@
+// This software is part of github.com/waynebhayes/libwayne, and is Copyright(C) Wayne B. Hayes 2025, under the GNU LGPL 3.0
+// (GNU Lesser General Public License, version 3, 2007), a copy of which is contained at the top of the repo.
+/*
+** Check HASH and raw_hashmap against brute force with random inserts, lookups and deletes (so the table
+** grows, and deletions shift long probe sequences back), 64-bit keys that differ only in their high bits,
+** iteration, and emptying a map with HashGetOne.  "hash-mix -b" instead times mixes of inserts, lookups
+** and deletes.
+*/
+#include <time.h>
+#include "misc.h"
+#include "hash.h"
+#include "rng.h"
+
+#define RANGE 50000
+#define OPS 1000000
+
+static double Now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + 1e-9*ts.tv_nsec;
+}
+
+static Boolean _present[RANGE];
+static int _value[RANGE];
+static int _seen;
+
+static int Check(int key, foint data)
+{
+    assert(0 <= key && key < RANGE && _present[key] && data.i == _value[key]);
+    ++_seen;
+    return HASH_OK;
+}
+
+static int StopAtTen(int64_t key, any_t data) { return ++_seen < 10 ? RAW_HASHMAP_OK : RAW_HASHMAP_FULL; }
+
+static void Benchmark(void)
+{
+    const int n = 1000000, ops = 4000000;
+    const char *name[] = {"insert n new keys", "lookups, all found", "lookups, none found",
+	"insert/delete 50/50", "lookup/insert/delete 80/10/10"};
+    int *key = Malloc(n * sizeof(int)), mix, i;
+    HASH *H = HashAlloc();
+    foint f;
+    RNG r;
+    RngInit(&r, RNG_XOSHIRO, 1);
+    for(i=0; i<n; i++) key[i] = RngInt(&r, 0, 1<<30) * 2; // even keys; odd ones are never there
+    printf("%d keys, %d operations each (but the first), in million operations/s:\n", n, ops);
+    for(mix=0; mix<5; mix++) {
+	double t = Now();
+	int count = mix ? ops : n;
+	for(i=0; i<count; i++) {
+	    int k = key[RngInt(&r, 0, n-1)], what = RngInt(&r, 0, 9);
+	    switch(mix) {
+	    case 0: HashInsert(H, key[i], (foint)i); break;
+	    case 1: HashGet(H, k, &f); break;
+	    case 2: HashGet(H, k+1, &f); break;
+	    case 3: if(what < 5) HashInsert(H, k, (foint)i); else HashDelete(H, k); break;
+	    default: if(what < 8) HashGet(H, k, &f); else if(what < 9) HashInsert(H, k, (foint)i); else HashDelete(H, k); break;
+	    }
+	}
+	printf("  %-30s %6.1f\n", name[mix], count/(Now()-t)/1e6);
+    }
+    HashFree(H);
+    Free(key);
+}
+
+int main(int argc, char *argv[])
+{
+    HASH *H;
+    raw_hashmap_t m;
+    RNG r;
+    foint f;
+    int i, k, n = 0, iter, status;
+    Boolean ok;
+
+    if(argc > 1 && strcmp(argv[1], "-b") == 0) {
+	Benchmark();
+	return 0;
+    }
+
+    RngInit(&r, RNG_XOSHIRO, 1);
+    H = HashAlloc();
+    for(i=0; i<OPS; i++) {
+	int what = RngInt(&r, 0, 9);
+	k = RngInt(&r, 0, RANGE-1);
+	if(what < 5 - 3*(i > OPS/2)) { // after halfway, mostly delete
+	    HashInsert(H, k, (foint)i);
+	    n += !_present[k];
+	    _present[k] = true; _value[k] = i;
+	}
+	else if(what < 8) {
+	    ok = HashDelete(H, k); // (nothing with side effects goes in an assert, so it all still happens with -DNDEBUG)
+	    assert(ok == _present[k]);
+	    n -= _present[k];
+	    _present[k] = false;
+	}
+	else {
+	    Boolean found = HashGet(H, k, &f);
+	    assert(found == _present[k]);
+	    if(found) assert(f.i == _value[k]);
+	}
+	assert(HashSize(H) == n);
+	if(i % (OPS/4) == 0 || i == OPS-1) {
+	    _seen = 0;
+	    status = HashIterate(H, Check);
+	    assert(status == HASH_OK && _seen == n);
+	}
+    }
+    puts("random inserts, lookups and deletes agree with brute force");
+
+    iter = 0;
+    while(HashNext(H, &iter, &k, &f)) { assert(_present[k] && f.i == _value[k]); --n; }
+    assert(n == 0);
+    while(HashGetOne(H, &k, true)) { assert(_present[k]); _present[k] = false; }
+    assert(HashSize(H) == 0);
+    for(k=0; k<RANGE; k++) assert(!_present[k] && !HashGet(H, k, &f));
+    HashFree(H);
+    puts("HashNext sees them all, and HashGetOne empties it");
+
+    m = raw_hashmap_new();
+    for(i=0; i<RANGE; i++) { status = raw_hashmap_put(m, (int64_t)i << 40, (any_t)(intptr_t)i); assert(status == RAW_HASHMAP_OK); }
+    assert(raw_hashmap_length(m) == RANGE);
+    for(i=0; i<RANGE; i++) {
+	any_t data;
+	status = raw_hashmap_get(m, (int64_t)i << 40, &data);
+	assert(status == RAW_HASHMAP_OK && (intptr_t)data == i);
+	status = raw_hashmap_get(m, ((int64_t)i << 40) + 1, &data);
+	assert(status == RAW_HASHMAP_MISSING);
+	if(i % 2) { status = raw_hashmap_remove(m, (int64_t)i << 40); assert(status == RAW_HASHMAP_OK); }
+    }
+    assert(raw_hashmap_length(m) == RANGE/2);
+    _seen = 0;
+    status = raw_hashmap_iterate(m, StopAtTen);
+    assert(status == RAW_HASHMAP_FULL && _seen == 10);
+    raw_hashmap_free(m);
+    puts("and so does raw_hashmap with keys that only differ in their high bits");
+    return 0;
+}
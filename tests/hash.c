@@ -7,6 +7,12 @@
 #include <ctype.h>
 #include "hash.h"
 
+int PrintHashEntry(int key, foint data)
+{
+    printf("entry %d is \"%s\"\n", key, data.s);
+    return HASH_OK;
+}
+
 int main(int argc, char *argv[])
 {
     FILE *fp = stdin;
@@ -27,7 +33,7 @@ int main(int argc, char *argv[])
     }
 
     printf("Finished entering. Now iterate through all elements:\n");
-    printf("NAH SORRY NO ITERATION YET\n");
+    HashIterate(H, PrintHashEntry);
     printf("Finished enumerating elements\n");
 
     while(fgets(line,sizeof(line),stdin) && 1==sscanf(line, "%d", &key)) {
@@ -0,0 +1,195 @@
+// This software is part of github.com/waynebhayes/libwayne, and is Copyright(C) Wayne B. Hayes 2025, under the GNU LGPL 3.0
+// (GNU Lesser General Public License, version 3, 2007), a copy of which is contained at the top of the repo.
+/*
+** Check that a flat HTREE (HTreeAllocFlat) behaves like a nested one: random inserts, lookups, deletes
+** of elements and of whole sub-trees, HTreeSizes and HTreeTraverse, with int keys and then with owned
+** string keys (nothing may leak).  "htree-flat -b" instead compares their speed and memory as 3- and
+** 4-level counters.
+*/
+#include <time.h>
+#include "misc.h"
+#include "htree.h"
+#include "mem-prof.h"
+#include "rng.h"
+
+#define DEPTH 3
+#define RANGE 8	/* per level, so that sub-trees fill up and empty out */
+#define OPS 200000
+
+static double Now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + 1e-9*ts.tv_nsec;
+}
+
+static Boolean _present[RANGE][RANGE][RANGE];
+static int _value[RANGE][RANGE][RANGE];
+
+// Record the traversal, as "k0 k1 k2 info" integers
+typedef struct { int n; int (*seen)[DEPTH+1]; } TRACE;
+static int Record(foint globals, foint keys[], foint info)
+{
+    TRACE *t = globals.v;
+    int k;
+    for(k=0; k<DEPTH; k++) t->seen[t->n][k] = keys[k].i;
+    t->seen[t->n++][DEPTH] = info.i;
+    return 1;
+}
+
+static int StopAtTen(foint globals, foint keys[], foint info) { return ++*(int*)globals.v < 10; }
+
+// with Malloc, so that the profiler sees them
+static foint CopyString(foint s) { foint copy; copy.s = Malloc(strlen(s.s)+1); strcpy(copy.s, s.s); return copy; }
+static void FreeString(foint s) { Free(s.s); }
+
+static int _prev[DEPTH];
+static int CheckStrings(foint globals, foint keys[], foint info)
+{
+    int k, c = 0;
+    ++*(int*)globals.v;
+    for(k=0; k<DEPTH && !c; k++) c = atoi(keys[k].s) - _prev[k]; // the keys are all 3 digits, so sort numerically
+    assert(*(int*)globals.v == 1 || c > 0);
+    for(k=0; k<DEPTH; k++) _prev[k] = atoi(keys[k].s);
+    assert(info.i == _prev[0] + _prev[1] + _prev[2]);
+    return 1;
+}
+
+static void Benchmark(void)
+{
+    const int n = 2000000;
+    int depth, flat, i, k;
+    RNG r;
+    printf("%d counter increments:         time (ms)  memory (bytes/element)\n", n);
+    for(depth=3; depth<=4; depth++) for(flat=0; flat<=1; flat++) {
+	int range = depth == 3 ? 100 : 30, elements = 0; // about a million possible paths either way
+	foint keys[4];
+	int64_t live0, live;
+	HTREE *h;
+	double t;
+	RngInit(&r, RNG_XOSHIRO, 1);
+	MemProfEnable(1000, "/dev/null");
+	MemProfTotals(NULL, NULL, NULL, &live0, NULL);
+	h = flat ? HTreeAllocFlat(depth, NULL, NULL, NULL, NULL, NULL, NULL) : HTreeAlloc(depth, NULL, NULL, NULL, NULL, NULL);
+	t = Now();
+	for(i=0; i<n; i++) {
+	    for(k=0; k<depth; k++) keys[k].l = 0, keys[k].i = RngInt(&r, 0, range-1);
+	    foint *count = UnsafeHTreeLookDel(h, keys, 0, false);
+	    if(count) ++count->i;
+	    else { HTreeInsert(h, keys, (foint)1); ++elements; } // (the nested h->n isn't reliable)
+	}
+	t = Now() - t;
+	MemProfTotals(NULL, NULL, NULL, &live, NULL);
+	MemProfDisable();
+	printf("  %d levels, %s  %8.0f  %8.1f  (%d elements)\n", depth, flat ? "flat  " : "nested", 1000*t,
+	    (double)(live-live0)/elements, elements);
+	HTreeFree(h);
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    HTREE *nested, *flat;
+    RNG r;
+    foint keys[DEPTH], info;
+    int i, k, count, sizes[2][DEPTH];
+    unsigned n = 0;
+
+    if(argc > 1 && strcmp(argv[1], "-b") == 0) {
+	Benchmark();
+	return 0;
+    }
+
+    RngInit(&r, RNG_XOSHIRO, 1);
+    nested = HTreeAlloc(DEPTH, NULL, NULL, NULL, NULL, NULL);
+    flat = HTreeAllocFlat(DEPTH, NULL, NULL, NULL, NULL, NULL, NULL);
+    for(i=0; i<OPS; i++) {
+	int what = RngInt(&r, 0, 99);
+	for(k=0; k<DEPTH; k++) keys[k].l = 0, keys[k].i = RngInt(&r, 0, RANGE-1);
+	Boolean *present = &_present[keys[0].i][keys[1].i][keys[2].i];
+	int *value = &_value[keys[0].i][keys[1].i][keys[2].i];
+	if(what < 45) {
+	    HTreeInsert(nested, keys, (foint)i);
+	    HTreeInsert(flat, keys, (foint)i);
+	    n += !*present;
+	    *present = true; *value = i;
+	}
+	else if(what < 65) {
+	    Boolean deleted;
+	    if(*present) { deleted = HTreeDelete(nested, keys); assert(deleted); } // nested miscounts deleting what isn't there
+	    deleted = HTreeDelete(flat, keys);
+	    assert(deleted == *present);
+	    n -= *present;
+	    *present = false;
+	}
+	else if(what < 85) {
+	    Boolean found = HTreeLookup(flat, keys, &info);
+	    assert(found == *present);
+	    if(found) assert(info.i == *value);
+	    assert(HTreeLookup(nested, keys, NULL) == found);
+	}
+	else if(what < 95) {
+	    int filled = HTreeSizes(nested, keys, sizes[0]);
+	    assert(HTreeSizes(flat, keys, sizes[1]) == filled);
+	    for(k=0; k<filled; k++) assert(sizes[0][k] == sizes[1][k]);
+	}
+	else { // a whole sub-tree, which stays (empty) even after all its elements are deleted
+	    int target = RngInt(&r, 1, DEPTH-1), a, b;
+	    Boolean exists = UnsafeHTreeLookDel(nested, keys, target, false) != NULL;
+	    assert((UnsafeHTreeLookDel(flat, keys, target, false) != NULL) == exists);
+	    if(what % 2 && exists) {
+		foint *n1 = UnsafeHTreeLookDel(nested, keys, target, true), *f1 = UnsafeHTreeLookDel(flat, keys, target, true);
+		assert(n1 && f1);
+		for(a=0; a<RANGE; a++) for(b=0; b<RANGE; b++) {
+		    Boolean *p = target == 1 ? &_present[keys[0].i][a][b] : &_present[keys[0].i][keys[1].i][b];
+		    n -= *p;
+		    *p = false;
+		}
+	    }
+	}
+	assert(flat->n == n);
+    }
+    puts("random inserts, lookups, deletes and sizes agree with the nested HTREE");
+
+    TRACE t[2];
+    for(i=0; i<2; i++) { t[i].n = 0; t[i].seen = Malloc((n+1) * sizeof(*t[i].seen)); }
+    int status[2];
+    for(i=0; i<2; i++) status[i] = HTreeTraverse((foint)(void*)&t[i], i ? flat : nested, Record);
+    assert(status[0] == 1 && status[1] == 1);
+    assert(t[0].n == n && t[1].n == n);
+    for(i=0; i<(int)n; i++) {
+	for(k=0; k<=DEPTH; k++) assert(t[0].seen[i][k] == t[1].seen[i][k]);
+	assert(_present[t[0].seen[i][0]][t[0].seen[i][1]][t[0].seen[i][2]]);
+	assert(_value[t[0].seen[i][0]][t[0].seen[i][1]][t[0].seen[i][2]] == t[0].seen[i][DEPTH]);
+    }
+    for(i=0; i<2; i++) Free(t[i].seen);
+    count = 0;
+    status[0] = HTreeTraverse((foint)(void*)&count, flat, StopAtTen);
+    assert(status[0] == 0 && count == 10);
+    HTreeFree(nested);
+    HTreeFree(flat);
+    puts("and so does traversal order");
+
+    int64_t live0, live;
+    MemProfEnable(1, "/dev/null");
+    MemProfTotals(NULL, NULL, NULL, &live0, NULL);
+    flat = HTreeAllocFlat(DEPTH, NULL, (pCmpFcn)strcmp, CopyString, FreeString, NULL, NULL);
+    char buf[DEPTH][20];
+    for(k=0; k<DEPTH; k++) keys[k].s = buf[k];
+    for(i=0; i<20000; i++) {
+	int sum = 0;
+	for(k=0; k<DEPTH; k++) { int v = RngInt(&r, 100, 120); sprintf(buf[k], "%d", v); sum += v; }
+	HTreeInsert(flat, keys, (foint)sum);
+	if(i % 3 == 0) HTreeDelete(flat, keys);
+	if(i % 1000 == 0) UnsafeHTreeLookDel(flat, keys, 1 + i/1000 % 2, true);
+    }
+    count = 0;
+    HTreeTraverse((foint)(void*)&count, flat, CheckStrings);
+    assert(count == flat->n && count > 0);
+    HTreeFree(flat);
+    MemProfTotals(NULL, NULL, NULL, &live, NULL);
+    MemProfDisable();
+    assert(live == live0);
+    puts("owned string keys: inserting, deleting, traversing and freeing leak nothing");
+    return 0;
+}
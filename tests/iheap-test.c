@@ -0,0 +1,178 @@
+// This software is part of github.com/waynebhayes/libwayne, and is Copyright(C) Wayne B. Hayes 2025, under the GNU LGPL 3.0
+// (GNU Lesser General Public License, version 3, 2007), a copy of which is contained at the top of the repo.
+/*
+** Check IHEAP against a brute-force array under random inserts, key changes, deletes and pops.
+** "iheap-test -b [n]" instead runs Dijkstra on a random graph of n nodes with IHEAP (decrease-key), HEAP and
+** LINKED_LIST (both inserting duplicates and skipping the stale ones), and compares the times.
+*/
+#include <time.h>
+#include "misc.h"
+#include "priority-queue.h"
+#include "heap.h"
+#include "linked-list.h"
+#include "rng.h"
+
+#define N 1000
+#define OPS 200000
+
+static double Now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + 1e-9*ts.tv_nsec;
+}
+
+// A random graph in compressed sparse row form: node u's edges are adj[first[u] .. first[u+1]-1].
+typedef struct { int n, *first, *adj; double *weight; } CSR;
+
+static CSR *RandomGraph(RNG *r, int n, int degree)
+{
+    CSR *G = Malloc(sizeof(CSR));
+    int u, e;
+    G->n = n;
+    G->first = Malloc((n+1)*sizeof(int));
+    G->adj = Malloc(n*degree*sizeof(int));
+    G->weight = Malloc(n*degree*sizeof(double));
+    for(u=0; u<=n; u++) G->first[u] = u*degree;
+    for(e=0; e<n*degree; e++) { G->adj[e] = RngInt(r, 0, n-1); G->weight[e] = RngUniform(r); }
+    return G;
+}
+
+static void DijkstraIHeap(CSR *G, double *dist)
+{
+    IHEAP *h = IHeapAlloc(G->n);
+    int u, e;
+    for(u=0; u<G->n; u++) dist[u] = HUGE_VAL;
+    dist[0] = 0;
+    IHeapInsert(h, 0, 0);
+    while(IHeapSize(h)) {
+	u = IHeapNext(h);
+	for(e=G->first[u]; e<G->first[u+1]; e++) {
+	    int v = G->adj[e];
+	    double d = dist[u] + G->weight[e];
+	    if(d < dist[v]) { dist[v] = d; IHeapInsertOrChange(h, v, d); }
+	}
+    }
+    IHeapFree(h);
+}
+
+// HEAP and LINKED_LIST hold foints, so each queued (distance, node) pair is a record they point at.
+typedef struct { double dist; int node; } RECORD;
+static RECORD *_records;
+static int _numRecords;
+static int CmpRecords(foint a, foint b)
+{
+    double x = _records[a.i].dist, y = _records[b.i].dist;
+    return (x > y) - (x < y);
+}
+
+static void DijkstraLazy(CSR *G, double *dist, Boolean linkedList)
+{
+    HEAP *h = linkedList ? NULL : HeapAlloc(G->n, CmpRecords, NULL);
+    LINKED_LIST *ll = linkedList ? LinkedListAlloc(CmpRecords, false) : NULL;
+    int u, e;
+    _records = Malloc((G->first[G->n]+1)*sizeof(RECORD));
+    _numRecords = 0;
+    for(u=0; u<G->n; u++) dist[u] = HUGE_VAL;
+#define PUSH(d,v) do { foint f; f.i = _numRecords; _records[_numRecords].dist = d; _records[_numRecords++].node = v; \
+	if(h) HeapInsert(h, f); else LinkedListInsert(ll, f); } while(0)
+    dist[0] = 0;
+    PUSH(0, 0);
+    while(h ? HeapSize(h) : LinkedListSize(ll)) {
+	RECORD *rec = &_records[(h ? HeapNext(h) : LinkedListPop(ll)).i];
+	u = rec->node;
+	if(rec->dist > dist[u]) continue; // stale duplicate
+	for(e=G->first[u]; e<G->first[u+1]; e++) {
+	    int v = G->adj[e];
+	    double d = dist[u] + G->weight[e];
+	    if(d < dist[v]) { dist[v] = d; PUSH(d, v); }
+	}
+    }
+#undef PUSH
+    if(h) HeapFree(h); else LinkedListFree(ll);
+    Free(_records);
+}
+
+static void Benchmark(int n)
+{
+    RNG r;
+    RngInit(&r, RNG_XOSHIRO, 42);
+    CSR *G = RandomGraph(&r, n, 8);
+    double *d1 = Malloc(n*sizeof(double)), *d2 = Malloc(n*sizeof(double)), t;
+    int u;
+    printf("Dijkstra on %d nodes, %d edges\n", n, 8*n);
+    t = Now(); DijkstraIHeap(G, d1); printf("  IHEAP decrease-key  %8.3f s\n", Now()-t);
+    t = Now(); DijkstraLazy(G, d2, false); printf("  HEAP duplicates     %8.3f s (%d inserts)\n", Now()-t, _numRecords);
+    for(u=0; u<n; u++) assert(d1[u] == d2[u]);
+    if(n <= 20000) {
+	t = Now(); DijkstraLazy(G, d2, true); printf("  LINKED_LIST         %8.3f s\n", Now()-t);
+	for(u=0; u<n; u++) assert(d1[u] == d2[u]);
+    }
+    else puts("  LINKED_LIST         (skipped: O(n) inserts; use n <= 20000)");
+}
+
+int main(int argc, char *argv[])
+{
+    static double key[N];
+    static Boolean in[N];
+    int op, i, size = 0;
+    RNG r;
+
+    if(argc > 1 && strcmp(argv[1], "-b") == 0) {
+	Benchmark(argc > 2 ? atoi(argv[2]) : 1000000);
+	return 0;
+    }
+
+    RngInit(&r, RNG_XOSHIRO, 1);
+    INDEXED_PRIORITY_QUEUE *h = IndexedPriorityQueueAlloc(N);
+    for(op=0; op<OPS; op++) {
+	int item = RngInt(&r, 0, N-1);
+	double k = RngInt(&r, -50, 50) / 4.0; // lots of ties, and negative keys
+	switch(RngInt(&r, 0, 3)) {
+	case 0: case 1:
+	    IHeapInsertOrChange(h, item, k);
+	    if(!in[item]) { in[item] = true; size++; }
+	    key[item] = k;
+	    break;
+	case 2:
+	    if(in[item]) { IHeapDelete(h, item); in[item] = false; size--; }
+	    break;
+	case 3:
+	    if(size) {
+		double min = HUGE_VAL;
+		for(i=0; i<N; i++) if(in[i] && key[i] < min) min = key[i];
+		assert(IHeapPeekKey(h) == min);
+		item = IHeapNext(h);
+		assert(in[item] && key[item] == min);
+		in[item] = false; size--;
+	    }
+	    break;
+	}
+	assert(IHeapSize(h) == size);
+	if(op % 1000 == 0) {
+	    IHeapSanityCheck(h);
+	    for(i=0; i<N; i++) assert(IHeapContains(h, i) == in[i] && (!in[i] || IHeapKey(h, i) == key[i]));
+	}
+    }
+    // drain it in order
+    double prev = -HUGE_VAL;
+    while(IHeapSize(h)) { double k = IHeapPeekKey(h); assert(k >= prev); prev = k; IHeapNext(h); }
+    IHeapFree(h);
+    puts("IHEAP agrees with brute force");
+
+    // unsigned keys, including ones that don't fit in a double
+    h = IHeapAlloc(3);
+    IHeapInsertU64(h, 0, ~(uint64_t)0); IHeapInsertU64(h, 1, ~(uint64_t)0 - 1); IHeapInsertU64(h, 2, 5);
+    IHeapChangeKeyU64(h, 2, ~(uint64_t)0 - 2);
+    int first = IHeapNext(h), second = IHeapNext(h), third = IHeapNext(h);
+    assert(first == 2 && second == 1 && third == 0);
+    IHeapFree(h);
+
+    // Dijkstra three ways on a small graph
+    CSR *G = RandomGraph(&r, 2000, 8);
+    double d1[2000], d2[2000], d3[2000];
+    DijkstraIHeap(G, d1); DijkstraLazy(G, d2, false); DijkstraLazy(G, d3, true);
+    for(i=0; i<G->n; i++) assert(d1[i] == d2[i] && d1[i] == d3[i]);
+    puts("Dijkstra with IHEAP, HEAP and LINKED_LIST agree");
+    return 0;
+}
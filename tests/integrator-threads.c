@@ -0,0 +1,221 @@
+// This software is part of github.com/waynebhayes/libwayne, and is Copyright(C) Wayne B. Hayes 2025, under the GNU LGPL 3.0
+// (GNU Lesser General Public License, version 3, 2007), a copy of which is contained at the top of the repo.
+/*
+** Integrate hundreds of independent systems at once on a small pool of threads, and check every final state is
+** bitwise identical to integrating them one at a time. Each system is a damped, driven oscillator whose
+** parameters ride along in Y (with zero derivative), since F_EVAL has no other way to tell systems apart; odd
+** systems are driven by -sin instead of sin, so calling another object's F shows up too.
+**
+** The wrappers around LSODE, DVERK, RDMETH78, DDRIV2 and the Numerical Recipes odeint (bsode) are tested
+** against stubs of those routines, defined below, that keep their state where the real ones do: LSODE's in a
+** COMMON block (saved and restored with SRCOM), odeint's in statics, and the rest's in the arrays they're
+** given. They step with an adaptive midpoint rule and now and then yield the CPU, so that even on one core
+** the threads interleave, and a wrapper that didn't swap the COMMON block, didn't keep its trampoline's
+** object per thread, or didn't serialize odeint would give wrong answers. The stubs can't tell you whether
+** your LSODE's SRCOM saves everything it needs to; set HAVE_FORTRAN_INTEGRATORS to test the real routines
+** instead (you'll need to link their Fortran and Numerical Recipes libraries). ldbsode is bsode's code with
+** long doubles, and isn't tested separately.
+*/
+#include <pthread.h>
+#include "misc.h"
+#include "rk4.h"
+#include "rk4s.h"
+#include "rk12.h"
+#include "rk23.h"
+#include "lsode.h"
+#include "dverk.h"
+#include "rkd78.h"
+#include "ddriv2.h"
+#include "bsode.h"
+#ifndef HAVE_FORTRAN_INTEGRATORS
+#define HAVE_FORTRAN_INTEGRATORS 0
+#endif
+
+#define SYSTEMS 300
+#define THREADS 8
+#define N 4 // x, v, damping, frequency
+#define TOUT 10.0
+#define OUTPUTS 5 // intermediate TOUTs, to exercise resuming each object
+
+void Oscillator(int n, double t, double *y, double *ydot)
+{
+    assert(n == N);
+    ydot[0] = y[1];
+    ydot[1] = -y[2]*y[1] - y[3]*y[3]*y[0] + sin(t);
+    ydot[2] = ydot[3] = 0;
+}
+
+void ReverseOscillator(int n, double t, double *y, double *ydot)
+{
+    Oscillator(n, t, y, ydot);
+    ydot[1] -= 2*sin(t);
+}
+
+#if !HAVE_FORTRAN_INTEGRATORS
+#include <sched.h>
+#define STUB_H0 0.01
+#define STUB_TOL 1e-3 // error per step; the stubs ignore the tolerances they're given
+
+typedef void (*FORT_F_EVAL)(int*, double*, double*, double*);
+
+// The derivatives, from whichever kind of F we have
+static void Deriv(FORT_F_EVAL fortF, F_EVAL f, int n, double t, double *y, double *ydot)
+{
+    if(fortF) fortF(&n, &t, y, ydot);
+    else f(n, t, y, ydot);
+}
+
+// Integrate from *t to tout with midpoint steps of adaptive size *h, using the difference from Euler as the error.
+static void StubIntegrate(FORT_F_EVAL fortF, F_EVAL f, int n, double *t, double *y, double tout, double *h)
+{
+    static __thread unsigned steps;
+    double k1[N], k2[N], mid[N];
+    int i;
+    assert(n == N);
+    while(*t < tout) {
+	Boolean last = *h >= tout - *t;
+	double step = last ? tout - *t : *h, err = 0;
+	Deriv(fortF, f, n, *t, y, k1);
+	for(i=0; i<n; i++) mid[i] = y[i] + step/2*k1[i];
+	Deriv(fortF, f, n, *t + step/2, mid, k2);
+	for(i=0; i<n; i++) { err = MAX(err, fabs(step*(k2[i] - k1[i]))); y[i] += step*k2[i]; }
+	*t = last ? tout : *t + step;
+	*h *= err > 0 ? MIN(5, MAX(0.2, 0.9*sqrt(STUB_TOL/err))) : 5;
+	if(++steps % 16 == 0) sched_yield(); // let another thread in now and then, even on one core
+    }
+}
+
+static struct { double h; } _ls0001; // LSODE's COMMON block
+
+void srcom_(double *RSAV, int *ISAV, int *JOB)
+{
+    if(*JOB == 1) RSAV[0] = _ls0001.h;
+    else _ls0001.h = RSAV[0];
+}
+
+void lsode_(FORT_F_EVAL F, int *NEQ, double *Y, double *T, double *tout, int *ITOL, double *RTOL, double *ATOL,
+    int *ITASK, int *ISTATE, int *IOPT, double *RWORK, int *LRW, int *IWORK, int *LIW, FORT_F_EVAL JAC, int *MF)
+{
+    if(*ISTATE == 1) _ls0001.h = STUB_H0;
+    StubIntegrate(F, NULL, *NEQ, T, Y, *tout, &_ls0001.h);
+    *ISTATE = 2;
+}
+
+// DVERK and RDMETH78 keep their step size in C, DDRIV2 in WORK
+void dverk_(int *n, FORT_F_EVAL FCN, double *X, double *Y, double *XEND, double *TOL, int *IND, double *C,
+    int *NW, double *W)
+{
+    if(*IND == 1) C[0] = STUB_H0;
+    StubIntegrate(FCN, NULL, *n, X, Y, *XEND, &C[0]);
+    *IND = 3;
+}
+
+void rdmeth78_(int *n, FORT_F_EVAL FCN, double *X, double *Y, double *XEND, double *TOL, int *IND, double *C,
+    int *NW, double *W)
+{
+    dverk_(n, FCN, X, Y, XEND, TOL, IND, C, NW, W);
+}
+
+void ddriv2_(int *n, double *T, double *Y, FORT_F_EVAL F, double *tout, int *MSTATE, int *NROOT, double *EPS,
+    double *EWT, int *MINT, double *WORK, int *LENW, int *IWORK, int *LENIW, void *G)
+{
+    if(*MSTATE == 1) WORK[0] = STUB_H0;
+    StubIntegrate(F, NULL, *n, T, Y, *tout, &WORK[0]);
+    *MSTATE = 2;
+}
+
+// Like Numerical Recipes' odeint, this one works on copies of everything in statics
+static double _odeintY[N], _odeintX, _odeintH;
+
+int odeint(double ystart[], int nvar, double *x1, double x2, double eps, double h1, double hmin, int *nok,
+    int *nbad, void (*derivs)(int, double, double[], double[]),
+    int (*step)(double[], double[], int, double*, double, double, double[], double*, double*,
+	void (*)(int, double, double[], double[])))
+{
+    assert(nvar == N);
+    memcpy(_odeintY, ystart, sizeof(_odeintY));
+    _odeintX = *x1;
+    _odeintH = MIN(h1, STUB_H0);
+    StubIntegrate(NULL, derivs, nvar, &_odeintX, _odeintY, x2, &_odeintH);
+    memcpy(ystart, _odeintY, sizeof(_odeintY));
+    *x1 = _odeintX;
+    *nok = *nbad = 0;
+    return 0;
+}
+
+int bsstep(double y[], double dydx[], int nv, double *xx, double htry, double eps, double yscal[], double *hdid,
+    double *hnext, void (*derivs)(int, double, double*, double*))
+{
+    Fatal("bsstep: the stub odeint doesn't call it");
+    return 1;
+}
+#endif
+
+typedef void *(*pAlloc)(int n, double t, double *y, F_EVAL f, int stiff_flag, double eps, double zero);
+typedef double (*pIntegrate)(void *integrator, double tout);
+typedef void (*pFree)(void *integrator);
+
+static void Rk12FreeFn(void *r) { Rk12Free(r); }
+static void Rk23FreeFn(void *r) { Rk23Free(r); }
+
+static struct {
+    const char *name;
+    pAlloc Alloc; pIntegrate Integrate; pFree Free;
+    double eps, zero; // the last two Alloc arguments: for the RK methods, the (initial) timestep and tolerance
+} _integrator[] = {
+    {"rk4",  (pAlloc)Rk4Alloc,  (pIntegrate)Rk4Integrate,  (pFree)Rk4Free,  1e-3, 0},
+    {"rk4s", (pAlloc)Rk4sAlloc, (pIntegrate)Rk4sIntegrate, (pFree)Rk4sFree, 1e-3, 0},
+    {"rk12", (pAlloc)Rk12Alloc, (pIntegrate)Rk12Integrate, Rk12FreeFn,      1e-2, 1e-9},
+    {"rk23", (pAlloc)Rk23Alloc, (pIntegrate)Rk23Integrate, Rk23FreeFn,      1e-2, 1e-9},
+    {"lsode",  (pAlloc)LsodeAlloc,  (pIntegrate)LsodeIntegrate,  (pFree)LsodeFree,  1e-8, 0},
+    {"dverk",  (pAlloc)DverkAlloc,  (pIntegrate)DverkIntegrate,  (pFree)DverkFree,  1e-8, 0},
+    {"rkd78",  (pAlloc)Rkd78Alloc,  (pIntegrate)Rkd78Integrate,  (pFree)Rkd78Free,  1e-8, 0},
+    {"ddriv2", (pAlloc)Ddriv2Alloc, (pIntegrate)Ddriv2Integrate, (pFree)Ddriv2Free, 1e-8, 0},
+    {"bsode",  (pAlloc)BsodeAlloc,  (pIntegrate)BsodeIntegrate,  (pFree)BsodeFree,  1e-8, 0},
+};
+#define NUM_INTEGRATORS (sizeof(_integrator)/sizeof(_integrator[0]))
+
+static int _which; // index into _integrator[]
+static double _serial[SYSTEMS][N], _parallel[SYSTEMS][N];
+static int _next; // next system for a worker to take
+
+static void InitialState(int s, double y[N])
+{
+    y[0] = 1 + s/(double)SYSTEMS; y[1] = 0;
+    y[2] = 0.1 + 0.5*(s%7)/7.0; y[3] = 1 + (s%13)/13.0;
+}
+
+// Integrate system s, stopping at a few intermediate times so the integrator is resumed in between.
+static void Integrate(int s, double y[N])
+{
+    int k;
+    InitialState(s, y);
+    void *integ = _integrator[_which].Alloc(N, 0, y, s % 2 ? ReverseOscillator : Oscillator, 0, _integrator[_which].eps, _integrator[_which].zero);
+    for(k=1; k<=OUTPUTS; k++) _integrator[_which].Integrate(integ, TOUT*k/OUTPUTS);
+    _integrator[_which].Free(integ);
+}
+
+static void *Worker(void *arg)
+{
+    int s;
+    while((s = __sync_fetch_and_add(&_next, 1)) < SYSTEMS)
+	Integrate(s, _parallel[s]);
+    return arg;
+}
+
+int main(void)
+{
+    int s, t;
+    pthread_t thread[THREADS];
+    for(_which=0; _which < NUM_INTEGRATORS; _which++) {
+	for(s=0; s<SYSTEMS; s++) Integrate(s, _serial[s]);
+	_next = 0;
+	for(t=0; t<THREADS; t++) pthread_create(&thread[t], NULL, Worker, NULL);
+	for(t=0; t<THREADS; t++) pthread_join(thread[t], NULL);
+	int differ = 0;
+	for(s=0; s<SYSTEMS; s++) if(memcmp(_serial[s], _parallel[s], sizeof(_serial[s])) != 0) ++differ;
+	printf("%-6s %d systems on %d threads: %d differ from serial\n", _integrator[_which].name, SYSTEMS, THREADS, differ);
+	assert(differ == 0);
+    }
+    return 0;
+}
@@ -0,0 +1,117 @@
+// This software is part of github.com/waynebhayes/libwayne, and is Copyright(C) Wayne B. Hayes 2025, under the GNU LGPL 3.0
+// (GNU Lesser General Public License, version 3, 2007), a copy of which is contained at the top of the repo.
+/*
+** Check the allocation profiler's totals (exact), call-site counts (exact with period 1, estimates otherwise),
+** size histograms, threads, and the report on SIGUSR1.  "mem-prof -b" instead times Malloc/Free pairs
+** with the profiler off and on.
+*/
+#include <time.h>
+#include <signal.h>
+#include <pthread.h>
+#include "misc.h"
+#include "mem-prof.h"
+
+#define NUM 1000
+#define NUM_THREADS 4
+
+static double Now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + 1e-9*ts.tv_nsec;
+}
+
+static char *ReportContaining(const char *what)
+{
+    static char buf[1<<16];
+    FILE *fp = tmpfile();
+    MemProfReport(fp);
+    rewind(fp);
+    size_t n = fread(buf, 1, sizeof(buf)-1, fp);
+    buf[n] = '\0';
+    fclose(fp);
+    return strstr(buf, what);
+}
+
+static void *Thread(void *arg)
+{
+    int i;
+    for(i=0; i<NUM; i++) Free(Malloc(1000));
+    return NULL;
+}
+
+static void Benchmark(void)
+{
+    const long n = 10000000;
+    const unsigned period[] = {0, 1, 1000};
+    long i;
+    int p;
+    for(p=0; p<3; p++) {
+	if(period[p]) MemProfEnable(period[p], "/dev/null"); else MemProfDisable();
+	double t = Now();
+	for(i=0; i<n; i++) Free(Malloc(32 + (i & 63)));
+	if(period[p]) printf("profiling 1 in %-4u", period[p]); else printf("no profiling      ");
+	printf(" %6.1f ns per Malloc/Free pair\n", (Now()-t)/n*1e9);
+    }
+    MemProfDisable();
+}
+
+int main(int argc, char *argv[])
+{
+    static void *p[100*NUM];
+    uint64_t allocs0, frees0, bytes0, allocs, frees, bytes;
+    int64_t live0, live, peak;
+    int i;
+
+    if(argc > 1 && strcmp(argv[1], "-b") == 0) {
+	Benchmark();
+	return 0;
+    }
+
+    MemProfEnable(1, "/dev/null");
+    MemProfTotals(&allocs0, &frees0, &bytes0, &live0, NULL);
+    for(i=0; i<NUM; i++) p[i] = Malloc(100);
+    MemProfTotals(&allocs, &frees, &bytes, &live, &peak);
+    assert(allocs - allocs0 == NUM && frees == frees0 && bytes - bytes0 == 100*NUM);
+    assert(live - live0 >= 100*NUM && peak >= live);
+    assert(ReportContaining(" 1000 calls") && ReportContaining(" 7:1000")); // 100 bytes is in [64,128)
+    for(i=0; i<NUM; i++) Free(p[i]);
+    MemProfTotals(&allocs, &frees, &bytes, &live, NULL);
+    assert(frees - frees0 == NUM && live == live0);
+    puts("totals, call sites and histograms are exact with period 1");
+
+    MemProfEnable(100, "/dev/null");
+    MemProfTotals(&allocs0, NULL, NULL, NULL, NULL);
+    for(i=0; i<100*NUM; i++) p[i] = Calloc(1, 24);
+    MemProfTotals(&allocs, NULL, NULL, NULL, NULL);
+    assert(allocs - allocs0 == 100*NUM);
+    for(i=0; i<100*NUM; i++) Free(p[i]);
+    char *line = ReportContaining(" 5:"); // 24 bytes is in [16,32)
+    assert(line);
+    while(line[-1] != '\n') --line;
+    long est = atol(strstr(line, "bytes") + 6);
+    assert(80*NUM < est && est < 120*NUM); // from about 1000 samples, so the standard error is about 3%
+    puts("sampled call sites are estimated to within 20%");
+
+    MemProfTotals(&allocs0, &frees0, NULL, &live0, NULL);
+    pthread_t thread[NUM_THREADS];
+    for(i=0; i<NUM_THREADS; i++) pthread_create(&thread[i], NULL, Thread, NULL);
+    for(i=0; i<NUM_THREADS; i++) pthread_join(thread[i], NULL);
+    MemProfTotals(&allocs, &frees, NULL, &live, NULL);
+    assert(allocs - allocs0 == NUM_THREADS*NUM && frees - frees0 == NUM_THREADS*NUM && live == live0);
+    puts("counts from threads that have exited are all there");
+
+    char name[] = "/tmp/mem-prof-XXXXXX";
+    close(mkstemp(name));
+    MemProfEnable(1, name);
+    raise(SIGUSR1);
+    Free(Malloc(1)); // the report is written at the next sample
+    FILE *fp = fopen(name, "r");
+    char buf[BUFSIZ];
+    assert(fgets(buf, sizeof(buf), fp) && strncmp(buf, "Memory profile", 14) == 0);
+    fclose(fp);
+    unlink(name);
+    puts("SIGUSR1 writes a report");
+    MemProfDisable(); // no report at exit
+    return 0;
+}
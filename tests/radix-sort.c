@@ -0,0 +1,93 @@
+// This software is part of github.com/waynebhayes/libwayne, and is Copyright(C) Wayne B. Hayes 2025, under the GNU LGPL 3.0
+// (GNU Lesser General Public License, version 3, 2007), a copy of which is contained at the top of the repo.
+// Check the radix sorts, ParallelSort and SORT_INLINE_DEFINE against qsort.
+#include "misc.h"
+#include "sorts.h"
+#include "rng.h"
+
+#define MAXN 300000
+static const size_t _sizes[] = {0, 1, 2, 17, 255, 256, 1000, 70000, MAXN};
+#define NUM_SIZES (sizeof(_sizes)/sizeof(_sizes[0]))
+
+static int CmpU32(const void *x, const void *y) { uint32_t a = *(uint32_t*)x, b = *(uint32_t*)y; return (a>b)-(a<b); }
+static int CmpU64(const void *x, const void *y) { uint64_t a = *(uint64_t*)x, b = *(uint64_t*)y; return (a>b)-(a<b); }
+static int CmpDouble(const void *x, const void *y) { double a = *(double*)x, b = *(double*)y; return (a>b)-(a<b); }
+static int CmpFloat(const void *x, const void *y) { float a = *(float*)x, b = *(float*)y; return (a>b)-(a<b); }
+
+typedef struct { uint32_t u, v; } EDGE;
+static int CmpEdge(const void *x, const void *y) {
+    const EDGE *a = x, *b = y;
+    if(a->u != b->u) return (a->u > b->u) - (a->u < b->u);
+    return (a->v > b->v) - (a->v < b->v);
+}
+#define EDGE_LESS(x,y) ((x).u < (y).u || ((x).u == (y).u && (x).v < (y).v))
+SORT_INLINE_DEFINE(EdgeSort, EDGE, EDGE_LESS)
+
+int main(void)
+{
+    static uint32_t a32[MAXN], b32[MAXN], p32[MAXN];
+    static uint64_t a64[MAXN], b64[MAXN], p64[MAXN];
+    static double ad[MAXN], bd[MAXN];
+    static float af[MAXN], bf[MAXN];
+    static EDGE ae[MAXN], be[MAXN];
+    RNG r;
+    int k, range;
+    size_t i;
+    RngInit(&r, RNG_XOSHIRO, 1);
+
+    for(k=0; k<NUM_SIZES; k++) for(range=0; range<3; range++) {
+	const size_t n = _sizes[k];
+	// small ranges exercise duplicates and skipped bytes; range 2 is the full width
+	const uint64_t mask = range == 0 ? 0xF : range == 1 ? 0xFFFFF : ~(uint64_t)0;
+	for(i=0; i<n; i++) {
+	    a32[i] = b32[i] = RngNext64(&r) & mask;
+	    a64[i] = b64[i] = RngNext64(&r) & mask;
+	    ad[i] = bd[i] = (RngUniform(&r) - 0.5) * (range == 2 ? 1e300 : 10);
+	    af[i] = bf[i] = RngNormal(&r);
+	    ae[i].u = be[i].u = a32[i]; ae[i].v = be[i].v = RngNext32(&r) & 7;
+	}
+	if(n > 3) { ad[0] = bd[0] = -0.0; ad[1] = bd[1] = 1.0/0.0; af[2] = bf[2] = -1.0/0.0; }
+	qsort(b32, n, sizeof(b32[0]), CmpU32);
+	qsort(b64, n, sizeof(b64[0]), CmpU64);
+	qsort(bd, n, sizeof(bd[0]), CmpDouble);
+	qsort(bf, n, sizeof(bf[0]), CmpFloat);
+	qsort(be, n, sizeof(be[0]), CmpEdge);
+
+	// pairs: the payload is the original index, so stability means payloads of equal keys are increasing
+	for(i=0; i<n; i++) { p32[i] = i; p64[i] = i; }
+	memcpy(ae, ae, 0);
+	uint32_t *k32 = Malloc(n*sizeof(uint32_t)); uint64_t *k64 = Malloc(n*sizeof(uint64_t)); // exactly n, so reads past it show up
+	memcpy(k32, a32, n*sizeof(uint32_t)); memcpy(k64, a64, n*sizeof(uint64_t));
+	RadixSortU32Pairs(k32, p32, n);
+	RadixSortU64Pairs(k64, p64, n);
+	for(i=0; i<n; i++) {
+	    assert(k32[i] == b32[i] && a32[p32[i]] == k32[i]);
+	    assert(k64[i] == b64[i] && a64[p64[i]] == k64[i]);
+	    if(i > 0 && k32[i] == k32[i-1]) assert(p32[i] > p32[i-1]);
+	    if(i > 0 && k64[i] == k64[i-1]) assert(p64[i] > p64[i-1]);
+	}
+
+	memcpy(k32, a32, n*sizeof(uint32_t)); memcpy(k64, a64, n*sizeof(uint64_t));
+	RadixSortInPlaceU32(k32, n);
+	RadixSortInPlaceU64(k64, n);
+	for(i=0; i<n; i++) assert(k32[i] == b32[i] && k64[i] == b64[i]);
+	Free(k32); Free(k64);
+
+	RadixSortU32(a32, n);
+	RadixSortU64(a64, n);
+	RadixSortDouble(ad, n);
+	RadixSortFloat(af, n);
+	for(i=0; i<n; i++) assert(a32[i] == b32[i] && a64[i] == b64[i] && ad[i] == bd[i] && af[i] == bf[i]);
+
+	EDGE *e = Malloc((n+1)*sizeof(EDGE));
+	memcpy(e, ae, n*sizeof(EDGE));
+	EdgeSort(e, n);
+	for(i=0; i<n; i++) assert(e[i].u == be[i].u && e[i].v == be[i].v);
+	ParallelSortThreads = 1 + k%4; // fixed, so the threaded path is tested whatever the machine
+	ParallelSort(ae, n, sizeof(EDGE), CmpEdge);
+	for(i=0; i<n; i++) assert(ae[i].u == be[i].u && ae[i].v == be[i].v);
+	Free(e);
+    }
+    printf("radix, inline and parallel sorts agree with qsort on %d sizes up to %d\n", (int)NUM_SIZES, MAXN);
+    return 0;
+}
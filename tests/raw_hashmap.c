@@ -13,10 +13,10 @@
 #define RAW_HASHMAP_OK 0
 */
 
-int PrintHashEntry(int key, any_t data)
+int PrintHashEntry(int64_t key, any_t data)
 {
     char *s=(char*)data;
-    printf("entry %d is \"%s\"\n", key, s);
+    printf("entry %d is \"%s\"\n", (int)key, s);
     return RAW_HASHMAP_OK;
 }
 
@@ -0,0 +1,76 @@
+// This software is part of github.com/waynebhayes/libwayne, and is Copyright(C) Wayne B. Hayes 2025, under the GNU LGPL 3.0
+// (GNU Lesser General Public License, version 3, 2007), a copy of which is contained at the top of the repo.
+/*
+** Dense output and root finding for RK23, on y'' = -y, y(0)=1, y'(0)=0, whose solution is cos(t).
+*/
+#include "misc.h"
+#include "rk23.h"
+
+#define TOUT 20.0
+#define NOUT 100000
+#define TOL 1e-6
+
+static long _nEval;
+
+static void F(int n, double t, double *y, double *ydot)
+{
+    assert(n == 2);
+    ydot[0] = y[1];
+    ydot[1] = -y[0];
+    ++_nEval;
+}
+
+static double G(int n, double t, double *y, int i)
+{
+    assert(i == 0);
+    return y[0]; // zero at pi/2 + k*pi
+}
+
+int main(void)
+{
+    static double tout[NOUT], yout[2*NOUT];
+    double y[2] = {1, 0}, maxErr = 0;
+    RK23 *r;
+    int k;
+
+    for(k=0; k<NOUT; k++) tout[k] = (k+1)*TOUT/NOUT;
+
+    // one call to Rk23Integrate per output time
+    _nEval = 0;
+    r = Rk23Alloc(2, 0, y, F, 0, 0.01, TOL);
+    for(k=0; k<NOUT; k++) Rk23Integrate(r, tout[k]);
+    Rk23Free(r);
+    long repeated = _nEval;
+
+    // the same outputs from dense output
+    y[0] = 1; y[1] = 0;
+    _nEval = 0;
+    r = Rk23Alloc(2, 0, y, F, 0, 0.01, TOL);
+    int got = Rk23IntegrateDense(r, NOUT, tout, yout);
+    assert(got == NOUT);
+    assert(r->T == TOUT && y[0] == yout[2*(NOUT-1)]);
+    Rk23Free(r);
+    for(k=0; k<NOUT; k++) maxErr = MAX(maxErr, fabs(yout[2*k] - cos(tout[k])));
+    assert(maxErr < 1e-5);
+    assert(10*_nEval < repeated);
+    puts("dense output is accurate and needs a tenth of the evaluations");
+
+    // stop at each zero of y, and carry on from there
+    y[0] = 1; y[1] = 0;
+    r = Rk23Alloc(2, 0, y, F, 0, 0.01, TOL);
+    Rk23PrepRoot(r, 1, G);
+    int done = 0, roots = 0;
+    while(done < NOUT) {
+	done += Rk23IntegrateDense(r, NOUT - done, tout + done, yout + 2*done);
+	if(done < NOUT) {
+	    assert(Rk23WhichRoot(r) == 0);
+	    assert(fabs(r->T - (M_PI/2 + roots*M_PI)) < 1e-6 && fabs(y[0]) < 1e-6);
+	    ++roots;
+	}
+    }
+    assert(roots == 6 && r->T == TOUT);
+    for(k=0; k<NOUT; k++) assert(fabs(yout[2*k] - cos(tout[k])) < 1e-5);
+    Rk23Free(r);
+    printf("found all %d zeros of cos(t) for 0 < t < %g\n", roots, TOUT);
+    return 0;
+}
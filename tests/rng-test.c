@@ -0,0 +1,82 @@
+// This software is part of github.com/waynebhayes/libwayne, and is Copyright(C) Wayne B. Hayes 2025, under the GNU LGPL 3.0
+// (GNU Lesser General Public License, version 3, 2007), a copy of which is contained at the top of the repo.
+#include "misc.h"
+#include "rng.h"
+
+#define N 100000
+
+int main(void) {
+    RNG r, s;
+    uint64_t x64[4];
+    uint32_t x32[4];
+    int i;
+
+    // known answers: xoshiro256** from state {1,2,3,4}, and Philox4x32-10 with key and counter 0 (Random123's kat_vectors)
+    r.type = RNG_XOSHIRO; r.haveNormal = false;
+    r.u.s[0]=1; r.u.s[1]=2; r.u.s[2]=3; r.u.s[3]=4;
+    for(i=0;i<3;i++) x64[i] = RngNext64(&r); // (and not in the assert, so they run with -DNDEBUG too)
+    assert(x64[0] == 11520 && x64[1] == 0 && x64[2] == 1509978240);
+    RngInit(&r, RNG_PHILOX, 0);
+    r.u.philox.key[0] = r.u.philox.key[1] = 0;
+    for(i=0;i<4;i++) x32[i] = RngNext32(&r);
+    assert(x32[0] == 0x6627e8d5 && x32[1] == 0xe169c58d && x32[2] == 0xbc57ac4c && x32[3] == 0x9b00dbd8);
+    puts("known answers ok");
+
+    RNG_TYPE type;
+    for(type = RNG_XOSHIRO; type <= RNG_PHILOX; type++) {
+	const char *name = (type == RNG_XOSHIRO ? "xoshiro" : "philox");
+	static double bulk[N], one[N];
+
+	// bulk uniforms match one at a time, and skipping lands where generating would
+	RngInit(&r, type, 42); RngInit(&s, type, 42);
+	RngNext32(&r); RngNext32(&s); // start part way into a Philox block
+	RngUniformBulk(&r, bulk, N);
+	for(i=0;i<N;i++) one[i] = RngUniform(&s);
+	for(i=0;i<N;i++) assert(bulk[i] == one[i]);
+	for(i=0; i<1003; i++) RngNext32(&r);
+	RngSkip(&s, 1003);
+	x64[0] = RngNext64(&r); x64[1] = RngNext64(&s);
+	assert(x64[0] == x64[1]);
+
+	// streams are reproducible and distinct
+	RNG *streams = RngStreams(type, 7, 3), *again = RngStreams(type, 7, 3);
+	for(i=0;i<3;i++) { x64[i] = RngNext64(&streams[i]); assert(x64[i] == RngNext64(&again[i])); }
+	assert(x64[0] != x64[1] && x64[1] != x64[2]);
+	RngFree(streams); RngFree(again);
+
+	// RngInt stays in range and hits both ends
+	Boolean sawMin = false, sawMax = false;
+	for(i=0;i<N;i++) {
+	    long k = RngInt(&r, -3, 3);
+	    assert(-3 <= k && k <= 3);
+	    if(k == -3) sawMin = true;
+	    if(k == 3) sawMax = true;
+	}
+	assert(sawMin && sawMax);
+
+	// moments: uniform mean 1/2 var 1/12; normal mean 0 var 1, and bulk normals match one at a time
+	double sum=0, sumSq=0;
+	for(i=0;i<N;i++) { sum += bulk[i]; sumSq += bulk[i]*bulk[i]; }
+	assert(fabs(sum/N - 0.5) < 0.01 && fabs(sumSq/N - sum*sum/N/N - 1/12.0) < 0.01);
+	sum = sumSq = 0;
+	s = r;
+	RngNormal(&r); // leaves a spare, which the bulk call must use first
+	RngNormal(&s);
+	RngNormalBulk(&r, bulk, N-1); // odd, to exercise the leftover
+	for(i=0;i<N-1;i++) { double x = RngNormal(&s); assert(bulk[i] == x); sum += x; sumSq += x*x; }
+	assert(fabs(sum/N) < 0.02 && fabs(sumSq/N - 1) < 0.02);
+	printf("%s ok\n", name);
+    }
+
+    // Stream48-style interface
+    RngStreamInit(RNG_PHILOX, 2, 1);
+    int prev = RngStream(1);
+    assert(prev == 0 && RngStreamWhich() == 1);
+    double x = RngStreamRand();
+    assert(0 < x && x < 1);
+    long k = RngStreamRandInt(10, 20);
+    assert(10 <= k && k <= 20);
+    RngStream(0);
+    puts("streams ok");
+    return 0;
+}
@@ -0,0 +1,97 @@
+// This software is part of github.com/waynebhayes/libwayne, and is Copyright(C) Wayne B. Hayes 2025, under the GNU LGPL 3.0
+// (GNU Lesser General Public License, version 3, 2007), a copy of which is contained at the top of the repo.
+#include <unistd.h>
+#include <fcntl.h>
+#include "misc.h"
+#include "sim_anneal.h"
+#include "rand48.h"
+
+// DUMB SORT again (see sim_anneal.c), from a schedule that's far too hot and decays far too little, to check that
+// adaptive mode pulls the observed pBad onto the log-linear target from pBadStart to pBadEnd anyway: after the
+// first tenth of the run, the mean pBad seen at every percent must be within a factor TOLERANCE of the target.
+// Without adaptive mode, the same schedule must miss by more.
+
+#define N 30UL
+#define MAX_ITERS 2000000UL
+#define PBAD_START 0.3
+#define PBAD_END 1e-3
+#define TOLERANCE 3.0 // it's usually within 2
+
+int _array[N];
+
+static double ScoreLocal(const int i) {
+    int j;
+    double sum=0;
+    for(j=0;j<N;j++) {
+	Boolean bad = false;
+	if(j<i) { if(_array[j] > _array[i]) bad=true; }
+	else { if(_array[j] < _array[i]) bad=true; }
+	if(bad) sum += fabs((_array[i]-_array[j])*1.0*(j-i));
+    }
+    return sum;
+}
+double Score(Boolean global, const foint f) {
+    int i;
+    double sum=0;
+    for(i=0;i<N;i++) sum+= ScoreLocal(i);
+    return sum;
+}
+
+static int _swap1=-1, _swap2=-1;
+
+double SwapElements(const foint f) {
+    assert(_swap1<0 && _swap2<0);
+    _swap1 = N*drand48();
+    do _swap2 = N*drand48(); while(_swap1==_swap2);
+    double before=ScoreLocal(_swap1) + ScoreLocal(_swap2);
+    int tmp = _array[_swap1]; _array[_swap1]=_array[_swap2]; _array[_swap2]=tmp;
+    double after =ScoreLocal(_swap1) + ScoreLocal(_swap2);
+    return (after-before);
+}
+
+Boolean AcceptReject(Boolean accept, const foint f) {
+    assert(_swap1>=0 && _swap2>=0);
+    if(!accept) { int tmp = _array[_swap1]; _array[_swap1]=_array[_swap2]; _array[_swap2]=tmp; }
+    _swap1 = _swap2 = -1;
+    return accept;
+}
+
+static SIM_ANNEAL *_sa;
+static double _worst; // the largest factor by which the observed pBad has missed the target
+
+// Called at every percent of the run
+static void Compare(int iter, foint f) {
+    if(iter < MAX_ITERS/10) return; // give it time to find the target, and fill the pBad buffer
+    double target = PBAD_START * pow(PBAD_END / PBAD_START, 1.0*iter/MAX_ITERS);
+    double observed = _sa->pBadSum / _sa->pBadBufLen;
+    double miss = observed > target ? observed/target : target/observed;
+    if(miss > _worst) _worst = miss;
+}
+
+// The worst miss of a run from the bad schedule, adaptive or not
+static double Run(Boolean adaptive) {
+    int i;
+    srand48(1);
+    for(i=0;i<N;i++) _array[i] = drand48()*N;
+    _sa = SimAnnealAlloc(-1, (foint)(void*)_array, SwapElements, Score, AcceptReject, MAX_ITERS, PBAD_START, PBAD_END, Compare);
+    SimAnnealSetSchedule(_sa, 1000, 1);
+    SimAnnealSetAdaptive(_sa, adaptive);
+    _worst = 1;
+    // SimAnnealRun prints its progress (and, since this Move's deltas aren't exact, notes about it), whose
+    // digits depend on the compiler's rounding, so hide it
+    int out = dup(1), err = dup(2), null = open("/dev/null", O_WRONLY);
+    fflush(stdout); fflush(stderr); dup2(null, 1); dup2(null, 2);
+    SimAnnealRun(_sa);
+    fflush(stdout); fflush(stderr); dup2(out, 1); dup2(err, 2);
+    close(null); close(out); close(err);
+    SimAnnealFree(_sa);
+    return _worst;
+}
+
+int main(void) {
+    double adaptive = Run(true), fixed = Run(false);
+    if(adaptive > TOLERANCE || fixed <= TOLERANCE)
+	Fatal("pBad missed the target by up to a factor of %g adaptively, %g with the fixed schedule", adaptive, fixed);
+    printf("adaptive pBad stays within a factor of %g of the target; the fixed schedule doesn't\n", TOLERANCE);
+    return 0;
+}
@@ -0,0 +1,88 @@
+// This software is part of github.com/waynebhayes/libwayne, and is Copyright(C) Wayne B. Hayes 2025, under the GNU LGPL 3.0
+// (GNU Lesser General Public License, version 3, 2007), a copy of which is contained at the top of the repo.
+#include "misc.h"
+#include "sim_anneal.h"
+#include "rand48.h"
+
+// DUMB SORT again (see sim_anneal.c), but by parallel tempering: each replica runs on its own thread,
+// so all the state that sim_anneal.c keeps in globals lives in the solution instead.
+
+#define N 10
+#define REPLICAS 4
+
+typedef struct _sortSol {
+    int array[N];
+    int swap1, swap2; // -1 means "not currently assigned"
+    unsigned short rng[3];
+} SORT_SOL;
+
+static double ScoreLocal(const SORT_SOL *s, const int i) {
+    int j;
+    double sum=0;
+    for(j=0;j<N;j++) {
+	Boolean bad = false;
+	if(j<i) { // we WANT a[j] < a[i]
+	    if(s->array[j] > s->array[i]) bad=true;
+	} else { // j>i so we WANT a[j]>a[i]
+	    if(s->array[j] < s->array[i]) bad=true;
+	}
+	if(bad) sum += fabs((s->array[i]-s->array[j])*1.0*(j-i));
+    }
+    return sum;
+}
+double Score(Boolean global, const foint f) {
+    SORT_SOL *s = f.v;
+    int i;
+    double sum=0;
+    for(i=0;i<N;i++) sum+= ScoreLocal(s, i);
+    return sum;
+}
+
+double SwapElements(const foint f) {
+    SORT_SOL *s = f.v;
+    assert(s->swap1<0 && s->swap2<0);
+    s->swap1 = N*erand48(s->rng);
+    do s->swap2 = N*erand48(s->rng); while(s->swap1==s->swap2);
+    double before=ScoreLocal(s, s->swap1) + ScoreLocal(s, s->swap2);
+    int tmp = s->array[s->swap1]; s->array[s->swap1]=s->array[s->swap2]; s->array[s->swap2]=tmp;
+    double after =ScoreLocal(s, s->swap1) + ScoreLocal(s, s->swap2);
+    return (after-before);
+}
+
+Boolean AcceptReject(Boolean accept, const foint f) {
+    SORT_SOL *s = f.v;
+    assert(s->swap1>=0 && s->swap2>=0);
+    if(!accept) { // swap them back
+	int tmp = s->array[s->swap1]; s->array[s->swap1]=s->array[s->swap2]; s->array[s->swap2]=tmp;
+    }
+    s->swap1 = s->swap2 = -1;
+    return accept;
+}
+
+void Copy(foint dst, const foint src) { memcpy(dst.v, src.v, sizeof(SORT_SOL)); }
+
+int main(void) {
+    int i, r;
+    SORT_SOL sol[REPLICAS], best;
+    foint f[REPLICAS];
+    for(i=0;i<N;i++) sol[0].array[i] = drand48()*N;
+    sol[0].swap1 = sol[0].swap2 = -1;
+    for(r=0;r<REPLICAS;r++) {
+	if(r) sol[r] = sol[0];
+	for(i=0;i<3;i++) sol[r].rng[i] = lrand48();
+	f[r].v = &sol[r];
+    }
+    printf("%g\n", Score(true, f[0]));
+    SIM_ANNEAL_PT *pt = SimAnnealPTAlloc(-1, REPLICAS, f, (foint)(void*)&best, Copy, SwapElements, Score, AcceptReject,
+	100000, 1000, NULL);
+    SimAnnealPTSetLadder(pt, 0.1, 100);
+    int result = SimAnnealPTRun(pt);
+    printf("SimAnnealPTRun returned %d\n", result);
+    double score;
+    foint b = SimAnnealPTBest(pt, &score);
+    printf("best %g (rescored %g)\n", score, Score(true, b));
+    assert(score == Score(true, b));
+    for(i=1;i<N;i++) assert(best.array[i-1] <= best.array[i]);
+    SimAnnealPTFree(pt);
+    return 0;
+}
@@ -0,0 +1,116 @@
+// This software is part of github.com/waynebhayes/libwayne, and is Copyright(C) Wayne B. Hayes 2025, under the GNU LGPL 3.0
+// (GNU Lesser General Public License, version 3, 2007), a copy of which is contained at the top of the repo.
+/*
+** Check SSETDICT with sets that only differ in a few bits (the worst case for a weak hash), growing from
+** the smallest size while lookups are checked against brute force, and then with several threads adding
+** overlapping sets at once in concurrent mode.  "ssetdict-test -b" instead times adding structured sets,
+** with duplicates, from 1 thread up to one per core.
+*/
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "misc.h"
+#include "sets.h"
+#include "rng.h"
+
+#define NUM 200000
+#define THREADS 4
+
+static double Now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + 1e-9*ts.tv_nsec;
+}
+
+// The i'th set: a handful of elements, mostly in the high bits, with a few low bits that vary slowly
+static SSET Set(long i)
+{
+    SSET ss = 0;
+    SSetAdd(ss, 63);
+    ss |= (SSET)(i & 0xffff) << 40 | (SSET)(i >> 16) << 2;
+    return ss;
+}
+
+static SSETDICT *_ssd;
+static long _num;
+
+static void *Adder(void *arg)
+{
+    RNG r;
+    long i, added = 0;
+    RngInit(&r, RNG_XOSHIRO, 1 + (intptr_t)arg);
+    for(i=0; i<_num; i++) {
+	long k = RngInt(&r, 0, _num-1); // so the threads add many of the same sets at about the same time
+	SSetDictAdd(_ssd, Set(k));
+	assert(SSetDictIn(_ssd, Set(k)));
+	++added;
+    }
+    return (void*)added;
+}
+
+static void Benchmark(void)
+{
+    int cores = sysconf(_SC_NPROCESSORS_ONLN), threads, i;
+    pthread_t thread[1024];
+    _num = 10000000;
+    printf("million adds per second, %ld per thread (about 40%% duplicates), on %d cores:\n", _num, cores);
+    double t = Now();
+    _ssd = SSetDictAlloc(1);
+    Adder((void*)0);
+    printf("  1 thread, serial: %.1f (%lu sets)\n", _num/(Now()-t)/1e6, SSetDictSize(_ssd));
+    SSetDictFree(_ssd);
+    for(threads=1; ; threads = MIN(2*threads, cores)) {
+	_ssd = SSetDictAlloc(1);
+	SSetDictConcurrent(_ssd, true);
+	t = Now();
+	for(i=0; i<threads; i++) pthread_create(&thread[i], NULL, Adder, (void*)(intptr_t)i);
+	for(i=0; i<threads; i++) pthread_join(thread[i], NULL);
+	printf("  %d threads, concurrent: %.1f (%lu sets)\n", threads, threads*_num/(Now()-t)/1e6, SSetDictSize(_ssd));
+	SSetDictFree(_ssd);
+	if(threads >= cores || threads >= 1024) break;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    static Boolean in[NUM];
+    pthread_t thread[THREADS];
+    RNG r;
+    long i, n = 0;
+
+    if(argc > 1 && strcmp(argv[1], "-b") == 0) {
+	Benchmark();
+	return 0;
+    }
+
+    RngInit(&r, RNG_XOSHIRO, 1);
+    _ssd = SSetDictAlloc(1);
+    for(i=0; i<4*NUM; i++) {
+	long k = RngInt(&r, 0, NUM-1), j = RngInt(&r, 0, NUM-1);
+	SSetDictAdd(_ssd, Set(k));
+	n += !in[k];
+	in[k] = true;
+	assert(SSetDictIn(_ssd, Set(k)) && SSetDictIn(_ssd, Set(j)) == in[j]);
+	assert(SSetDictSize(_ssd) == (unsigned long)n);
+    }
+    assert(!SSetDictIn(_ssd, SSET_NULLSET));
+    SSetDictAdd(_ssd, SSET_NULLSET);
+    assert(SSetDictIn(_ssd, SSET_NULLSET) && SSetDictSize(_ssd) == (unsigned long)n+1);
+    for(i=0; i<NUM; i++) assert(SSetDictIn(_ssd, Set(i)) == in[i] && !SSetDictIn(_ssd, Set(i) | 1));
+    SSetDictFree(_ssd);
+    puts("growing, with sets that differ in few bits, agrees with brute force");
+
+    _ssd = SSetDictAlloc(1);
+    SSetDictConcurrent(_ssd, true);
+    _num = NUM;
+    for(i=0; i<THREADS; i++) pthread_create(&thread[i], NULL, Adder, (void*)(intptr_t)i);
+    for(i=0; i<THREADS; i++) pthread_join(thread[i], NULL);
+    SSetDictConcurrent(_ssd, false);
+    for(i=0, n=0; i<NUM; i++) n += SSetDictIn(_ssd, Set(i));
+    assert(SSetDictSize(_ssd) == (unsigned long)n && n > NUM/2);
+    for(i=0; i<NUM; i++) assert(!SSetDictIn(_ssd, Set(i) | 1));
+    SSetDictFree(_ssd);
+    printf("%d threads adding at once lose nothing and add nothing twice\n", THREADS);
+    return 0;
+}